@@ -26,6 +26,8 @@
 #include <sys/stat.h>
 #include "defs.h"
 #include "view.h"
+#include "undo.h"
+#include "latency.h"
 #include "modules/modules.h"
 
 char *fontopia_ver = "2.0";
@@ -38,6 +40,9 @@ char *file_data = (char *)NULL;
 int startup_rawfont_width = 0;
 int startup_rawfont_height = 0;
 
+// set when we run without a terminal (e.g. fontopia convert)
+int headless = 0;
+
 extern struct window_s left_window, right_window;
 extern struct window_s *active_window;
 
@@ -55,6 +60,10 @@ void parse_args(int argc, char **argv)
         { "version",      no_argument,            0,  'v' },
         { "width",        required_argument,      0,  'w' },
         { "height",       required_argument,      0,  'i' },
+        { "undo-memory",  required_argument,      0,  'u' },
+        { "latency",      required_argument,      0,  'l' },
+        /* used by fontopia replay, see replay.c */
+        { "frame-fd",     required_argument,      0,  'F' },
         { 0, 0, 0, 0}
     };
 
@@ -63,7 +72,7 @@ void parse_args(int argc, char **argv)
     while(1)
     {
         int option_index=0;
-        c = getopt_long(argc, argv, "vhw:i:", long_options, &option_index);
+        c = getopt_long(argc, argv, "vhw:i:u:l:", long_options, &option_index);
         if(c == -1) break;    //end of options
 
         switch(c)
@@ -81,6 +90,23 @@ void parse_args(int argc, char **argv)
                 seeni = 1;
                 break;
 
+            case 'u':
+                if(atoi(optarg) < 0)
+                {
+                    printf("Invalid undo memory size: %s\n", optarg);
+                    exit(1);
+                }
+                undo_memory_cap = (size_t)atoi(optarg)*1024*1024;
+                break;
+
+            case 'l':
+                latency_start(optarg);
+                break;
+
+            case 'F':
+                replay_start(atoi(optarg));
+                break;
+
             case 'v':    //show version & exit
                 printf("%s\n", fontopia_ver);
                 exit(0);
@@ -90,15 +116,24 @@ void parse_args(int argc, char **argv)
                      "By Mohammed Isam, 2015, 2016, 2017, 2018, 2024\n"
                      "Fontopia is a GNU software\n"
                      "\nUsage: %s [options] [file-name]\n"
+                     "       %s convert [options] in-file out-file\n"
+                     "       %s replay [options] script [options] [file-name]\n"
+                     "       %s --serve [options] socket font-file...\n"
                      "\nOptions:\n"
                      "  [-h, --help]         show this help and exit\n"
                      "  [-i, --height X]     if passed with a filename, the file is opened as a raw\n"
                      "                         font file, assuming glyphs are of height X\n"
+                     "  [-l, --latency FILE] record how long each key takes to handle, and write\n"
+                     "                         the latency histograms to FILE on exit\n"
+                     "  [-u, --undo-memory X]\n"
+                     "                       keep up to X MB of undo history (default %d,\n"
+                     "                         0 turns undo off)\n"
                      "  [-v, --version]      show version and exit\n"
                      "  [-w, --width X]      if passed with a filename, the file is opened as a raw\n"
                      "                         font file, assuming glyphs are of width X\n"
+                     "\nRun '%s convert --help' for the conversion options.\n"
                      "\n"
-                     , fontopia_ver, argv[0]);
+                     , fontopia_ver, argv[0], argv[0], argv[0], argv[0], UNDO_DEFAULT_MEMORY, argv[0]);
               exit(0);
 
             case '?':
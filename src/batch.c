@@ -0,0 +1,457 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: batch.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <pthread.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "parallel.h"
+#include "batch.h"
+#include "modules/modules.h"
+
+/*
+ * Batch conversion (fontopia convert -o dir ...). The inputs are shared
+ * between a fixed number of worker threads, each of which takes the next
+ * input from the list, reads it into memory and writes it out in each of
+ * the requested formats. A failed file is reported and skipped, and doesn't
+ * stop the others. Outputs are written to a temporary file that is renamed
+ * when complete, so a failed conversion never leaves half a font behind.
+ *
+ * While a worker converts one file, it asks the kernel to read ahead the
+ * next few inputs (posix_fadvise), so they are in the page cache by the
+ * time a worker gets to them.
+ */
+
+struct pool_s
+{
+    struct batch_s *batch;
+    pthread_mutex_t lock;
+    unsigned int next;          /* the next job to take */
+    unsigned int advised;       /* jobs before this were read ahead */
+    unsigned int failed;
+};
+
+/* output file extensions, by font version */
+static char *format_ext[] = { "", "psf", "psf", "cp", "raw", "bdf", "pcf" };
+
+
+static int add_job(struct batch_s *batch, char *in, char *out)
+{
+    char *ext;
+
+    if(batch->count == batch->size)
+    {
+        unsigned int size = batch->size ? batch->size*2 : 256;
+        struct batch_job_s *tmp = realloc(batch->job, size*sizeof(struct batch_job_s));
+        if(!tmp) return 0;
+        batch->job = tmp;
+        batch->size = size;
+    }
+
+    if(!(in = strdup(in))) return 0;
+    if(!(out = strdup(out))) { free(in); return 0; }
+
+    /* strip the extension, we add our own */
+    if((ext = strrchr(out, '.')) && ext != out && !strchr(ext, '/')) *ext = '\0';
+
+    batch->job[batch->count].in = in;
+    batch->job[batch->count].out = out;
+    batch->count++;
+    return 1;
+}
+
+/*
+ * Add the font files in a directory and its subdirectories, i.e. the files
+ * with an extension one of the modules knows. Their outputs keep the same
+ * directory structure under the output directory.
+ */
+static int add_dir(struct batch_s *batch, char *root, char *rel)
+{
+    char path[PATH_MAX], relpath[PATH_MAX];
+    struct dirent *ent;
+    struct stat st;
+    DIR *dir;
+    int res = 1;
+
+    snprintf(path, sizeof(path), "%s%s%s", root, *rel ? "/" : "", rel);
+
+    if(!(dir = opendir(path)))
+    {
+        fprintf(stderr, "fontopia: %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+
+    while(res && (ent = readdir(dir)))
+    {
+        if(ent->d_name[0] == '.') continue;
+
+        if(snprintf(relpath, sizeof(relpath), "%s%s%s",
+                    rel, *rel ? "/" : "", ent->d_name) >= (int)sizeof(relpath) ||
+           snprintf(path, sizeof(path), "%s/%s", root, relpath) >= (int)sizeof(path))
+        {
+            fprintf(stderr, "fontopia: %s/%s: Path too long\n", root, ent->d_name);
+            continue;
+        }
+
+        if(stat(path, &st) != 0) continue;
+
+        if(S_ISDIR(st.st_mode)) res = add_dir(batch, root, relpath);
+        else if(S_ISREG(st.st_mode) && check_file_ext(ent->d_name))
+            res = add_job(batch, path, relpath);
+    }
+
+    closedir(dir);
+    return res;
+}
+
+int batch_add_path(struct batch_s *batch, char *path)
+{
+    struct stat st;
+    char *name;
+
+    if(stat(path, &st) != 0)
+    {
+        fprintf(stderr, "fontopia: %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+
+    if(S_ISDIR(st.st_mode)) return add_dir(batch, path, "");
+
+    if((name = strrchr(path, '/'))) name++;
+    else name = path;
+
+    return add_job(batch, path, name);
+}
+
+/* add the files (or directories) listed in a file, one per line */
+int batch_add_list(struct batch_s *batch, char *list_file)
+{
+    FILE *file = stdin;
+    char *line = NULL;
+    size_t len = 0;
+    ssize_t n;
+    int res = 1;
+
+    if(strcmp(list_file, "-") != 0 && !(file = fopen(list_file, "r")))
+    {
+        fprintf(stderr, "fontopia: %s: %s\n", list_file, strerror(errno));
+        return 0;
+    }
+
+    while(res && (n = getline(&line, &len, file)) != -1)
+    {
+        while(n && (line[n-1] == '\n' || line[n-1] == '\r')) line[--n] = '\0';
+        if(n) res = batch_add_path(batch, line);
+    }
+
+    free(line);
+    if(file != stdin) fclose(file);
+    return res;
+}
+
+void free_batch(struct batch_s *batch)
+{
+    unsigned int i;
+
+    for(i = 0; i < batch->count; i++)
+    {
+        free(batch->job[i].in);
+        free(batch->job[i].out);
+    }
+
+    free(batch->job);
+    batch->job = NULL;
+    batch->count = batch->size = 0;
+}
+
+/* create the directories in path, up to the last slash */
+static void make_dirs(char *path)
+{
+    char *p;
+
+    for(p = strchr(path+1, '/'); p; p = strchr(p+1, '/'))
+    {
+        *p = '\0';
+        mkdir(path, 0777);
+        *p = '/';
+    }
+}
+
+static void read_ahead(char *path)
+{
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+/* read the whole file, with some zeroed slack at the end for the file
+ * signature check on very short files.
+ */
+static unsigned char *read_file(char *path, long *size)
+{
+    unsigned char *data = NULL;
+    FILE *file;
+
+    stats_begin(STATS_READ);
+    if(!(file = fopen(path, "rb")))
+    {
+        stats_end(STATS_READ);
+        return NULL;
+    }
+
+    if(fseek(file, 0, SEEK_END) == 0 && (*size = ftell(file)) > 0 &&
+       fseek(file, 0, SEEK_SET) == 0 && (data = calloc(1, *size+64)))
+    {
+        if(fread(data, 1, *size, file) != (size_t)*size)
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+
+    fclose(file);
+    stats_end(STATS_READ);
+    if(data) stats_add(STATS_BYTES_READ, *size);
+    return data;
+}
+
+/*
+ * Convert one font to all the requested formats. Returns 1 on success, 0
+ * if any of them failed.
+ */
+static int convert_job(struct batch_s *batch, struct batch_job_s *job)
+{
+    char out[PATH_MAX], tmp[PATH_MAX+8];
+    struct font_ctx_s ctx;
+    unsigned char *data, *copy;
+    struct font_s *font;
+    long size = 0;
+    int i, version, ok, res = 1;
+    FILE *file;
+
+    errno = 0;
+    if(!(data = read_file(job->in, &size)))
+    {
+        fprintf(stderr, "fontopia: %s: %s\n", job->in,
+                        errno ? strerror(errno) : "Error reading file");
+        return 0;
+    }
+
+    if(!(copy = malloc(size+64)))
+    {
+        fprintf(stderr, "fontopia: %s: Insufficient memory\n", job->in);
+        free(data);
+        return 0;
+    }
+
+    /* a format we can't convert to doesn't stop the other formats */
+    for(i = 0; i < batch->format_count; i++)
+    {
+        version = batch->formats[i];
+        snprintf(out, sizeof(out), "%s/%s.%s", batch->output_dir, job->out, format_ext[version]);
+        snprintf(tmp, sizeof(tmp), "%s.tmp", out);
+        make_dirs(out);
+
+        if(!(file = fopen(tmp, "wb")))
+        {
+            fprintf(stderr, "fontopia: %s: %s\n", tmp, strerror(errno));
+            res = 0;
+            continue;
+        }
+
+        /* the parsers write into the data, so each format gets a fresh copy */
+        memcpy(copy, data, size+64);
+
+        init_font_ctx(&ctx, job->in);
+
+        if(!(font = load_font_data(&ctx, copy, size)))
+        {
+            fprintf(stderr, "fontopia: %s: Can't load font\n", job->in);
+            fclose(file);
+            unlink(tmp);
+            res = 0;
+            break;
+        }
+
+        ok = 0;
+
+        if(convert_font_version(font, version))
+        {
+            /* BDF and PCF take the font name from the file name */
+            init_font_ctx(&ctx, out);
+            ok = !write_to_file(&ctx, file, font);
+        }
+
+        kill_font(font);
+        if(!ok) fprintf(stderr, "fontopia: %s: Can't convert to %s\n",
+                                job->in, get_version_str(version));
+
+        if((fclose(file) && ok) || (ok && rename(tmp, out)))
+        {
+            fprintf(stderr, "fontopia: %s: %s\n", out, strerror(errno));
+            ok = 0;
+        }
+
+        if(!ok)
+        {
+            unlink(tmp);
+            res = 0;
+        }
+    }
+
+    free(copy);
+    free(data);
+    return res;
+}
+
+static void *batch_worker(void *p)
+{
+    struct pool_s *pool = (struct pool_s *)p;
+    struct batch_s *batch = pool->batch;
+    unsigned int i, first, last;
+
+    while(1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        i = pool->next++;
+        first = (pool->advised > i+1) ? pool->advised : i+1;
+        last = i+1+batch->prefetch;
+        if(last > batch->count) last = batch->count;
+        if(last > pool->advised) pool->advised = last;
+        pthread_mutex_unlock(&pool->lock);
+
+        if(i >= batch->count) break;
+
+        for( ; first < last; first++) read_ahead(batch->job[first].in);
+
+        if(!convert_job(batch, &batch->job[i]))
+        {
+            pthread_mutex_lock(&pool->lock);
+            pool->failed++;
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+
+    return NULL;
+}
+
+static int compare_job_out(const void *a, const void *b)
+{
+    return strcmp((*(struct batch_job_s **)a)->out, (*(struct batch_job_s **)b)->out);
+}
+
+/*
+ * Outputs are named after their inputs without the extension, so x.psf
+ * and x.bdf in the same directory (or a file given twice) would write the
+ * same files. Returns 0 if two jobs do, 1 if not, or -1 on memory error.
+ */
+static int check_outputs(struct batch_s *batch)
+{
+    struct batch_job_s **jobs;
+    unsigned int i;
+    int res = 1;
+
+    if(batch->count < 2) return 1;
+    if(!(jobs = malloc(batch->count*sizeof(struct batch_job_s *)))) return -1;
+
+    for(i = 0; i < batch->count; i++) jobs[i] = &batch->job[i];
+    qsort(jobs, batch->count, sizeof(struct batch_job_s *), compare_job_out);
+
+    for(i = 1; i < batch->count; i++)
+    {
+        if(strcmp(jobs[i-1]->out, jobs[i]->out) == 0)
+        {
+            fprintf(stderr, "fontopia: %s and %s would write the same files\n",
+                            jobs[i-1]->in, jobs[i]->in);
+            res = 0;
+        }
+    }
+
+    free(jobs);
+    return res;
+}
+
+/*
+ * Convert all the files in the batch. Returns the number of files that
+ * failed, or -1 if we couldn't start.
+ */
+int run_batch(struct batch_s *batch)
+{
+    pthread_t tid[PARALLEL_MAX_THREADS];
+    struct pool_s pool;
+    int i, threads = batch->jobs, started = 0;
+
+    for(i = 0; i < batch->format_count; i++)
+    {
+        int j;
+
+        for(j = 0; j < i; j++)
+        {
+            if(strcmp(format_ext[batch->formats[i]], format_ext[batch->formats[j]]) == 0)
+            {
+                fprintf(stderr, "fontopia: %s and %s would write the same files\n",
+                                get_version_str(batch->formats[j]),
+                                get_version_str(batch->formats[i]));
+                return -1;
+            }
+        }
+    }
+
+    if((i = check_outputs(batch)) <= 0)
+    {
+        if(i < 0) fprintf(stderr, "fontopia: Insufficient memory\n");
+        return -1;
+    }
+
+    if(mkdir(batch->output_dir, 0777) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "fontopia: %s: %s\n", batch->output_dir, strerror(errno));
+        return -1;
+    }
+
+    if(!batch->count) return 0;
+
+    pool.batch = batch;
+    pool.next = pool.advised = pool.failed = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    if(threads < 1) threads = get_cpu_count();
+    if(threads > PARALLEL_MAX_THREADS) threads = PARALLEL_MAX_THREADS;
+    if(threads > (int)batch->count) threads = batch->count;
+
+    /* the calling thread is the first worker */
+    for(i = 1; i < threads; i++)
+    {
+        if(pthread_create(&tid[started], NULL, batch_worker, &pool) != 0) break;
+        started++;
+    }
+
+    batch_worker(&pool);
+    for(i = 0; i < started; i++) pthread_join(tid[i], NULL);
+
+    pthread_mutex_destroy(&pool.lock);
+    return pool.failed;
+}
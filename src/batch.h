@@ -0,0 +1,50 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: batch.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#define BATCH_MAX_FORMATS           6
+
+/* one input file, and where its output goes */
+struct batch_job_s
+{
+    char *in;
+    char *out;          /* relative to output_dir, without the extension */
+};
+
+struct batch_s
+{
+    char *output_dir;
+    int formats[BATCH_MAX_FORMATS];
+    int format_count;
+    int jobs;           /* worker threads */
+    int prefetch;       /* how many of the next inputs to read ahead */
+    struct batch_job_s *job;
+    unsigned int count, size;
+};
+
+/* batch.c */
+int batch_add_path(struct batch_s *batch, char *path);
+int batch_add_list(struct batch_s *batch, char *list_file);
+int run_batch(struct batch_s *batch);
+void free_batch(struct batch_s *batch);
+
+#endif
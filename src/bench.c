@@ -0,0 +1,577 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: bench.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "defs.h"
+#include "view.h"
+#include "glyph.h"
+#include "undo.h"
+#include "scale.h"
+#include "raster.h"
+#include "modules/modules.h"
+#include "modules/psf.h"
+
+/*
+ * Benchmarks for the format modules and the glyph kernels:
+ *
+ *   fontopia bench [options]
+ *
+ * For every format, glyph count and glyph width, a font with random glyphs
+ * and one unicode entry per glyph is made up in memory, then timed while
+ * it is loaded, saved, and converted to each of the other formats. The
+ * glyph kernels and the unicode table build are timed on the PSF2 fonts.
+ * Sizes a format can't hold are skipped (the reason goes to stderr).
+ *
+ * Each result is one JSON object on a line of its own, e.g.
+ *
+ *   {"bench":"load","format":"BDF","glyphs":4096,"width":16,"height":32,
+ *    "runs":40,"wall_s":0.004118,"glyphs_per_s":994657,"peak_rss_kb":23104}
+ *
+ * wall_s is the mean time of one run. Every font is benchmarked in a child
+ * process of its own, so peak_rss_kb only counts that font.
+ */
+
+#define BENCH_MAX_SIZES         8
+
+struct bench_s
+{
+    int formats[6];
+    int format_count;
+    unsigned int glyphs[BENCH_MAX_SIZES];
+    int glyph_count;
+    int widths[BENCH_MAX_SIZES];
+    int width_count;
+    double min_time;            /* run each benchmark for at least this long */
+};
+
+/* the font being benchmarked */
+struct bench_font_s
+{
+    int version;
+    unsigned int length;
+    int width, height;
+    unsigned char *image;       /* the font file, in this format */
+    long size;
+    char name[16];              /* file name the modules see */
+    FILE *null;
+};
+
+static char *format_ext[] = { "", "psf", "psf", "cp", "raw", "bdf", "pcf" };
+
+static double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static long peak_rss()
+{
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+/* the parsers change the data as they go, so they get a copy of it */
+static unsigned char *copy_image(struct bench_font_s *bf)
+{
+    unsigned char *copy = (unsigned char *)malloc(bf->size+64);
+
+    if(!copy) return NULL;
+    memcpy(copy, bf->image, bf->size+64);
+    return copy;
+}
+
+static struct font_s *load_image(struct bench_font_s *bf, unsigned char *data)
+{
+    struct font_ctx_s ctx;
+
+    init_font_ctx(&ctx, bf->name);
+    ctx.raw_width = bf->width;
+    ctx.raw_height = bf->height;
+    return load_font_data(&ctx, data, bf->size);
+}
+
+static int save_font(struct bench_font_s *bf, struct font_s *font)
+{
+    struct font_ctx_s ctx;
+
+    rewind(bf->null);
+    init_font_ctx(&ctx, bf->name);
+    return write_to_file(&ctx, bf->null, font);
+}
+
+/*
+ * Make up a PSF2 font. Codepoints start at U+0020 and skip the surrogates,
+ * so every glyph gets a valid UTF-8 entry.
+ */
+static unsigned char *make_psf2_image(unsigned int length, int width, int height, long *size)
+{
+    struct psf2_header hdr;
+    unsigned int charsize = ((width+7)/8)*height;
+    unsigned int i, cp, rnd = 2463534242u;
+    unsigned char *image, *p;
+
+    *size = sizeof(hdr) + (long)length*charsize + (long)length*5;
+    if(!(image = (unsigned char *)calloc(1, *size+64))) return NULL;
+
+    hdr.magic[0] = PSF2_MAGIC0;
+    hdr.magic[1] = PSF2_MAGIC1;
+    hdr.magic[2] = PSF2_MAGIC2;
+    hdr.magic[3] = PSF2_MAGIC3;
+    hdr.version = 0;
+    hdr.headersize = sizeof(hdr);
+    hdr.flags = PSF2_HAS_UNICODE_TABLE;
+    hdr.length = length;
+    hdr.charsize = charsize;
+    hdr.height = height;
+    hdr.width = width;
+    memcpy(image, &hdr, sizeof(hdr));
+    p = image + sizeof(hdr);
+
+    for(i = 0; i < length*charsize; i++)
+    {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        *p++ = (unsigned char)rnd;
+    }
+
+    for(i = 0; i < length; i++)
+    {
+        cp = 0x20 + i;
+        if(cp >= 0xD800) cp += 0x800;
+        p += make_utf8(p, cp);
+        *p++ = PSF2_SEPARATOR;
+    }
+
+    *size = p - image;
+    return image;
+}
+
+/*
+ * Get the font in bf->version, by converting the PSF2 font we made up.
+ * Returns 0 if the format can't hold a font this size, -1 on error.
+ */
+static int make_image(struct bench_font_s *bf)
+{
+    struct bench_font_s psf2 = *bf;
+    struct font_ctx_s ctx;
+    struct font_s *font;
+    char *buf = NULL;
+    size_t size = 0;
+    FILE *file;
+    int res = -1;
+
+    if(!(psf2.image = make_psf2_image(bf->length, bf->width, bf->height, &psf2.size)))
+        return -1;
+
+    strcpy(psf2.name, "bench.psf");
+    font = load_image(&psf2, psf2.image);
+    free(psf2.image);
+    if(!font) return -1;
+
+    if(!convert_font_version(font, bf->version)) res = 0;
+    else if((file = open_memstream(&buf, &size)))
+    {
+        init_font_ctx(&ctx, bf->name);
+        if(!write_to_file(&ctx, file, font)) res = 1;
+        fclose(file);
+    }
+
+    kill_font(font);
+
+    if(res == 1)
+    {
+        if((bf->image = (unsigned char *)calloc(1, size+64)))
+        {
+            memcpy(bf->image, buf, size);
+            bf->size = size;
+        }
+        else res = -1;
+    }
+
+    free(buf);
+    return res;
+}
+
+static void report(struct bench_font_s *bf, char *bench, int to,
+                   int runs, double total)
+{
+    double wall = total/runs;
+
+    printf("{\"bench\":\"%s\",\"format\":\"%s\",", bench, get_version_str(bf->version));
+    if(to) printf("\"to\":\"%s\",", get_version_str(to));
+    printf("\"glyphs\":%u,\"width\":%d,\"height\":%d,\"runs\":%d,"
+           "\"wall_s\":%.6f,\"glyphs_per_s\":%.0f,\"peak_rss_kb\":%ld}\n",
+           bf->length, bf->width, bf->height, runs,
+           wall, wall > 0 ? bf->length/wall : 0, peak_rss());
+    fflush(stdout);
+}
+
+/*
+ * A benchmark does one run and returns the time it took, leaving out any
+ * setup, or -1 on error.
+ */
+typedef double (*bench_func_t)(struct bench_font_s *bf, struct font_s *font, int arg);
+
+static void measure(struct bench_s *bench, struct bench_font_s *bf, char *name,
+                    bench_func_t func, struct font_s *font, int arg, int to)
+{
+    double t, total = 0;
+    int runs = 0;
+
+    do
+    {
+        if((t = func(bf, font, arg)) < 0) return;
+        total += t;
+        runs++;
+    } while(total < bench->min_time);
+
+    report(bf, name, to, runs, total);
+}
+
+static double bench_load(struct bench_font_s *bf, struct font_s *unused, int arg)
+{
+    unsigned char *data = copy_image(bf);
+    struct font_s *font;
+    double t;
+
+    (void)unused;
+    (void)arg;
+    if(!data) return -1;
+    t = now();
+    font = load_image(bf, data);
+    t = now()-t;
+    free(data);
+    if(!font) return -1;
+    kill_font(font);
+    return t;
+}
+
+static double bench_save(struct bench_font_s *bf, struct font_s *font, int arg)
+{
+    double t = now();
+
+    (void)arg;
+    if(save_font(bf, font)) return -1;
+    return now()-t;
+}
+
+/* load, convert to another format and save */
+static double bench_convert(struct bench_font_s *bf, struct font_s *unused, int version)
+{
+    unsigned char *data = copy_image(bf);
+    struct font_s *font;
+    double t;
+    int res;
+
+    (void)unused;
+    if(!data) return -1;
+    t = now();
+
+    if((font = load_image(bf, data)))
+    {
+        res = convert_font_version(font, version) && !save_font(bf, font);
+        t = now()-t;
+        kill_font(font);
+    }
+    else res = 0;
+
+    free(data);
+    return res ? t : -1;
+}
+
+static double bench_kernel(struct bench_font_s *bf, struct font_s *font, int kernel)
+{
+    int old_width = font->width;
+    double t = now();
+
+    switch(kernel)
+    {
+        case 0: invert_glyph(font); break;
+        case 1: glyphop_rotate_cw(font); break;
+        case 2: glyphop_center_both(font); break;
+
+        case 3:
+            /* scale the glyphs to twice the width, then back */
+            font->width = (old_width == bf->width) ? old_width*2 : bf->width;
+            handle_hw_change(font, font->height, old_width, font->length, SCALE_NEAREST);
+            break;
+
+        case 4:
+            free_unicode_table(font);
+            if(!create_empty_unitab(font)) return -1;
+            get_font_unicode_table(font);
+            break;
+    }
+
+    return now()-t;
+}
+
+/*
+ * Draw a character for every glyph as lines of text, 80 characters to a
+ * line, into a 1 or 8 bpp framebuffer. The text is made up before the
+ * clock starts, so this times the glyph lookup and the blit kernels.
+ */
+#define RENDER_LINE             80
+
+static double bench_render(struct bench_font_s *bf, struct font_s *font, int bpp)
+{
+    struct cpmap_s *map;
+    struct raster_s r;
+    unsigned char *text = NULL;
+    int count, chars, i, len = 0, *lines = NULL;
+    double t = -1;
+
+    (void)bf;
+    if((count = get_cpmap(font, &map)) < 0) return -1;
+    chars = map ? count : (int)font->length;
+
+    r.width = RENDER_LINE*font->width;
+    r.height = font->height;
+    r.stride = (bpp == 1) ? (r.width+7)/8 : r.width;
+    r.bpp = bpp;
+    r.color = 0xFF;
+
+    if(!(r.pixels = (unsigned char *)calloc(r.stride, r.height)) ||
+       !(text = (unsigned char *)malloc(chars*4+1)) ||
+       !(lines = (int *)malloc((chars/RENDER_LINE+2)*sizeof(int))))
+        goto fin;
+
+    for(i = 0; i < chars; i++)
+    {
+        if(i % RENDER_LINE == 0) lines[i/RENDER_LINE] = len;
+        len += make_utf8(text+len, map ? map[i].cp : (unsigned int)i);
+    }
+
+    lines[(chars+RENDER_LINE-1)/RENDER_LINE] = len;
+    t = now();
+
+    for(i = 0; i < (chars+RENDER_LINE-1)/RENDER_LINE; i++)
+        raster_text(font, map, count, text+lines[i], lines[i+1]-lines[i], &r, 0, 0);
+
+    t = now()-t;
+
+fin:
+    free(r.pixels);
+    free(text);
+    free(lines);
+    free(map);
+    return t;
+}
+
+static char *kernel_names[] = { "invert", "rotate", "center", "hw_change", "unitab" };
+
+/* run all the benchmarks for one font */
+static int bench_font(struct bench_s *bench, struct bench_font_s *bf)
+{
+    struct font_s *font;
+    unsigned char *data;
+    int i;
+
+    snprintf(bf->name, sizeof(bf->name), "bench.%s", format_ext[bf->version]);
+    if((i = make_image(bf)) <= 0) return i ? 1 : 0;
+    if(!(bf->null = fopen("/dev/null", "wb"))) return 1;
+
+    measure(bench, bf, "load", bench_load, NULL, 0, 0);
+
+    if(!(data = copy_image(bf)) || !(font = load_image(bf, data))) return 1;
+    free(data);
+    measure(bench, bf, "save", bench_save, font, 0, 0);
+
+    for(i = 0; i < bench->format_count; i++)
+    {
+        if(bench->formats[i] == bf->version) continue;
+        measure(bench, bf, "convert", bench_convert, NULL,
+                bench->formats[i], bench->formats[i]);
+    }
+
+    measure(bench, bf, "render_1bpp", bench_render, font, 1, 0);
+    measure(bench, bf, "render_8bpp", bench_render, font, 8, 0);
+
+    /* the kernels work on the selection, so select every glyph */
+    if(bf->version == VER_PSF2)
+    {
+        right_window.first_vis_row = 0;
+        right_window.cursor.row = 0;
+        right_window.cursor.col = 0;
+        selection_anchor = font->length-1;
+
+        for(i = 0; i < (int)(sizeof(kernel_names)/sizeof(char *)); i++)
+            measure(bench, bf, kernel_names[i], bench_kernel, font, i, 0);
+    }
+
+    kill_font(font);
+    fclose(bf->null);
+    free(bf->image);
+    return 0;
+}
+
+/* parse a comma-separated list of numbers */
+static int parse_list(char *list, int *arr, int max)
+{
+    int count = 0;
+    char *s;
+
+    for(s = strtok(list, ","); s; s = strtok(NULL, ","))
+    {
+        if(count == max || (arr[count++] = atoi(s)) <= 0) return 0;
+    }
+
+    return count;
+}
+
+static void bench_usage(FILE *f)
+{
+    fprintf(f, "Usage: fontopia bench [options]\n"
+               "\nOptions:\n"
+               "  [-f, --format X]     benchmark the formats in comma-separated list X\n"
+               "                         (default: psf1,psf2,cp,raw,bdf,pcf)\n"
+               "  [-g, --glyphs X]     glyph counts to try (default: 256,4096,65536)\n"
+               "  [-h, --help]         show this help and exit\n"
+               "  [-t, --time X]       run each benchmark for at least X seconds\n"
+               "                         (default: 0.2)\n"
+               "  [-w, --width X]      glyph widths to try (default: 8,16,32). Glyphs\n"
+               "                         are twice as high as they are wide\n"
+               "\nResults are printed to stdout, one JSON object per line.\n"
+               "\n");
+}
+
+int bench_main(int argc, char **argv)
+{
+    static struct option long_options[] =
+    {
+        { "format",       required_argument,      0,  'f' },
+        { "glyphs",       required_argument,      0,  'g' },
+        { "help",         no_argument,            0,  'h' },
+        { "time",         required_argument,      0,  't' },
+        { "width",        required_argument,      0,  'w' },
+        { 0, 0, 0, 0}
+    };
+    struct bench_s bench = {
+        { VER_PSF1, VER_PSF2, VER_CP, VER_RAW, VER_BDF, VER_PCF }, 6,
+        { 256, 4096, 65536 }, 3,
+        { 8, 16, 32 }, 3,
+        0.2
+    };
+    struct bench_font_s bf;
+    int f, g, w, c, status, res = 0;
+    char *name;
+    pid_t pid;
+
+    headless = 1;
+    undo_memory_cap = 0;
+    big_endian = is_big_endian();
+    init_modules();
+
+    while((c = getopt_long(argc, argv, "f:g:ht:w:", long_options, NULL)) != -1)
+    {
+        switch(c)
+        {
+            case 'f':
+                bench.format_count = 0;
+                for(name = strtok(optarg, ","); name; name = strtok(NULL, ","))
+                {
+                    if(bench.format_count == 6 ||
+                       !(bench.formats[bench.format_count++] = get_version(name)))
+                    {
+                        fprintf(stderr, "fontopia: Unknown format: %s\n", name);
+                        return 1;
+                    }
+                }
+                break;
+
+            case 'g':
+                if(!(bench.glyph_count = parse_list(optarg, (int *)bench.glyphs,
+                                                    BENCH_MAX_SIZES)))
+                {
+                    fprintf(stderr, "fontopia: Invalid glyph counts\n");
+                    return 1;
+                }
+                break;
+
+            case 't':
+                bench.min_time = atof(optarg);
+                break;
+
+            case 'w':
+                if(!(bench.width_count = parse_list(optarg, bench.widths, BENCH_MAX_SIZES)))
+                {
+                    fprintf(stderr, "fontopia: Invalid glyph widths\n");
+                    return 1;
+                }
+                for(w = 0; w < bench.width_count; w++)
+                {
+                    if(bench.widths[w] > MAX_WIDTH || bench.widths[w]*2 > MAX_HEIGHT)
+                    {
+                        fprintf(stderr, "fontopia: Glyph width %d is too large\n",
+                                        bench.widths[w]);
+                        return 1;
+                    }
+                }
+                break;
+
+            case 'h':
+                bench_usage(stdout);
+                return 0;
+
+            default:
+                bench_usage(stderr);
+                return 1;
+        }
+    }
+
+    for(f = 0; f < bench.format_count; f++)
+    {
+        for(g = 0; g < bench.glyph_count; g++)
+        {
+            for(w = 0; w < bench.width_count; w++)
+            {
+                memset(&bf, 0, sizeof(bf));
+                bf.version = bench.formats[f];
+                bf.length = bench.glyphs[g];
+                bf.width = bench.widths[w];
+                bf.height = bf.width*2;
+
+                fflush(stdout);
+
+                if((pid = fork()) < 0)
+                {
+                    perror("fontopia: fork");
+                    return 1;
+                }
+
+                if(pid == 0) exit(bench_font(&bench, &bf));
+
+                if(waitpid(pid, &status, 0) < 0 ||
+                   !WIFEXITED(status) || WEXITSTATUS(status) != 0) res = 1;
+            }
+        }
+    }
+
+    return res;
+}
@@ -0,0 +1,297 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: convert.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "view.h"
+#include "undo.h"
+#include "batch.h"
+#include "parallel.h"
+#include "modules/modules.h"
+#include "modules/psf.h"
+
+/*
+ * Headless batch conversion:
+ *
+ *   fontopia convert [options] in-file out-file
+ *   fontopia convert [options] -o out-dir in-file-or-dir...
+ *
+ * This runs before the terminal is initialized and never touches it. The
+ * fonts are loaded and written by the same module functions the editor
+ * uses, and the format is changed the same way the metrics window does it.
+ * Errors go to stderr (see _do_status()) and the exit status is 0 on
+ * success, 1 on error.
+ */
+
+/* --stats and --trace */
+static int print_stats = 0;
+static char *trace_file_name = NULL;
+
+static void convert_usage(FILE *f)
+{
+    fprintf(f, "Usage: fontopia convert [options] in-file out-file\n"
+               "       fontopia convert [options] -f X[,Y...] -o out-dir [in-file|in-dir]...\n"
+               "\nOptions:\n"
+               "  [-f, --format X]     write the font in format X (psf1, psf2, cp, raw,\n"
+               "                         bdf or pcf). The default is taken from the\n"
+               "                         extension of out-file, or the input format.\n"
+               "                         With -o, a comma-separated list of formats\n"
+               "  [-h, --help]         show this help and exit\n"
+               "  [-i, --height X]     read in-file as a raw font with glyphs of height X\n"
+               "  [-j, --jobs X]       convert X files at a time (default: one per CPU)\n"
+               "  [-l, --list X]       also convert the files listed in file X, one per\n"
+               "                         line (- reads the list from stdin)\n"
+               "  [-o, --output-dir X] convert many files, writing them to directory X.\n"
+               "                         Directories are searched for font files, and\n"
+               "                         their structure is kept in the output\n"
+               "  [-p, --prefetch X]   read ahead the next X input files (default 4\n"
+               "                         per job, 0 turns it off)\n"
+               "  [--stats=json]       print the time spent in each phase of loading\n"
+               "                         and saving, and some counters, to stdout\n"
+               "  [--trace=X]          write the phases to file X as Chrome trace events\n"
+               "  [-w, --width X]      read in-file as a raw font with glyphs of width X\n"
+               "\n");
+}
+
+/* the format with this name or file extension (psf means PSF2) */
+static int format_from_name(char *name)
+{
+    if(strcasecmp(name, "psf") == 0 || strcasecmp(name, "psfu") == 0) return VER_PSF2;
+    return get_version(name);
+}
+
+static int format_from_file_name(char *file_name)
+{
+    char *ext = strrchr(file_name, '.');
+
+    if(!ext || strchr(ext, '/')) return 0;
+    return format_from_name(ext+1);
+}
+
+/* parse a comma-separated list of formats */
+static int parse_formats(struct batch_s *batch, char *list)
+{
+    char *name;
+
+    for(name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+        if(batch->format_count == BATCH_MAX_FORMATS ||
+           !(batch->formats[batch->format_count++] = format_from_name(name)))
+        {
+            fprintf(stderr, "fontopia: Unknown format: %s\n", name);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int convert_many(struct batch_s *batch, int argc, char **argv, char *list_file)
+{
+    int i, res;
+
+    if(!batch->format_count)
+    {
+        fprintf(stderr, "fontopia: Use -f to choose the output format(s)\n");
+        return 1;
+    }
+
+    for(i = 0; i < argc; i++)
+        if(!batch_add_path(batch, argv[i])) goto error;
+
+    if(list_file && !batch_add_list(batch, list_file)) goto error;
+
+    if((res = run_batch(batch)) < 0) goto error;
+    if(res) fprintf(stderr, "fontopia: %d of %u files failed\n", res, batch->count);
+
+    free_batch(batch);
+    return res ? 1 : 0;
+
+error:
+
+    free_batch(batch);
+    return 1;
+}
+
+static int convert(int argc, char **argv)
+{
+    static struct option long_options[] =
+    {
+        { "format",       required_argument,      0,  'f' },
+        { "help",         no_argument,            0,  'h' },
+        { "width",        required_argument,      0,  'w' },
+        { "height",       required_argument,      0,  'i' },
+        { "jobs",         required_argument,      0,  'j' },
+        { "list",         required_argument,      0,  'l' },
+        { "output-dir",   required_argument,      0,  'o' },
+        { "prefetch",     required_argument,      0,  'p' },
+        { "stats",        required_argument,      0,  'S' },
+        { "trace",        required_argument,      0,  'T' },
+        { 0, 0, 0, 0}
+    };
+    struct batch_s batch;
+    struct font_ctx_s ctx;
+    struct font_s *font;
+    char *list_file = NULL, *out, *tmp;
+    struct stat st;
+    int version = 0, c, res;
+    FILE *file;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.prefetch = -1;
+
+    headless = 1;
+    undo_memory_cap = 0;
+    big_endian = is_big_endian();
+    init_modules();
+
+    while((c = getopt_long(argc, argv, "f:hw:i:j:l:o:p:", long_options, NULL)) != -1)
+    {
+        switch(c)
+        {
+            case 'f':
+                if(!parse_formats(&batch, optarg)) return 1;
+                break;
+
+            case 'j':
+                batch.jobs = atoi(optarg);
+                break;
+
+            case 'l':
+                list_file = optarg;
+                break;
+
+            case 'o':
+                batch.output_dir = optarg;
+                break;
+
+            case 'p':
+                batch.prefetch = atoi(optarg);
+                break;
+
+            case 'w':
+                startup_rawfont_width = atoi(optarg);
+                break;
+
+            case 'i':
+                startup_rawfont_height = atoi(optarg);
+                break;
+
+            case 'S':
+                if(strcmp(optarg, "json"))
+                {
+                    fprintf(stderr, "fontopia: Unknown stats format: %s\n", optarg);
+                    return 1;
+                }
+                print_stats = 1;
+                break;
+
+            case 'T':
+                trace_file_name = optarg;
+                break;
+
+            case 'h':
+                convert_usage(stdout);
+                return 0;
+
+            default:
+                convert_usage(stderr);
+                return 1;
+        }
+    }
+
+    if(print_stats || trace_file_name) stats_start(trace_file_name != NULL);
+
+    if(batch.output_dir)
+    {
+        if(batch.jobs < 1) batch.jobs = get_cpu_count();
+        if(batch.prefetch < 0) batch.prefetch = batch.jobs*4;
+        return convert_many(&batch, argc-optind, argv+optind, list_file);
+    }
+
+    if(argc-optind != 2 || list_file || batch.format_count > 1)
+    {
+        convert_usage(stderr);
+        return 1;
+    }
+
+    version = batch.format_count ? batch.formats[0] : format_from_file_name(argv[optind+1]);
+
+    init_font_ctx(&ctx, argv[optind]);
+    if(!(font = load_font_file(&ctx))) return 1;
+
+    if(!version) version = font->version;
+    if(!convert_font_version(font, version)) return 1;
+
+    /*
+     * Write to a temporary file that is renamed when complete, so a failed
+     * write never leaves half a font behind. Devices and pipes (e.g.
+     * /dev/stdout) are written to directly.
+     */
+    out = argv[optind+1];
+    tmp = NULL;
+
+    if(stat(out, &st) != 0 || S_ISREG(st.st_mode))
+    {
+        if(!(tmp = malloc(strlen(out)+5))) return 1;
+        sprintf(tmp, "%s.tmp", out);
+    }
+
+    if(!(file = fopen(tmp ? tmp : out, "wb")))
+    {
+        perror(tmp ? tmp : out);
+        free(tmp);
+        return 1;
+    }
+
+    /* BDF and PCF take the font name from the file name if they have none */
+    init_font_ctx(&ctx, out);
+
+    res = write_to_file(&ctx, file, font);
+    if(fclose(file)) res = 1;
+    if(!res && tmp && rename(tmp, out)) res = 1;
+
+    if(res)
+    {
+        fprintf(stderr, "fontopia: Error writing %s\n", out);
+        if(tmp) unlink(tmp);
+    }
+
+    free(tmp);
+    kill_font(font);
+    return res ? 1 : 0;
+}
+
+int convert_main(int argc, char **argv)
+{
+    int res = convert(argc, argv);
+
+    if(print_stats) stats_write_json(stdout);
+
+    if(trace_file_name && !stats_write_trace(trace_file_name))
+    {
+        perror(trace_file_name);
+        res = 1;
+    }
+
+    return res;
+}
@@ -0,0 +1,66 @@
+/* 
+ *    Copyright 2015, 2016, 2017, 2018 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: core.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef CORE_H
+#define CORE_H
+
+/*
+ * The declarations shared by the editor, the format modules and the
+ * library. Nothing here may need GnuDOS, as the library is built without
+ * it. Editor-only code includes defs.h instead.
+ */
+
+#include "font_ops.h"
+#include "stats.h"
+#include <string.h>
+
+/* args.c */
+void parse_args(int argc, char **argv);
+void init(int argc, char **argv);
+void quit(struct font_s *font);
+
+extern char *font_file_name;
+extern FILE *font_file;
+extern char *file_data;
+extern int startup_rawfont_width;
+extern int startup_rawfont_height;
+extern int headless;
+
+/* status.c */
+void status_error(char *msg);
+void status_msg(char *msg);
+void status_clear();
+
+#define STATUS_ERROR		1
+#define STATUS_REGULAR		2
+
+/* main.c */
+void exit_gracefully();
+extern char buffer_mode_on;
+
+/* view.c */
+void refresh_view(struct font_s *font);
+void refresh_view_status_msg(char* msg, struct font_s *font);
+void refresh_view_status_error(char *msg, struct font_s *font);
+
+/* unitab.c */
+#define MAX_UNICODE_TABLE_ENTRIES	(20)
+
+#endif
@@ -0,0 +1,462 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: dedup.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include "defs.h"
+#include "parallel.h"
+#include "fonttools.h"
+
+/***********************************
+ * Glyph deduplication
+ ***********************************/
+struct glyph_hash_s
+{
+    uint64_t hash;
+    unsigned int index;
+};
+
+/* FNV-1a hash of each glyph's bitmap */
+static void hash_glyphs_kernel(struct font_s *font, unsigned int first,
+                               unsigned int count, void *arg)
+{
+    struct glyph_hash_s *hashes = (struct glyph_hash_s *)arg;
+    unsigned char *data = font->data + (first*font->charsize);
+    unsigned int i, j;
+
+    for(i = first; i < first+count; i++)
+    {
+        uint64_t h = 0xcbf29ce484222325ULL;
+
+        for(j = 0; j < font->charsize; j++)
+        {
+            h ^= data[j];
+            h *= 0x100000001b3ULL;
+        }
+
+        hashes[i].hash = h;
+        hashes[i].index = i;
+        data += font->charsize;
+    }
+}
+
+static int compare_hashes(const void *a, const void *b)
+{
+    const struct glyph_hash_s *h1 = (const struct glyph_hash_s *)a;
+    const struct glyph_hash_s *h2 = (const struct glyph_hash_s *)b;
+
+    if(h1->hash != h2->hash) return (h1->hash < h2->hash) ? -1 : 1;
+    if(h1->index != h2->index) return (h1->index < h2->index) ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Fill canon[] so that canon[i] is the first glyph whose bitmap is
+ * identical to glyph i (which is i itself if the glyph is unique).
+ * Glyphs are bucketed by their hash, and glyphs in the same bucket are
+ * compared byte by byte, so hash collisions never merge different glyphs.
+ * Returns the number of duplicate glyphs, or -1 on memory error.
+ */
+int find_glyph_duplicates(struct font_s *font, unsigned int *canon)
+{
+    struct glyph_hash_s *hashes;
+    unsigned int i, j, run;
+    int dups = 0;
+
+    hashes = (struct glyph_hash_s *)malloc(font->length*sizeof(struct glyph_hash_s));
+    if(!hashes) return -1;
+
+    for_each_glyph_range(font, 0, font->length, hash_glyphs_kernel, hashes);
+    qsort(hashes, font->length, sizeof(struct glyph_hash_s), compare_hashes);
+
+    for(run = 0; run < font->length; run = i)
+    {
+        for(i = run; i < font->length && hashes[i].hash == hashes[run].hash; i++)
+        {
+            unsigned int g = hashes[i].index;
+            canon[g] = g;
+
+            /* glyphs in the run are sorted by index, so the first match is
+             * the canonical glyph.
+             */
+            for(j = run; j < i; j++)
+            {
+                unsigned int g2 = hashes[j].index;
+
+                if(canon[g2] == g2 &&
+                   memcmp(font->data+(g*font->charsize),
+                          font->data+(g2*font->charsize), font->charsize) == 0)
+                {
+                    canon[g] = g2;
+                    dups++;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(hashes);
+    return dups;
+}
+
+/*
+ * Collapse each group of identical glyphs into its first glyph, which
+ * takes all the unicode values of the group.
+ */
+static int compact_font_glyphs(struct font_s *font, unsigned int *canon,
+                               unsigned int new_length)
+{
+    int *remap;
+    unsigned int i, k;
+    int res;
+
+    remap = (int *)malloc(font->length*sizeof(int));
+    if(!remap) { status_error("Insufficient memory"); return 0; }
+
+    for(k = 0, i = 0; i < font->length; i++)
+        remap[i] = (canon[i] == i) ? (int)k++ : remap[canon[i]];
+
+    res = remap_font_glyphs(font, remap, new_length, NULL);
+    free(remap);
+    return res;
+}
+
+void find_duplicate_glyphs(struct font_s *font)
+{
+    struct report_s report = { NULL, 0, 0 };
+    unsigned int *canon;
+    unsigned int i, j;
+    int dups;
+    char msg[128];
+
+    canon = (unsigned int *)malloc(font->length*sizeof(unsigned int));
+    if(!canon) { status_error("Insufficient memory"); return; }
+
+    if((dups = find_glyph_duplicates(font, canon)) < 0)
+    {
+        status_error("Insufficient memory");
+        free(canon);
+        return;
+    }
+
+    if(dups == 0)
+    {
+        msgBox("No duplicate glyphs found.", BUTTON_OK, INFO);
+        free(canon);
+        return;
+    }
+
+    report_printf(&report, "Duplicate glyphs\n================\n\n");
+    report_printf(&report, "%u glyphs, %u unique bitmaps, %d duplicates "
+                           "(%u bytes).\n\n", font->length, font->length-dups,
+                           dups, dups*font->charsize);
+
+    for(i = 0; i < font->length; i++)
+    {
+        int first = 1;
+
+        if(canon[i] != i) continue;
+
+        for(j = i+1; j < font->length; j++)
+        {
+            if(canon[j] != i) continue;
+
+            if(first)
+            {
+                report_printf(&report, "#%u", i);
+                report_unicode(&report, font, i);
+                report_printf(&report, "\n");
+                first = 0;
+            }
+
+            report_printf(&report, "  = #%u", j);
+            report_unicode(&report, font, j);
+            report_printf(&report, "\n");
+        }
+    }
+
+    show_report(&report, " Duplicate Glyphs ");
+    free_report(&report);
+
+    /*
+     * Only PSF2 fonts with a unicode table can be compacted. Without a
+     * unicode table, the glyph's position is its character code, and PSF1
+     * fonts can only have 256 or 512 glyphs.
+     */
+    if(font->version == VER_PSF2 && font->has_unicode_table)
+    {
+        sprintf(msg, "Merge the duplicates? This will\n"
+                     "shrink the font from %u to %u glyphs.",
+                     font->length, font->length-dups);
+
+        if(msgBox(msg, BUTTON_YES|BUTTON_NO, CONFIRM) == BUTTON_YES)
+        {
+            if(compact_font_glyphs(font, canon, font->length-dups))
+                status_msg("Duplicate glyphs merged");
+        }
+    }
+
+    free(canon);
+}
+
+
+/***********************************
+ * Near-duplicate glyphs
+ ***********************************/
+#define DEFAULT_SIMILAR_DISTANCE    (2)
+#define MAX_SIMILAR_DISTANCE        (8)
+#define MAX_REPORTED_PAIRS          (5000)
+
+struct band_hash_s
+{
+    unsigned int bands;
+    int bits;               /* split the bands at bit, not byte, level */
+    uint64_t *hashes;       /* band hashes, bands per glyph */
+};
+
+/*
+ * Hash the bytes of each band of each glyph. Band k is made of the bytes
+ * whose offset in the glyph is k modulo the band count, so every band
+ * samples the whole glyph, and the top or bottom rows, which are blank
+ * in most glyphs, don't end up in one band. Glyphs with fewer bytes than
+ * bands are split the same way, one bit at a time.
+ */
+static void band_hash_kernel(struct font_s *font, unsigned int first,
+                             unsigned int count, void *arg)
+{
+    struct band_hash_s *bh = (struct band_hash_s *)arg;
+    unsigned char *data = font->data + (first*font->charsize);
+    uint64_t *h = bh->hashes + (first*bh->bands);
+    unsigned int i, j;
+
+    for(i = 0; i < count; i++)
+    {
+        for(j = 0; j < bh->bands; j++) h[j] = 0xcbf29ce484222325ULL;
+
+        if(bh->bits)
+        {
+            for(j = 0; j < font->charsize*8; j++)
+            {
+                h[j % bh->bands] ^= (data[j/8] >> (j%8)) & 1;
+                h[j % bh->bands] *= 0x100000001b3ULL;
+            }
+        }
+        else
+        {
+            for(j = 0; j < font->charsize; j++)
+            {
+                h[j % bh->bands] ^= data[j];
+                h[j % bh->bands] *= 0x100000001b3ULL;
+            }
+        }
+
+        h += bh->bands;
+        data += font->charsize;
+    }
+}
+
+/* count the pixels that differ between two glyphs, 64 at a time */
+static unsigned int glyph_distance(unsigned char *g1, unsigned char *g2,
+                                   unsigned int charsize)
+{
+    unsigned int i, dist = 0;
+    uint64_t w1, w2;
+
+    for(i = 0; i+8 <= charsize; i += 8)
+    {
+        memcpy(&w1, g1+i, 8);
+        memcpy(&w2, g2+i, 8);
+        dist += __builtin_popcountll(w1 ^ w2);
+    }
+
+    for( ; i < charsize; i++) dist += __builtin_popcount(g1[i] ^ g2[i]);
+
+    return dist;
+}
+
+static int compare_pairs(const void *a, const void *b)
+{
+    const struct similar_pair_s *p1 = (const struct similar_pair_s *)a;
+    const struct similar_pair_s *p2 = (const struct similar_pair_s *)b;
+
+    if(p1->a != p2->a) return (p1->a < p2->a) ? -1 : 1;
+    if(p1->b != p2->b) return (p1->b < p2->b) ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Find the pairs of glyphs that differ in 1 to maxdist pixels. Identical
+ * glyphs are left to the duplicates report, and only the first glyph of
+ * each group of duplicates is compared.
+ *
+ * Comparing every pair is too slow for big fonts. Instead, each glyph is
+ * split into maxdist+1 bands: two glyphs that differ in maxdist pixels or
+ * less must have at least one identical band. We bucket the glyphs by the
+ * hash of each band, and only compare glyphs that share a bucket. This
+ * finds all the pairs, not just most of them. Glyphs smaller than maxdist+1
+ * bytes are split into bands of bits, and glyphs smaller than maxdist+1
+ * bits all go in one bucket, as any two of them are near duplicates.
+ *
+ * Returns the number of pairs stored in *pairs (which the caller frees),
+ * or -1 on memory error.
+ */
+int find_glyph_near_duplicates(struct font_s *font, unsigned int maxdist,
+                               struct similar_pair_s **pairs)
+{
+    struct band_hash_s bh;
+    struct glyph_hash_s *bucket = NULL;
+    struct similar_pair_s *res = NULL;
+    unsigned int *canon = NULL;
+    unsigned int i, j, k, run, n, count = 0, size = 0;
+    int result = -1;
+
+    bh.bands = maxdist+1;
+    bh.bits = (font->charsize < bh.bands);
+    if(bh.bits && font->charsize*8 < bh.bands) bh.bands = 1;
+    bh.hashes = (uint64_t *)calloc(font->length*bh.bands, sizeof(uint64_t));
+    bucket = (struct glyph_hash_s *)malloc(font->length*sizeof(struct glyph_hash_s));
+    canon = (unsigned int *)malloc(font->length*sizeof(unsigned int));
+    if(!bh.hashes || !bucket || !canon) goto end;
+
+    if(find_glyph_duplicates(font, canon) < 0) goto end;
+    if(font->charsize*8 > maxdist)
+        for_each_glyph_range(font, 0, font->length, band_hash_kernel, &bh);
+
+    for(k = 0; k < bh.bands; k++)
+    {
+        for(n = 0, i = 0; i < font->length; i++)
+        {
+            if(canon[i] != i) continue;
+            bucket[n].hash = bh.hashes[(i*bh.bands)+k];
+            bucket[n].index = i;
+            n++;
+        }
+
+        qsort(bucket, n, sizeof(struct glyph_hash_s), compare_hashes);
+
+        for(run = 0; run < n; run = i)
+        {
+            for(i = run+1; i < n && bucket[i].hash == bucket[run].hash; i++)
+                ;
+
+            for(j = run; j < i; j++)
+            {
+                unsigned int a = bucket[j].index, b, l, m, dist;
+
+                for(l = j+1; l < i; l++)
+                {
+                    b = bucket[l].index;
+
+                    /* pairs that share an earlier band were checked there */
+                    for(m = 0; m < k; m++)
+                        if(bh.hashes[(a*bh.bands)+m] == bh.hashes[(b*bh.bands)+m])
+                            break;
+                    if(m < k) continue;
+
+                    dist = glyph_distance(font->data+(a*font->charsize),
+                                          font->data+(b*font->charsize),
+                                          font->charsize);
+                    if(dist == 0 || dist > maxdist) continue;
+
+                    if(count == size)
+                    {
+                        struct similar_pair_s *tmp;
+                        size = size ? size*2 : 256;
+                        tmp = realloc(res, size*sizeof(struct similar_pair_s));
+                        if(!tmp) goto end;
+                        res = tmp;
+                    }
+
+                    res[count].a = a;
+                    res[count].b = b;
+                    res[count].dist = dist;
+                    count++;
+                }
+            }
+        }
+    }
+
+    if(count) qsort(res, count, sizeof(struct similar_pair_s), compare_pairs);
+    *pairs = res;
+    res = NULL;
+    result = count;
+
+end:
+
+    if(bh.hashes) free(bh.hashes);
+    if(bucket) free(bucket);
+    if(canon) free(canon);
+    if(res) free(res);
+    return result;
+}
+
+void find_similar_glyphs(struct font_s *font)
+{
+    struct report_s report = { NULL, 0, 0 };
+    struct similar_pair_s *pairs = NULL;
+    char s[64], *input;
+    int i, count, maxdist;
+
+    sprintf(s, "%d", DEFAULT_SIMILAR_DISTANCE);
+    input = inputBoxI("Enter the maximum number of differing pixels:",
+                      s, " Similar Glyphs ");
+    if(!input || strlen(input) == 0) return;
+
+    maxdist = atoi(input);
+    if(maxdist <= 0 || maxdist > MAX_SIMILAR_DISTANCE)
+    {
+        sprintf(s, "Invalid pixel count. Enter a number\n"
+                   "between 1 and %d.", MAX_SIMILAR_DISTANCE);
+        msgBox(s, BUTTON_OK, ERROR);
+        return;
+    }
+
+    if((count = find_glyph_near_duplicates(font, maxdist, &pairs)) < 0)
+    {
+        status_error("Insufficient memory");
+        return;
+    }
+
+    if(count == 0)
+    {
+        msgBox("No similar glyphs found.", BUTTON_OK, INFO);
+        return;
+    }
+
+    report_printf(&report, "Similar glyphs\n==============\n\n");
+    report_printf(&report, "%d pairs of glyphs differ in %d pixel(s) or less.\n\n",
+                           count, maxdist);
+
+    for(i = 0; i < count && i < MAX_REPORTED_PAIRS; i++)
+    {
+        report_printf(&report, "#%u", pairs[i].a);
+        report_unicode(&report, font, pairs[i].a);
+        report_printf(&report, "\n  ~ #%u", pairs[i].b);
+        report_unicode(&report, font, pairs[i].b);
+        report_printf(&report, "  (%u pixel%s)\n", pairs[i].dist,
+                               (pairs[i].dist == 1) ? "" : "s");
+    }
+
+    if(count > MAX_REPORTED_PAIRS)
+        report_printf(&report, "\n... and %d more pairs.\n",
+                               count-MAX_REPORTED_PAIRS);
+
+    show_report(&report, " Similar Glyphs ");
+    free_report(&report);
+    free(pairs);
+}
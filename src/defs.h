@@ -21,46 +21,41 @@
 #ifndef FONTOPIA_H
 #define FONTOPIA_H
 
-#include "font_ops.h"
-#include <string.h>
+#include "core.h"
 #include <console/dialogs.h>
 
-/* args.c */
-void parse_args(int argc, char **argv);
-void init(int argc, char **argv);
-void quit(struct font_s *font);
-
-extern char *font_file_name;
-extern FILE *font_file;
-extern char *file_data;
-extern int startup_rawfont_width;
-extern int startup_rawfont_height;
-
-/* status.c */
-void status_error(char *msg);
-void status_msg(char *msg);
-void status_clear();
-
-#define STATUS_ERROR		1
-#define STATUS_REGULAR		2
-
-/* main.c */
-void exit_gracefully();
-extern char buffer_mode_on;
-
-/* view.c */
-void refresh_view(struct font_s *font);
-void refresh_view_status_msg(char* msg, struct font_s *font);
-void refresh_view_status_error(char *msg, struct font_s *font);
-
 /* keys.c */
 void do_up(struct font_s *font);
 void do_down(struct font_s *font);
 void do_left(struct font_s *font);
 void do_right(struct font_s *font);
+void do_pgup(struct font_s *font);
+void do_pgdown(struct font_s *font);
+void do_home(struct font_s *font);
+void do_end(struct font_s *font);
+void goto_glyph(struct font_s *font, int index);
+void do_goto_glyph(struct font_s *font);
 
 /* metrics.c */
 int show_font_metrics(struct font_s *font);
+void handle_hw_change(struct font_s *font, int old_height, int old_width,
+                                           unsigned int old_length, int scale_mode);
+
+/* convert.c */
+int convert_main(int argc, char **argv);
+
+/* bench.c */
+int bench_main(int argc, char **argv);
+
+/* serve.c */
+int serve_main(int argc, char **argv);
+
+/* replay.c */
+extern int replay_frame_fd;
+int replay_main(int argc, char **argv);
+void replay_start(int fd);
+void replay_key_done();
+void replay_frame_done();
 
 /* unitab.c */
 int open_unicode_table(struct font_s *font);
@@ -68,8 +63,6 @@ void export_unitab(struct font_s *font);
 void import_unitab(struct font_s *font);
 int remove_unitab(struct font_s *font);
 
-#define MAX_UNICODE_TABLE_ENTRIES	(20)
-
 /* opensave.c */
 /* options to be passed to open/save dialog box */
 #define OPEN			(1)
@@ -18,7 +18,11 @@
  *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
  */    
 
+#include "core.h"
+#ifndef FONTOPIA_LIBRARY
 #include "defs.h"
+#include "menu.h"
+#endif
 #include "view.h"
 #include "glyph.h"
 #include "font_ops.h"
@@ -27,7 +31,8 @@
 #include "modules/psf.h"
 #include "modules/modules.h"
 #include "metadata.h"
-#include "menu.h"
+#include "ink.h"
+#include "undo.h"
 
 struct font_s *create_empty_font()
 {
@@ -88,23 +93,163 @@ int make_utf16(unsigned int *res, unsigned char *utf8)
     return utf16;
 }
 
-extern unsigned short utf_mask[];    /* view.c */
+unsigned short utf_mask[] = { 192, 224, 240 };
+
+/*
+ * Code for this function is adopted from code written by Jeff Bezanson,
+ * who kindly placed this in the public domain in 2005. Source is available from:
+ *    http://www.cprogramming.com/tutorial/unicode.html.
+ */
+int make_utf8(unsigned char *dest, unsigned int ch)
+{
+    if (ch < 0x80)
+    {
+        dest[0] = (char)ch;
+        return 1;
+    }
+
+    if (ch < 0x800)
+    {
+        dest[0] = (ch>>6) | 0xC0;
+        dest[1] = (ch & 0x3F) | 0x80;
+        return 2;
+    }
+
+    if (ch < 0x10000)
+    {
+        dest[0] = (ch>>12) | 0xE0;
+        dest[1] = ((ch>>6) & 0x3F) | 0x80;
+        dest[2] = (ch & 0x3F) | 0x80;
+        return 3;
+    }
+
+    if (ch < 0x110000)
+    {
+        dest[0] = (ch>>18) | 0xF0;
+        dest[1] = ((ch>>12) & 0x3F) | 0x80;
+        dest[2] = ((ch>>6) & 0x3F) | 0x80;
+        dest[3] = (ch & 0x3F) | 0x80;
+        return 4;
+    }
+
+    return 0;
+}
+
+/*
+ * Return the next entry in the font's unicode_info table, starting at the
+ * cursor, and move the cursor past it. PSF2 entries are converted to UTF-16
+ * and its separators to their PSF1 equivalents.
+ */
+unsigned int get_next_utf(struct font_s *font, struct utf_cursor_s *cur)
+{
+    unsigned char *unicode = font->unicode_info;
+    int array_index = cur->index;
+    unsigned short val = 0;
+    unsigned int val2 = 0;
+  
+    /*
+     * Unicode in PSF1 is stored as 16-bit UTF.
+     */
+    if(font->utf_version == VER_PSF1)
+    {
+        /*
+         * WARNING: there should be some error checking scheme to ensure
+         *          we don't trespass on other people's memory, i.e. cheking for
+         *          index-out-of-bounds error.
+         */
+        val = (unicode[array_index] | (unsigned short)(unicode[array_index+1] << 8));
+        cur->index = array_index+2;
+        return (unsigned int)val;
+    }
+    /*
+     * Unicode in PSF2 is stored as 8-bit-coded UTF.
+     */
+    else if(font->utf_version == VER_PSF2)
+    {
+        if(unicode[array_index] == PSF2_SEPARATOR)
+        {
+            val2 = (unsigned int)PSF1_SEPARATOR;
+            array_index++;
+        }
+        else if(unicode[array_index] == PSF2_STARTSEQ)
+        {
+            val2 = (unsigned int)PSF1_STARTSEQ;
+            array_index++;
+        }
+        else
+        {
+            int bytes = 1;
+            bytes = make_utf16(&val2, &unicode[array_index]);
+            array_index += bytes;
+        }
+
+        cur->index = array_index;
+        return (unsigned int)val2;
+    }
+
+    return 0;
+}
+
+/*
+ * Set up a context for loading or saving file_name. Raw fonts get the
+ * glyph size given on the command line, if any.
+ */
+void init_font_ctx(struct font_ctx_s *ctx, char *file_name)
+{
+    memset(ctx, 0, sizeof(struct font_ctx_s));
+    ctx->file_name = file_name;
+    ctx->raw_width = startup_rawfont_width;
+    ctx->raw_height = startup_rawfont_height;
+}
 
 
-int write_to_file(FILE *file, struct font_s *font)
+int write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font)
 {
+    long pos = stats_enabled ? ftell(file) : -1;
+    int res;
+
+    stats_begin(STATS_WRITE);
+
     if(!font->module->write_to_file)
     {
-        return psf_write_to_file(file, font);
+        res = psf_write_to_file(ctx, file, font);
+    }
+    else res = font->module->write_to_file(ctx, file, font);
+
+    stats_end(STATS_WRITE);
+    if(stats_enabled && pos >= 0 && ftell(file) >= pos)
+        stats_add(STATS_BYTES_WRITTEN, ftell(file)-pos);
+
+    return res;
+}
+
+/*
+ * Glyphs larger than the left window are edited through a viewport (see
+ * refresh_left_window()), but our glyph buffers can't hold more than
+ * MAX_WIDTH x MAX_HEIGHT pixels.
+ */
+static int check_font_size(struct font_s *font)
+{
+    if(font->width > MAX_WIDTH)
+    {
+        status_error("Error: Font width is larger than 64 pixels");
+        return 0;
+    }
+
+    if(font->height > MAX_HEIGHT)
+    {
+        status_error("Error: Font height is larger than 128 pixels");
+        return 0;
     }
 
-    return font->module->write_to_file(file, font);
+    return 1;
 }
 
-struct font_s *load_font_file(char *file_name)
+static struct font_s *__load_font_file(struct font_ctx_s *ctx)
 {
     FILE *font_file = (FILE *)NULL;
     char *file_data = (char *)NULL;
+    char *file_name = ctx->file_name;
     struct font_s *font = (struct font_s *)NULL;
     if(!file_name) return (struct font_s *)NULL;
 
@@ -114,29 +259,20 @@ struct font_s *load_font_file(char *file_name)
     struct module_s *mod = check_file_ext(file_name);
     if(mod)
     {
-        font = mod->load_font_file(file_name);
-
-        if(font && left_window.width < (int)font->width)
-        {
-            status_error("Error: Font width is larger than screen width");
-            //msgBox("Font width is larger than screen width.", OK, ERROR);
-            goto end;
-        }
+        font = mod->load_font_file(ctx);
 
-        if(font && left_window.height < (int)font->height)
+        if(font && !check_font_size(font))
         {
-            status_error("Error: Font height is larger than screen height");
-            //msgBox("Font height is larger than screen height.", OK, ERROR);
+            kill_font(font);
             goto end;
         }
-
-        if(font) refresh_view_status_msg(file_name, font);
         return font;
     }
 
     /*
      * try to brute-force read the file
      */
+    stats_begin(STATS_READ);
     if(!(font_file = fopen(file_name, "rb")))
     {
         status_error("Error opening file");
@@ -153,14 +289,20 @@ struct font_s *load_font_file(char *file_name)
 
     i = fread(file_data, 1, file_size, font_file);
     if(i != file_size) goto file_read_error;
+    stats_end(STATS_READ);
+    stats_add(STATS_BYTES_READ, file_size);
 
     mod = check_file_signature((unsigned char *)file_data);
     if(mod)
     {
-        font = mod->load_font(file_name, (unsigned char *)file_data, file_size);
+        font = mod->load_font(ctx, (unsigned char *)file_data, file_size);
         fclose(font_file);
         free(file_data);
-        if(font) refresh_view_status_msg(file_name, font);
+        if(font && !check_font_size(font))
+        {
+            kill_font(font);
+            return (struct font_s *)NULL;
+        }
         return font;
     }
 
@@ -173,17 +315,25 @@ struct font_s *load_font_file(char *file_name)
         mod = get_module_by_name("raw");
         if(mod)
         {
-            font = mod->load_font(file_name, (unsigned char *)file_data, file_size);
+            font = mod->load_font(ctx, (unsigned char *)file_data, file_size);
             if(font)
             {
                 fclose(font_file);
                 free(file_data);
+                if(!check_font_size(font))
+                {
+                    kill_font(font);
+                    return (struct font_s *)NULL;
+                }
+#ifndef FONTOPIA_LIBRARY
+                if(headless) return font;
                 setScreenColors(WHITE, BGDEFAULT);
                 drawBox(1, 1, SCREEN_H, SCREEN_W, " Fontopia for GNU/Linux ", 0);
                 /* not an error per se, but to get user's attention!! */
                 status_error("Assuming a RAW font. If it is NOT, close it NOW!");
                 refresh_left_window(font);
                 refresh_right_window(font);
+#endif
                 return font;
             }
         }
@@ -216,6 +366,64 @@ end:
     return (struct font_s *)NULL;
 }
 
+/*
+ * The time spent here that the modules don't put in another phase
+ * (reading, decoding the bitmaps...) is the parse phase.
+ */
+struct font_s *load_font_file(struct font_ctx_s *ctx)
+{
+    struct font_s *font;
+
+    stats_begin(STATS_PARSE);
+    font = __load_font_file(ctx);
+    stats_end(STATS_PARSE);
+    if(font) stats_add(STATS_GLYPHS, font->length);
+
+    return font;
+}
+
+/*
+ * Load a font from a file that has already been read into memory. The file
+ * name in the context is only used as a hint, to find the module by the file
+ * extension, or the glyph size of raw fonts. The caller keeps file_data.
+ */
+struct font_s *load_font_data(struct font_ctx_s *ctx, unsigned char *file_data, long file_size)
+{
+    char *file_name = ctx->file_name;
+    struct module_s *mod = (struct module_s *)NULL;
+    struct font_s *font;
+
+    if(file_size <= 0)
+    {
+        status_error("Error: empty file!");
+        return (struct font_s *)NULL;
+    }
+
+    if(file_name) mod = check_file_ext(file_name);
+    if(!mod) mod = check_file_signature(file_data);
+    if(!mod && raw_acceptable_filesize(file_size)) mod = get_module_by_name("raw");
+
+    if(!mod)
+    {
+        status_error("Unknown font format");
+        return (struct font_s *)NULL;
+    }
+
+    stats_begin(STATS_PARSE);
+    font = mod->load_font(ctx, file_data, file_size);
+    stats_end(STATS_PARSE);
+    if(!font) return (struct font_s *)NULL;
+    stats_add(STATS_GLYPHS, font->length);
+
+    if(!check_font_size(font))
+    {
+        kill_font(font);
+        return (struct font_s *)NULL;
+    }
+
+    return font;
+}
+
 void get_font_unicode_table(struct font_s *font)
 {
     if(!font->has_unicode_table)
@@ -225,8 +433,9 @@ void get_font_unicode_table(struct font_s *font)
 
     int i = 0;
     unsigned int c = 0;
-    font->unicode_array_index = 0;
-    font->unicode_index = 0;
+    struct utf_cursor_s cur = { 0 };
+
+    stats_begin(STATS_UNITAB);
 
     do
     {
@@ -235,7 +444,7 @@ void get_font_unicode_table(struct font_s *font)
          * unicode_table_index will be 0xFFFFFFFF, and unicode_table
          * entry will be a pointer to malloc'ed memory containing this info.
          */
-        c = get_next_utf(font);
+        c = get_next_utf(font, &cur);
 
         if(c == PSF1_SEPARATOR)
         {
@@ -250,15 +459,17 @@ void get_font_unicode_table(struct font_s *font)
              */
             do
             {
-                c = get_next_utf(font);
+                c = get_next_utf(font, &cur);
             } while(c != PSF1_SEPARATOR);
             i++;
             continue;
         }
         else
         {
-            /* normal storage */
-            if(font->unicode_table_index[i] == 0)
+            /* normal storage. glyph 0xFFFF can't use it, as its index
+             * would look like the multiple entries marker.
+             */
+            if(font->unicode_table_index[i] == 0 && (unsigned short)i != 0xFFFF)
             {
                 font->unicode_table_index[i] = (unsigned short)i;
                 font->unicode_table[(i)*2] = c;
@@ -294,20 +505,144 @@ void get_font_unicode_table(struct font_s *font)
             unsigned int *arr = 0;
             get_unitab_entry(font, i, &arr);
 
-            int j = 0;
-            do
+            /* keep the last entry zero to terminate the array */
+            int j;
+            for(j = 0; j < MAX_UNICODE_TABLE_ENTRIES-1; j++)
             {
                 if(arr[j] == 0)
                 {
                     arr[j] = c; break;
                 }
-            } while(j++ < MAX_UNICODE_TABLE_ENTRIES);
+            }
             //i--;
         }
     } while(i < (int)font->length);
+
+    stats_end(STATS_UNITAB);
+}
+
+
+static int cpmap_cmp(const void *p1, const void *p2)
+{
+    const struct cpmap_s *m1 = p1, *m2 = p2;
+
+    if(m1->cp != m2->cp) return (m1->cp < m2->cp) ? -1 : 1;
+    return (m1->glyph < m2->glyph) ? -1 : (m1->glyph > m2->glyph);
+}
+
+/*
+ * Make a sorted list of the glyph encodings of a font without a unicode
+ * table (PCF fonts), see get_cpmap().
+ */
+static int get_encoding_cpmap(struct font_s *font, struct cpmap_s **map)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    unsigned int i, count = 0;
+    struct cpmap_s *m;
+
+    if(!(m = (struct cpmap_s *)malloc((font->length+1)*sizeof(struct cpmap_s))))
+        return -1;
+
+    for(i = 0; i < font->length; i++)
+    {
+        if(char_info[i].encoding < 0) continue;
+        m[count].cp = char_info[i].encoding;
+        m[count++].glyph = i;
+    }
+
+    qsort(m, count, sizeof(struct cpmap_s), cpmap_cmp);
+    *map = m;
+    return count;
+}
+
+/*
+ * Make a sorted list of the unicode values in the font and the glyphs
+ * they map to, from the unicode table, or from the glyph encodings if the
+ * font has no unicode table. Fonts with neither get no list (see
+ * find_cpmap_glyph()). Returns the list length, or -1 on memory error.
+ */
+int get_cpmap(struct font_s *font, struct cpmap_s **map)
+{
+    unsigned int i, count = 0, size = font->length+1;
+    struct cpmap_s *m;
+
+    *map = NULL;
+    if(!font->has_unicode_table || !font->unicode_table)
+        return font->char_info ? get_encoding_cpmap(font, map) : 0;
+    if(!(m = (struct cpmap_s *)malloc(size*sizeof(struct cpmap_s)))) return -1;
+
+    for(i = 0; i < font->length; i++)
+    {
+        unsigned int *arr = 0, single;
+        int j, n = 0;
+
+        if(font->unicode_table_index[i] == 0xFFFF)
+        {
+            get_unitab_entry(font, i, &arr);
+            while(n < MAX_UNICODE_TABLE_ENTRIES && arr[n]) n++;
+        }
+        else if(font->unicode_table_index[i] == (unsigned short)i &&
+                (i || font->unicode_table[0]))
+        {
+            single = font->unicode_table[i*2];
+            arr = &single;
+            n = 1;
+        }
+
+        for(j = 0; j < n; j++)
+        {
+            if(count == size)
+            {
+                struct cpmap_s *tmp = realloc(m, size*2*sizeof(struct cpmap_s));
+                if(!tmp) { free(m); return -1; }
+                m = tmp;
+                size *= 2;
+            }
+
+            m[count].cp = arr[j];
+            m[count++].glyph = i;
+        }
+    }
+
+    qsort(m, count, sizeof(struct cpmap_s), cpmap_cmp);
+    *map = m;
+    return count;
+}
+
+/*
+ * Find the glyph of a unicode value in a list made by get_cpmap(). Returns
+ * NO_GLYPH if the font doesn't have it.
+ */
+unsigned int find_cpmap_glyph(struct font_s *font, struct cpmap_s *map,
+                              int count, unsigned int cp)
+{
+    int lo = 0, hi = count-1;
+
+    /* fonts without a unicode table or glyph encodings are indexed by the
+     * char value */
+    if(!map) return (cp < font->length) ? cp : NO_GLYPH;
+
+    while(lo <= hi)
+    {
+        int mid = (lo+hi)/2;
+
+        if(map[mid].cp == cp)
+        {
+            /* take the lowest glyph if there are more than one */
+            while(mid > 0 && map[mid-1].cp == cp) mid--;
+            return map[mid].glyph;
+        }
+
+        if(map[mid].cp < cp) lo = mid+1;
+        else hi = mid-1;
+    }
+
+    return NO_GLYPH;
 }
 
 
+#ifndef FONTOPIA_LIBRARY
+
 void font_toggle_active_bit(struct font_s *font)
 {
     int linebytes = font->width/8;
@@ -318,11 +653,15 @@ void font_toggle_active_bit(struct font_s *font)
     byteindex += glyph;
     byteindex += (int)((w-left_window.cursor.col-1)/8);
     int bitindex  = 1 << ((w - left_window.cursor.col - 1) % 8);
+    undo_begin_glyphs(font, glyph/font->charsize, 1);
     font->data[byteindex] ^= (char)bitindex;
+    undo_end(font);
     if(font->state == NEW || font->state == NEW_MODIFIED) font->state = NEW_MODIFIED;
     else font->state = MODIFIED;
 }
 
+#endif      /* FONTOPIA_LIBRARY */
+
 
 void free_unicode_table(struct font_s *font)
 {
@@ -346,8 +685,11 @@ void free_unicode_table(struct font_s *font)
     font->unicode_table_index = 0;
 }
 
+#ifndef FONTOPIA_LIBRARY
+
 int check_font_saved(struct font_s *font, int alert_user)
 {
+    struct font_ctx_s ctx;
     FILE *save;
     int res;
     char *buf;
@@ -396,7 +738,8 @@ save_only:
                 goto error;
             }
 
-            res = write_to_file(save, font);
+            init_font_ctx(&ctx, font_file_name);
+            res = write_to_file(&ctx, save, font);
             fclose(save);
             free(file_name2);
             if(res) goto error;
@@ -406,7 +749,8 @@ save_only:
 
         /* write to original file */
         if(!(save = fopen(font_file_name, "wb+"))) goto error;
-        res = write_to_file(save, font);
+        init_font_ctx(&ctx, font_file_name);
+        res = write_to_file(&ctx, save, font);
         fclose(save);
         if(res) goto error;
     }
@@ -432,11 +776,10 @@ error:
     return 1;
 }
 
+#endif      /* FONTOPIA_LIBRARY */
+
 void kill_font(struct font_s *font)
 {
-    if(font_file_name) free(font_file_name);
-    font_file_name = (char *)NULL;
-
     if(font)
     {
         //free(font->raw_data);
@@ -464,6 +807,7 @@ void kill_font(struct font_s *font)
             }
         }
 
+        if(font->metadata) free(font->metadata);
         if(font->char_info) free(font->char_info);
         free(font);
     }
@@ -510,9 +854,13 @@ int create_char_info(struct font_s* font)
         char_info[sz].swidthY     = 0;
     }
 
+    /* shrink the BBX of glyphs we already have to their ink */
+    set_font_ink_metrics(font);
     return 1;
 }
 
+#ifndef FONTOPIA_LIBRARY
+
 struct font_s *new_font_file(struct font_s *font)
 {
     int res = check_font_saved(font, 1);
@@ -545,6 +893,7 @@ struct font_s *new_font_file(struct font_s *font)
     if(!f) return (struct font_s *)NULL;
 
     kill_font(font);
+    undo_clear();
     if(font_file_name) free(font_file_name);
     font_file_name = 0;
     return f;
@@ -566,13 +915,20 @@ struct font_s *open_font_file(struct font_s *font)
     }
     else if(res == OPENSAVE_CANCEL) return font;
   
-    struct font_s *f = load_font_file(buf);
+    struct font_ctx_s ctx;
+    init_font_ctx(&ctx, buf);
+    struct font_s *f = load_font_file(&ctx);
 
     if(f)
     {
         kill_font(font);
+        undo_clear();
         if(font_file_name) free(font_file_name);
         font_file_name = buf;
+        stats_begin(STATS_VIEW);
+        calc_max_zoom(f);
+        reset_all_cursors();
+        stats_end(STATS_VIEW);
         return f;
     }
 
@@ -610,9 +966,103 @@ struct font_s *save_font_file(struct font_s *font, int force_new)
     return font;
 }
 
+#endif      /* FONTOPIA_LIBRARY */
+
 void force_font_dirty(struct font_s *font)
 {
     if(font->state == NEW || font->state == NEW_MODIFIED) font->state = NEW_MODIFIED;
     else font->state = MODIFIED;
 }
 
+/*
+ * Remove the unicode table, without telling anyone (see remove_unitab()).
+ */
+void discard_unicode_table(struct font_s *font)
+{
+    free_unicode_table(font);
+    font->has_unicode_table = 0;
+    font->unicode_table_index = 0;
+    font->unicode_table = 0;
+    free(font->unicode_info);
+    font->unicode_info = 0;
+    font->unicode_info_size = 0;
+    if(font->module->update_font_hdr) font->module->update_font_hdr(font);
+    force_font_dirty(font);
+}
+
+void handle_version_change(struct font_s *font, char old_version)
+{
+    if(font->version == old_version) return;
+
+    char ver = font->version;
+    if(ver > VER_PSF2) font->version = VER_PSF1;
+    font->module->convert_to_psf(font);
+    if(ver > VER_PSF2) font->version = ver;
+
+    struct module_s *newmod = (struct module_s *)NULL;
+    if(font->version <= 2)
+        newmod = get_module_by_name("psf");
+    else
+        newmod = get_module_by_name(get_version_str(font->version));
+
+    if(!newmod) return;
+    font->module = newmod;
+    if(font->version > VER_PSF2)
+        font->module->handle_version_change(font, old_version);
+    force_font_dirty(font);
+}
+
+/*
+ * Convert the font to another format, after checking the new format can
+ * hold it (the same way the metrics window does). Returns 0 if it can't.
+ */
+int convert_font_version(struct font_s *font, int version)
+{
+    char old_version = font->version;
+    struct module_s *mod;
+    char msg[128];
+
+    if(version == font->version) return 1;
+
+    mod = get_module_by_name(version < 3 ? "psf" : get_version_str(version));
+    if(!mod)
+    {
+        status_error("No module for this font format");
+        return 0;
+    }
+
+    font->version = version;
+
+    if(!mod->is_acceptable_width(font) || !mod->is_acceptable_height(font))
+    {
+        sprintf(msg, "%s does not support %ux%u glyphs",
+                get_version_str(version), font->width, font->height);
+        goto error;
+    }
+
+    /* PSF2 has no limit on the glyph count, the PSF module's limit is for PSF1 */
+    if((version != VER_PSF2 && font->length > mod->max_length) ||
+       (version == VER_PSF1 && font->length != 256 && font->length != 512))
+    {
+        sprintf(msg, "%s does not support fonts with %u glyphs",
+                get_version_str(version), font->length);
+        goto error;
+    }
+
+    /* CP and raw fonts can't have a unicode table */
+    if(font->has_unicode_table && (version == VER_CP || version == VER_RAW))
+    {
+        font->version = old_version;
+        discard_unicode_table(font);
+        font->version = version;
+    }
+
+    handle_version_change(font, old_version);
+    return 1;
+
+error:
+
+    font->version = old_version;
+    status_error(msg);
+    return 0;
+}
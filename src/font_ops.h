@@ -68,6 +68,65 @@ static inline char reverse_char(char c)
     return c2;
 }
 
+//Reverse the order of bits in a 64-bit word.
+static inline uint64_t reverse_qword(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+    return (x >> 32) | (x << 32);
+}
+
+/*
+ * Glyph rows are stored in memory as little-endian integers of
+ * (width+7)/8 bytes, with the leftmost pixel in the most significant bit
+ * (this is how font_toggle_active_bit() addresses them). The following
+ * helpers read and write one row as a 64-bit word, which is enough for
+ * MAX_WIDTH pixels.
+ */
+static inline uint64_t get_glyph_row(unsigned char *row, int bytes)
+{
+    uint64_t line = 0;
+    int i;
+
+    for(i = 0; i < bytes; i++) line |= (uint64_t)row[i] << (i*8);
+
+    return line;
+}
+
+static inline void put_glyph_row(unsigned char *row, int bytes, uint64_t line)
+{
+    int i;
+
+    for(i = 0; i < bytes; i++)
+    {
+        row[i] = (unsigned char)(line & 0xFF);
+        line >>= 8;
+    }
+}
+
+/*
+ * Row kernels that shift pixels around find it easier to keep rows aligned
+ * to the most significant bit of the word, i.e. pixel x is at bit 63-x,
+ * whatever the glyph width is. Padding bits are masked out on load.
+ */
+static inline uint64_t glyph_row_mask(int width)
+{
+    return (width >= 64) ? ~0ULL : ~(~0ULL >> width);
+}
+
+static inline uint64_t load_glyph_row(unsigned char *row, int bytes, uint64_t mask)
+{
+    return (get_glyph_row(row, bytes) << (64-(bytes*8))) & mask;
+}
+
+static inline void store_glyph_row(unsigned char *row, int bytes, uint64_t line)
+{
+    put_glyph_row(row, bytes, line >> (64-(bytes*8)));
+}
+
 
 enum file_state
 {
@@ -79,7 +138,7 @@ struct font_s
     unsigned int length;            /* # of glyphs in font */
     unsigned char has_unicode_table;
 #define MAX_WIDTH       64
-#define MAX_HEIGHT      64
+#define MAX_HEIGHT      128
     unsigned int height,            /* height of glyph */
              width,            /* width of glyph in bits */
              charsize;            /* # of bytes occupied by glyph */
@@ -94,7 +153,6 @@ struct font_s
     unsigned char *data;            /* pointer to glyph data */
     unsigned char *unicode_info;        /* pointer to unicode info at end of font file */
     unsigned int unicode_info_size;
-    int unicode_index, unicode_array_index;    /* used internally by viewing routines in view.c */
     char current_zoom;
     char max_zoom;
     enum file_state state;
@@ -124,6 +182,29 @@ struct font_s
 };
 
 
+/*
+ * State for loading or saving one font. The format modules keep everything
+ * they need while parsing or writing a file here instead of in globals, so
+ * several fonts can be loaded and saved at once on different threads, as
+ * long as each one has its own context. Set it up with init_font_ctx().
+ */
+struct font_ctx_s
+{
+    char *file_name;            /* the file being loaded or saved */
+    int raw_width, raw_height;  /* glyph size of raw fonts, 0 if not known */
+    /* BDF parser state */
+    char *next_line;            /* strtok_r() position */
+    unsigned long long keyword_bitmap;
+    char buf[512];
+};
+
+/* position in the unicode_info table, for get_next_utf() */
+struct utf_cursor_s
+{
+    int index;
+};
+
+
 struct char_info_s {
     // for BDF fonts
     int encoding;
@@ -158,7 +239,8 @@ static inline void get_unitab_entry(struct font_s *font, int i, unsigned int **a
 
 void get_font_unicode_table(struct font_s *font);
 void font_toggle_active_bit(struct font_s *font);
-int write_to_file(FILE *file, struct font_s *font);
+void init_font_ctx(struct font_ctx_s *ctx, char *file_name);
+int write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font);
 void free_unicode_table(struct font_s *font);
 void kill_font(struct font_s *font);
 struct font_s *new_font_file(struct font_s *font);
@@ -166,11 +248,29 @@ struct font_s *open_font_file(struct font_s *font);
 struct font_s *save_font_file(struct font_s *font, int force_new);
 int check_font_saved(struct font_s *font, int alert_user);
 
-struct font_s *load_font_file(char* file_name);
+struct font_s *load_font_file(struct font_ctx_s *ctx);
 struct font_s *create_empty_font();
 void force_font_dirty(struct font_s *font);
 int create_empty_unitab(struct font_s *font);
 int make_utf16(unsigned int *res, unsigned char *utf8);
+int make_utf8(unsigned char* dest, unsigned int ch);
+unsigned int get_next_utf(struct font_s *font, struct utf_cursor_s *cur);
 int create_char_info(struct font_s *font);
+struct font_s *load_font_data(struct font_ctx_s *ctx, unsigned char *file_data, long file_size);
+void discard_unicode_table(struct font_s *font);
+void handle_version_change(struct font_s *font, char old_version);
+int convert_font_version(struct font_s *font, int version);
+
+/* unicode values and the glyphs they map to, sorted by unicode value */
+struct cpmap_s
+{
+    unsigned int cp, glyph;
+};
+
+#define NO_GLYPH                ((unsigned int)-1)
+
+int get_cpmap(struct font_s *font, struct cpmap_s **map);
+unsigned int find_cpmap_glyph(struct font_s *font, struct cpmap_s *map,
+                              int count, unsigned int cp);
 
 #endif
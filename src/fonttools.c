@@ -0,0 +1,500 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: fonttools.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <stdarg.h>
+#include "defs.h"
+#include "view.h"
+#include "menu.h"
+#include "glyph.h"
+#include "ink.h"
+#include "fonttools.h"
+#include "undo.h"
+#include "modules/psf.h"
+
+/***********************************
+ * Font-wide tools
+ ***********************************/
+char *fonttools_text[] =
+{
+    "Find duplicate glyphs",
+    "Find similar glyphs",
+    "Subset font from a text file",
+    "Subset font from a codepoint list",
+    "Merge glyphs from other fonts",
+    "Trim empty rows",
+    "Preview sample text",
+    "Preview whole font",
+    "Preview current glyph",
+};
+int fonttools_text_len = sizeof(fonttools_text)/sizeof(char *);
+
+void (*fonttools_funcs[])(struct font_s *font) =
+{
+    find_duplicate_glyphs,
+    find_similar_glyphs,
+    subset_font_from_text,
+    subset_font_from_list,
+    merge_fonts_from_files,
+    trim_empty_rows,
+    preview_sample_text,
+    preview_whole_font,
+    preview_current_glyph,
+};
+
+
+void show_font_tools(struct font_s *font)
+{
+    int i = show_menu(fonttools_text, fonttools_text_len, 
+                      "Font Tools", 0, 0, 0, 0);
+    if(i >= 0)
+    {
+        fonttools_funcs[i](font);
+    }
+    refresh_view_status_msg(font_file_name, font);
+}
+
+int report_printf(struct report_s *report, char *fmt, ...)
+{
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if(len < 0) return 0;
+
+    if(report->len+len+1 > report->size)
+    {
+        size_t size = report->size ? report->size : 4096;
+        char *text;
+
+        while(report->len+len+1 > size) size *= 2;
+        if(!(text = realloc(report->text, size))) return 0;
+        report->text = text;
+        report->size = size;
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(report->text+report->len, len+1, fmt, ap);
+    va_end(ap);
+    report->len += len;
+    return 1;
+}
+
+/* add the unicode values mapped to the given glyph to the report */
+void report_unicode(struct report_s *report, struct font_s *font, int gindex)
+{
+    if(!font->has_unicode_table || !font->unicode_table) return;
+
+    if(font->unicode_table_index[gindex] == 0xFFFF)
+    {
+        unsigned int *arr = 0;
+        int j;
+
+        get_unitab_entry(font, gindex, &arr);
+        for(j = 0; j < MAX_UNICODE_TABLE_ENTRIES && arr[j]; j++)
+            report_printf(report, " U+%04x", arr[j]);
+    }
+    else if(font->unicode_table_index[gindex] == (unsigned short)gindex &&
+            (gindex || font->unicode_table[0]))
+    {
+        report_printf(report, " U+%04x", font->unicode_table[gindex*2]);
+    }
+}
+
+/* add len bytes to the report, which need not be text */
+int report_write(struct report_s *report, char *buf, size_t len)
+{
+    if(report->len+len+1 > report->size)
+    {
+        size_t size = report->size ? report->size : 4096;
+        char *text;
+
+        while(report->len+len+1 > size) size *= 2;
+        if(!(text = realloc(report->text, size))) return 0;
+        report->text = text;
+        report->size = size;
+    }
+
+    memcpy(report->text+report->len, buf, len);
+    report->len += len;
+    report->text[report->len] = '\0';
+    return 1;
+}
+
+void show_report(struct report_s *report, char *title)
+{
+    if(!report->text) return;
+    fontopia_show_readme(report->text, title);
+}
+
+void free_report(struct report_s *report)
+{
+    if(report->text) free(report->text);
+    report->text = NULL;
+    report->len = 0;
+    report->size = 0;
+}
+
+/*
+ * Read the unicode values of all the glyphs into one array. The values of
+ * glyph i are (*cps)[(*start)[i]] up to (*start)[i+1], where a sequence is
+ * introduced by PSF1_STARTSEQ. Returns 0 on memory error.
+ */
+int read_unicode_values(struct font_s *font, unsigned int **cps,
+                        unsigned int **start)
+{
+    unsigned int count = 0, size = 1024;
+    unsigned int i = 0, c;
+
+    *cps = (unsigned int *)malloc(size*sizeof(unsigned int));
+    *start = (unsigned int *)malloc((font->length+1)*sizeof(unsigned int));
+    if(!*cps || !*start) goto memory_error;
+
+    (*start)[0] = 0;
+
+    if(!font->has_unicode_table || !font->unicode_info)
+    {
+        for(i = 1; i <= font->length; i++) (*start)[i] = 0;
+        return 1;
+    }
+
+    struct utf_cursor_s cur = { 0 };
+
+    while(i < font->length)
+    {
+        /* don't run past the end of a broken table */
+        if(cur.index >= (int)font->unicode_info_size)
+        {
+            (*start)[++i] = count;
+            continue;
+        }
+
+        c = get_next_utf(font, &cur);
+
+        if(c == PSF1_SEPARATOR)
+        {
+            (*start)[++i] = count;
+            continue;
+        }
+
+        if(count == size)
+        {
+            unsigned int *tmp = realloc(*cps, size*2*sizeof(unsigned int));
+            if(!tmp) goto memory_error;
+            *cps = tmp;
+            size *= 2;
+        }
+
+        (*cps)[count++] = c;
+    }
+
+    return 1;
+
+memory_error:
+
+    if(*cps) free(*cps);
+    if(*start) free(*start);
+    *cps = NULL;
+    *start = NULL;
+    return 0;
+}
+
+static inline int cp_wanted(uint64_t *filter, unsigned int c)
+{
+    if(!filter) return 1;
+    if(c >= MAX_CODEPOINT) return 0;
+    return (filter[c/64] >> (c%64)) & 1;
+}
+
+/*
+ * Write the unicode values cps[from] up to cps[to] in PSF2 format. Pass 0
+ * writes the single values and pass 1 writes the sequences, as a glyph's
+ * sequences have to come after all of its single values. Returns the
+ * number of bytes written.
+ */
+static long encode_unicode_values(unsigned char *unicode, unsigned int *cps,
+                                  unsigned int from, unsigned int to,
+                                  uint64_t *filter, int pass)
+{
+    unsigned int j, j2;
+    long len = 0;
+
+    for(j = from; j < to && cps[j] != PSF1_STARTSEQ; j++)
+    {
+        if(pass == 0 && cp_wanted(filter, cps[j]))
+            len += make_utf8(unicode+len, cps[j]);
+    }
+
+    while(pass == 1 && j < to)
+    {
+        int ok = 1;
+
+        /* j is at PSF1_STARTSEQ, find where this sequence ends */
+        for(j2 = j+1; j2 < to && cps[j2] != PSF1_STARTSEQ; j2++)
+            if(!cp_wanted(filter, cps[j2])) ok = 0;
+
+        if(ok)
+        {
+            unicode[len++] = PSF2_STARTSEQ;
+            for(j++; j < j2; j++) len += make_utf8(unicode+len, cps[j]);
+        }
+
+        j = j2;
+    }
+
+    return len;
+}
+
+/*
+ * Rebuild the font so that it has new_length glyphs, where old glyph i
+ * goes to new glyph remap[i] (or is dropped if remap[i] is -1). If more
+ * than one old glyph goes to the same new glyph, the new glyph takes the
+ * bitmap of the first one and the unicode values of all of them. New
+ * glyphs nobody maps to are left empty. If filter is not NULL, only the
+ * unicode values set in it are kept (sequences are kept if all of their
+ * values are set). The unicode table is written in PSF2 format.
+ * Returns 0 on memory error, in which case the font is not changed.
+ */
+int remap_font_glyphs(struct font_s *font, int *remap,
+                      unsigned int new_length, uint64_t *filter)
+{
+    unsigned int *cps = NULL, *start = NULL, *next = NULL, *first = NULL;
+    unsigned char *unicode = NULL, *data = NULL;
+    struct char_info_s *char_info = NULL;
+    unsigned int i, k;
+    long len = 0;
+
+    if(!read_unicode_values(font, &cps, &start)) goto memory_error;
+    next = (unsigned int *)malloc(font->length*sizeof(unsigned int));
+    first = (unsigned int *)malloc(new_length*sizeof(unsigned int));
+    data = (unsigned char *)malloc(new_length*font->charsize);
+    unicode = (unsigned char *)malloc((start[font->length]*4)+new_length+1);
+    if(!next || !first || !data || !unicode) goto memory_error;
+
+    if(font->char_info)
+    {
+        char_info = (struct char_info_s *)malloc(new_length*sizeof(struct char_info_s));
+        if(!char_info) goto memory_error;
+        memset(char_info, 0, new_length*sizeof(struct char_info_s));
+    }
+
+    /* link the old glyphs of each new glyph together, in index order */
+    for(k = 0; k < new_length; k++) first[k] = font->length;
+
+    for(i = font->length; i-- > 0; )
+    {
+        if(remap[i] < 0 || remap[i] >= (int)new_length) continue;
+        next[i] = first[remap[i]];
+        first[remap[i]] = i;
+    }
+
+    memset(data, 0, new_length*font->charsize);
+
+    for(k = 0; k < new_length; k++)
+    {
+        unsigned int g, pass;
+
+        if(first[k] < font->length)
+        {
+            memcpy(data+(k*font->charsize), font->data+(first[k]*font->charsize),
+                   font->charsize);
+            if(char_info)
+                char_info[k] = ((struct char_info_s *)font->char_info)[first[k]];
+        }
+
+        /* single values of all the glyphs go first, then the sequences */
+        for(pass = 0; pass < 2; pass++)
+        {
+            for(g = first[k]; g < font->length; g = next[g])
+                len += encode_unicode_values(unicode+len, cps, start[g], start[g+1],
+                                             filter, pass);
+        }
+
+        unicode[len++] = PSF2_SEPARATOR;
+    }
+
+    /* now swap them in */
+    undo_begin_font(font);
+    free_unicode_table(font);
+    free(font->data);
+    font->data = data;
+    font->length = new_length;
+    font->data_size = new_length*font->charsize;
+
+    if(char_info)
+    {
+        free(font->char_info);
+        font->char_info = char_info;
+        font->char_info_size = new_length*sizeof(struct char_info_s);
+    }
+
+    if(font->has_unicode_table)
+    {
+        free(font->unicode_info);
+        font->unicode_info = unicode;
+        font->unicode_info_size = len;
+        font->utf_version = VER_PSF2;
+
+        if(!create_empty_unitab(font))
+        {
+            status_error("Insufficient memory");
+            font->has_unicode_table = 0;
+        }
+        else get_font_unicode_table(font);
+    }
+    else free(unicode);
+
+    if(font->module->update_font_hdr) font->module->update_font_hdr(font);
+
+    /* the cursor and selection might now be past the end of the font */
+    clear_glyph_selection();
+    right_window.first_vis_row = 0;
+    reset_all_cursors();
+    calc_max_zoom(font);
+    force_font_dirty(font);
+    undo_end(font);
+
+    free(cps);
+    free(start);
+    free(next);
+    free(first);
+    return 1;
+
+memory_error:
+
+    if(cps) free(cps);
+    if(start) free(start);
+    if(next) free(next);
+    if(first) free(first);
+    if(data) free(data);
+    if(unicode) free(unicode);
+    if(char_info) free(char_info);
+    status_error("Insufficient memory");
+    return 0;
+}
+
+/*
+ * Add count glyphs to the end of the font. data holds their bitmaps (in
+ * the font's metrics), and the unicode values of new glyph k are
+ * cps[start[k]] up to cps[start[k+1]]. The font should have a unicode
+ * table, which is rewritten in PSF2 format.
+ * Returns 0 on memory error, in which case the font is not changed.
+ */
+int append_font_glyphs(struct font_s *font, unsigned int count,
+                       unsigned char *data, unsigned int *new_cps,
+                       unsigned int *new_start)
+{
+    unsigned int *cps = NULL, *start = NULL;
+    unsigned char *unicode = NULL, *new_data;
+    unsigned int new_length = font->length+count;
+    unsigned int i, pass;
+    long len = 0;
+
+    if(!read_unicode_values(font, &cps, &start)) goto memory_error;
+    unicode = (unsigned char *)malloc(((start[font->length]+new_start[count])*4)+
+                                      new_length+1);
+    if(!unicode) goto memory_error;
+
+    for(i = 0; i < font->length; i++)
+    {
+        for(pass = 0; pass < 2; pass++)
+            len += encode_unicode_values(unicode+len, cps, start[i], start[i+1],
+                                         NULL, pass);
+        unicode[len++] = PSF2_SEPARATOR;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        for(pass = 0; pass < 2; pass++)
+            len += encode_unicode_values(unicode+len, new_cps, new_start[i],
+                                         new_start[i+1], NULL, pass);
+        unicode[len++] = PSF2_SEPARATOR;
+    }
+
+    undo_begin_font(font);
+
+    /* the glyphs past font->length are not used until we are done */
+    new_data = realloc(font->data, new_length*font->charsize);
+    if(!new_data) goto memory_error;
+    font->data = new_data;
+    memcpy(new_data+(font->length*font->charsize), data, count*font->charsize);
+
+    if(font->char_info)
+    {
+        struct char_info_s *char_info;
+
+        char_info = realloc(font->char_info, new_length*sizeof(struct char_info_s));
+        if(!char_info) goto memory_error;
+        font->char_info = char_info;
+        font->char_info_size = new_length*sizeof(struct char_info_s);
+
+        /* the same defaults create_char_info() uses */
+        for(i = font->length; i < new_length; i++)
+        {
+            struct char_info_s *c = &char_info[i];
+            unsigned int k = i-font->length;
+
+            memset(c, 0, sizeof(struct char_info_s));
+            c->encoding = (new_start[k] < new_start[k+1]) ? (int)new_cps[new_start[k]] : -1;
+            c->dwidthX = font->width;
+            c->rBearing = font->width;
+            c->charAscent = font->height;
+            c->BBw = font->width;
+            c->BBh = font->height;
+            c->swidthX = 1000;
+        }
+    }
+
+    /* now swap them in */
+    free_unicode_table(font);
+    free(font->unicode_info);
+    font->length = new_length;
+    font->data_size = new_length*font->charsize;
+    font->unicode_info = unicode;
+    font->unicode_info_size = len;
+    font->utf_version = VER_PSF2;
+    font->has_unicode_table = 1;
+
+    if(!create_empty_unitab(font))
+    {
+        status_error("Insufficient memory");
+        font->has_unicode_table = 0;
+    }
+    else get_font_unicode_table(font);
+
+    if(font->module->update_font_hdr) font->module->update_font_hdr(font);
+    calc_max_zoom(font);
+    force_font_dirty(font);
+    undo_end(font);
+
+    free(cps);
+    free(start);
+    return 1;
+
+memory_error:
+
+    undo_cancel();
+    if(cps) free(cps);
+    if(start) free(start);
+    if(unicode) free(unicode);
+    status_error("Insufficient memory");
+    return 0;
+}
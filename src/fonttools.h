@@ -0,0 +1,77 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: fonttools.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef FONTTOOLS_H
+#define FONTTOOLS_H
+
+#include "font_ops.h"
+
+/* text reports produced by the font tools, shown in a readme window */
+struct report_s
+{
+    char *text;
+    size_t len, size;
+};
+
+/* a pair of glyphs that differ in dist pixels */
+struct similar_pair_s
+{
+    unsigned int a, b, dist;
+};
+
+/* the biggest unicode value + 1 */
+#define MAX_CODEPOINT               (0x110000)
+
+/* fonttools.c */
+void show_font_tools(struct font_s *font);
+int report_printf(struct report_s *report, char *fmt, ...);
+int report_write(struct report_s *report, char *buf, size_t len);
+void report_unicode(struct report_s *report, struct font_s *font, int gindex);
+void show_report(struct report_s *report, char *title);
+void free_report(struct report_s *report);
+int read_unicode_values(struct font_s *font, unsigned int **cps,
+                        unsigned int **start);
+int remap_font_glyphs(struct font_s *font, int *remap,
+                      unsigned int new_length, uint64_t *filter);
+int append_font_glyphs(struct font_s *font, unsigned int count,
+                       unsigned char *data, unsigned int *new_cps,
+                       unsigned int *new_start);
+
+/* dedup.c */
+int find_glyph_duplicates(struct font_s *font, unsigned int *canon);
+void find_duplicate_glyphs(struct font_s *font);
+int find_glyph_near_duplicates(struct font_s *font, unsigned int maxdist,
+                               struct similar_pair_s **pairs);
+void find_similar_glyphs(struct font_s *font);
+
+/* subset.c */
+void subset_font_from_text(struct font_s *font);
+void subset_font_from_list(struct font_s *font);
+
+/* merge.c */
+int merge_fonts(struct font_s *font, struct font_s **src, int src_count);
+void merge_fonts_from_files(struct font_s *font);
+
+/* preview.c */
+void preview_sample_text(struct font_s *font);
+void preview_whole_font(struct font_s *font);
+void preview_current_glyph(struct font_s *font);
+
+#endif
@@ -21,6 +21,7 @@
 #include "defs.h"
 #include "view.h"
 #include "glyph.h"
+#include "undo.h"
 #include <sys/types.h>
 
 /***********************************
@@ -38,7 +39,9 @@ void cut_glyph(struct font_s *font, unsigned char buffer[])
     unsigned char *data = font->data;
     data += get_glyph_index(font);
     memcpy((void *)buffer, (void *)data, font->charsize);
+    undo_begin_glyphs(font, get_glyph_index(font)/font->charsize, 1);
     memset((void *)data, 0, font->charsize);
+    undo_end(font);
     force_font_dirty(font);
 }
 
@@ -46,112 +49,186 @@ void paste_glyph(struct font_s *font, unsigned char buffer[])
 {
     unsigned char *data = font->data;
     data += get_glyph_index(font);
+    undo_begin_glyphs(font, get_glyph_index(font)/font->charsize, 1);
     memcpy((void *)data, (void *)buffer, font->charsize);
+    undo_end(font);
     force_font_dirty(font);
 }
 
-void clear_glyph(struct font_s *font)
+/***********************************
+ * Glyph selection
+ ***********************************/
+/*
+ * Index of the glyph where the user started selecting a range of glyphs in
+ * the right window, or -1 if there is no selection. The other end of the
+ * range is always the glyph under the cursor.
+ */
+int selection_anchor = -1;
+
+void toggle_glyph_selection(struct font_s *font)
 {
-    unsigned char *data = font->data;
-    data += get_glyph_index(font);
-    memset((void *)data, 0, font->charsize);
-    force_font_dirty(font);
+    if(selection_anchor >= 0) selection_anchor = -1;
+    else selection_anchor = get_glyph_index(font)/font->charsize;
 }
 
-void set_glyph(struct font_s *font)
+void clear_glyph_selection()
 {
-    unsigned char *data = font->data;
-    data += get_glyph_index(font);
-    memset((void *)data, 255, font->charsize);
-    force_font_dirty(font);
+    selection_anchor = -1;
 }
 
-void flip_glyph_horizontally(struct font_s *font)
+/*
+ * Get the first glyph and the number of glyphs the glyph operations should
+ * work on. This is the selected range if there is one, otherwise it is the
+ * glyph under the cursor.
+ */
+unsigned int get_glyph_selection(struct font_s *font, unsigned int *first)
 {
-    unsigned char *data = font->data;
-    data += get_glyph_index(font);
-    unsigned int h = font->charsize/font->height;
-    unsigned int i, j, k;
+    int cur = get_glyph_index(font)/font->charsize;
 
-    /*
-     * in the following operations we assume we are working with a maximum
-     * font width of 32 (i.e. 4 bytes, the size of unsigned int).
-     * TODO: handle more font widths properly.
-     */
-    for(i = 0; i < font->height; i++)
+    if(selection_anchor < 0 || selection_anchor >= (int)font->length)
     {
-        unsigned int line = 0, line2 = 0;
+        *first = cur;
+        return 1;
+    }
 
-        for(j = 0; j < h; j++)
-        {
-            line |= (unsigned int)(data[j]) << (j*8);
-        }
+    if(selection_anchor < cur)
+    {
+        *first = selection_anchor;
+        return cur-selection_anchor+1;
+    }
 
-        /* flip */
-        k = 1;
-        for(j = (1 << 31); j > (1 << 15); j >>= 1, k <<= 1)
-        {
-            unsigned int tmp = line & j;
-            if(line & k) line2 |= j;
-            if(tmp) line2 |= k;
-        }
+    *first = cur;
+    return selection_anchor-cur+1;
+}
 
-        /* fix fonts with width not a multiple of 8 */
-        if(font->width > 8 && font->width <= 16)
-        {
-            //line2 >>= 16;
-            //line2 >>= (16-font->width);
-        }
+int is_glyph_selected(struct font_s *font, int index)
+{
+    unsigned int first, count;
 
-        /* copy back */
-        for(j = 0; j < h; j++)
-        {
-            data[h-j-1] = (unsigned char)((line2 >> ((3-j)*8)) & 0xFF);
-        }
+    if(selection_anchor < 0) return 0;
+    count = get_glyph_selection(font, &first);
+    return (index >= (int)first && index < (int)(first+count));
+}
 
-        /* fix fonts with width not a multiple of 8 */
-        if(font->width > 8 && font->width <= 16)
-        {
-            u_int16_t *l = (u_int16_t *)data;
-            *l <<= (16-font->width);
-        }
+/*
+ * Glyph kernels. These work on a range of glyphs and are run through
+ * for_each_glyph_range(), which might split big ranges between threads.
+ * The kernels that don't care about glyph boundaries work on whole
+ * machine words.
+ */
+static void fill_glyphs_kernel(struct font_s *font, unsigned int first,
+                               unsigned int count, void *arg)
+{
+    unsigned char *data = font->data + (first*font->charsize);
+    memset((void *)data, *(int *)arg, count*font->charsize);
+}
+
+static void invert_glyphs_kernel(struct font_s *font, unsigned int first,
+                                 unsigned int count, void *arg __attribute__((unused)))
+{
+    unsigned char *data = font->data + (first*font->charsize);
+    size_t bytes = (size_t)count*font->charsize;
+    size_t i, words = bytes/sizeof(uint64_t);
+    uint64_t w;
 
-        data += h;
+    for(i = 0; i < words; i++)
+    {
+        memcpy(&w, data, sizeof(uint64_t));
+        w = ~w;
+        memcpy(data, &w, sizeof(uint64_t));
+        data += sizeof(uint64_t);
     }
 
-    force_font_dirty(font);
+    for(i = words*sizeof(uint64_t); i < bytes; i++, data++) *data = ~*data;
 }
 
-void flip_glyph_vertically(struct font_s *font)
+static void flip_horz_kernel(struct font_s *font, unsigned int first,
+                             unsigned int count, void *arg __attribute__((unused)))
 {
-    unsigned char *data = font->data;
-    data += get_glyph_index(font);
-    int h = font->charsize/font->height;
-    int i, j;
+    unsigned char *data = font->data + (first*font->charsize);
+    int bytes = (font->width+7)/8;
+    int bits = bytes*8;
+    /* the reversed row has to be shifted back so the glyph's leftmost
+     * pixel sits in the most significant bit.
+     */
+    int shift = 64 - (2*bits) + font->width;
+    uint64_t mask = (bits == 64) ? ~0ULL : ((1ULL << bits)-1);
+    unsigned int rows = count*font->height;
+    unsigned int i;
 
-    for(i = 0; i < (int)(font->charsize/2); i += h)
+    for(i = 0; i < rows; i++)
     {
-        unsigned int line = 0, line2 = 0;
+        uint64_t line = get_glyph_row(data, bytes);
+        line = reverse_qword(line);
+        line = (shift >= 0) ? (line >> shift) : (line << -shift);
+        put_glyph_row(data, bytes, line & mask);
+        data += bytes;
+    }
+}
 
-        for(j = 0; j < h; j++)
-        {
-            line |= (unsigned int)(data[i+j]) << (j*8);
-        }
+static void flip_vert_kernel(struct font_s *font, unsigned int first,
+                             unsigned int count, void *arg __attribute__((unused)))
+{
+    unsigned char *data = font->data + (first*font->charsize);
+    int bytes = (font->width+7)/8;
+    unsigned char tmp[MAX_WIDTH/8];
+    unsigned int i, j;
 
-        /* flip */
-        line2 = font->charsize-i;
-        unsigned char *flip_with = data+line2-h;
+    for(i = 0; i < count; i++)
+    {
+        unsigned char *top = data;
+        unsigned char *bottom = data + (font->height-1)*bytes;
 
-        for(j = 0; j < h; j++)
+        for(j = 0; j < font->height/2; j++)
         {
-            data[i+j] = flip_with[j];
-            flip_with[j] = (unsigned char)((line >> (j*8)) & 0xFF);
+            memcpy(tmp, top, bytes);
+            memcpy(top, bottom, bytes);
+            memcpy(bottom, tmp, bytes);
+            top += bytes;
+            bottom -= bytes;
         }
+
+        data += font->charsize;
     }
+}
 
+/*
+ * Apply the given kernel to the selected glyphs (or the current glyph
+ * if nothing is selected).
+ */
+void apply_to_selection(struct font_s *font, glyph_kernel_t kernel, void *arg)
+{
+    unsigned int first, count;
+
+    count = get_glyph_selection(font, &first);
+    undo_begin_glyphs(font, first, count);
+    for_each_glyph_range(font, first, count, kernel, arg);
+    undo_end(font);
     force_font_dirty(font);
 }
 
+void clear_glyph(struct font_s *font)
+{
+    int c = 0;
+    apply_to_selection(font, fill_glyphs_kernel, &c);
+}
+
+void set_glyph(struct font_s *font)
+{
+    int c = 255;
+    apply_to_selection(font, fill_glyphs_kernel, &c);
+}
+
+void flip_glyph_horizontally(struct font_s *font)
+{
+    apply_to_selection(font, flip_horz_kernel, NULL);
+}
+
+void flip_glyph_vertically(struct font_s *font)
+{
+    apply_to_selection(font, flip_vert_kernel, NULL);
+}
+
 void export_glyphs(struct font_s *font, int as_c_file)
 {
     char *comment_start = "#";
@@ -291,31 +368,7 @@ memory_error:
 
 void invert_glyph(struct font_s *font)
 {
-    unsigned char *data = font->data;
-    data += get_glyph_index(font);
-    //int h = font->charsize/font->height;
-    unsigned int i;
-    unsigned char j;
-
-    /*
-     * in the following operations we assume we are working with a maximum
-     * font width of 32 (i.e. 4 bytes, the size of unsigned int).
-     * TODO: handle more font widths properly.
-     */
-    for(i = 0; i < font->charsize; i++)
-    {
-        unsigned char line = data[i];
-
-        for(j = (1 << 7); j > 0; j >>= 1)
-        {
-            if(line & j) line &= ~j;
-            else line |= j;
-        }
-
-        data[i] = line;
-    }
-
-    force_font_dirty(font);
+    apply_to_selection(font, invert_glyphs_kernel, NULL);
 }
 
 int get_glyph_index(struct font_s *font)
@@ -471,8 +524,8 @@ static inline void _draw_line(struct font_s *font,
 void handle_moves(struct font_s *font, char break_key)
 {
     int ch;
-    char h = font->height;
-    char w = font->width;
+    int h = font->height;
+    int w = font->width;
     //int i, j;
     int row1, row2, col1, col2;
     set_start_coords(&row1, &row2, &col1, &col2);
@@ -563,7 +616,9 @@ draw:
 void draw_shape(struct font_s *font, char break_key)
 {
     init_buffer(font);
+    undo_begin_glyphs(font, get_glyph_index(font)/font->charsize, 1);
     handle_moves(font, break_key);
+    undo_end(font);
     refresh_left_window(font);
 }
 
@@ -21,6 +21,8 @@
 #ifndef GLYPH_H
 #define GLYPH_H
 
+#include "parallel.h"
+
 /* glyph.c */
 void copy_glyph(struct font_s *font, unsigned char buffer[]);
 void cut_glyph(struct font_s *font, unsigned char buffer[]);
@@ -33,6 +35,13 @@ void export_glyphs(struct font_s *font, int as_c_file);
 void invert_glyph(struct font_s *font);
 int get_glyph_index(struct font_s *font);
 void draw_shape(struct font_s *font, char break_key);
+void toggle_glyph_selection(struct font_s *font);
+void clear_glyph_selection();
+unsigned int get_glyph_selection(struct font_s *font, unsigned int *first);
+int is_glyph_selected(struct font_s *font, int index);
+void apply_to_selection(struct font_s *font, glyph_kernel_t kernel, void *arg);
+
+extern int selection_anchor;
 
 /* glyphext.c */
 void show_ext_glyph_operations(struct font_s *font);
@@ -41,6 +50,10 @@ void glyphop_center_vert(struct font_s *font);
 void glyphop_center_both(struct font_s *font);
 void glyphop_rotate_cw(struct font_s *font);
 void glyphop_rotate_ccw(struct font_s *font);
+void show_style_synthesis(struct font_s *font);
+void style_bold(struct font_s *font);
+void style_oblique(struct font_s *font);
+void style_outline(struct font_s *font);
 
 /* glyphinfo.c */
 void show_glyph_info(struct font_s *font);
@@ -22,6 +22,8 @@
 #include "view.h"
 #include "glyph.h"
 #include "menu.h"
+#include "ink.h"
+#include "undo.h"
 
 /***********************************
  * Extended Glyph operations
@@ -58,108 +60,70 @@ void show_ext_glyph_operations(struct font_s *font)
     refresh_view_status_msg(font_file_name, font);
 }
 
-static inline unsigned int set_bit_index(unsigned int i)
+/***********************************
+ * Font style synthesis
+ ***********************************/
+char *styleops_text[] =
+{
+    "Bold",
+    "Oblique",
+    "Outline",
+};
+int styleops_text_len = sizeof(styleops_text)/sizeof(char *);
+
+void (*styleops_funcs[])(struct font_s *font) =
 {
-    int j;
+    style_bold,
+    style_oblique,
+    style_outline,
+};
+
 
-    for(j = 0; j < (int)(sizeof(unsigned int)*8); j++)
+void show_style_synthesis(struct font_s *font)
+{
+    int i = show_menu(styleops_text, styleops_text_len, 
+                      "Synthesize Font Style", 0, 0, 0, 0);
+    if(i >= 0)
     {
-        if(i & (1 << j)) return j;
+        styleops_funcs[i](font);
     }
-
-    return -1;
+    refresh_left_window(font);
+    refresh_view_status_msg(font_file_name, font);
 }
 
-void glyphop_center_horz(struct font_s *font)
+static void center_horz(struct font_s *font, int gindex)
 {
-    // find the leftmost and rightmost set pixels in the glyph
     unsigned char *data = font->data;
-    data += get_glyph_index(font);
-    unsigned char *data2 = data;
-    unsigned int h = font->charsize/font->height;
-    unsigned int i, j, k;
-    unsigned int base_index = (1 << (font->width - 1));
-    unsigned int index, line;
-    unsigned int redge /* = font->width-1 */, ledge = 0;
+    data += gindex*font->charsize;
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    struct ink_box_s box;
+    int i, shift;
 
-    if(font->width < 8) base_index <<= (8-font->width);
-    else if(font->width > 8 && font->width < 16) base_index <<= (16-font->width);
-    else if(font->width > 16 && font->width < 32) base_index <<= (32-font->width);
-
-    redge = base_index;
-
-    for(i = 0; i < font->height; i++)
-    {
-        for(line = 0, j = 0; j < h; j++)
-        {
-            line |= (unsigned int)(data[j]) << (j*8);
-        }
-
-        data += h;
-        index = base_index;
-
-        for(j = 0; j < font->width; j++)
-        {
-            if(line & index)
-            {
-                //if(j < redge) redge = j;
-                //if(j > ledge) ledge = j;
-                if(index < redge) redge = index;
-                if(index > ledge) ledge = index;
-            }
-
-            index >>= 1;
-        }
-    }
-
-    ledge = set_bit_index(ledge);
-    redge = set_bit_index(redge);
+    // find the leftmost and rightmost set pixels in the glyph
+    get_glyph_ink_box(font, gindex, &box);
+    if(ink_box_empty(&box)) return;
 
     // check glyph data is not stretching all the way from left to right edges
-    if((ledge == font->width-1) && (redge == 0))
+    if((box.left == 0) && (box.right == (int)font->width))
     {
         return;
     }
 
-    data = data2;
+    // positive shift moves the glyph to the right, negative to the left
+    shift = ((int)font->width-(box.right-box.left))/2 - box.left;
 
-    // find the glyph's horizontal center
-    j  = ledge + redge;
-    i  = j/2;
-    
-    // find where the horizontal center should actually be
-    index = base_index;
-    for(j = 0; j < font->width / 2; j++) index >>= 1;
-    index = set_bit_index(index);
-    
-    // if i > index, we shift to the right
-    // if i < index, we shift to the left
-    // if i == index, do nothing
-    int goright;
-
-    if(i > index) { k = i - index; goright = 1; }
-    else          { k = index - i; goright = 0; }
-
-    if(k)
+    if(shift)
     {
-        for(i = 0; i < font->height; i++)
+        for(i = 0; i < (int)font->height; i++)
         {
-            unsigned int line = 0;
-
-            for(j = 0; j < h; j++)
-            {
-                line |= (unsigned int)(data[j]) << (j*8);
-            }
+            uint64_t line = load_glyph_row(data, bytes, mask);
 
-            if(goright) line >>= k;
-            else line <<= k;
+            if(shift > 0) line >>= shift;
+            else line <<= -shift;
 
-            for(j = 0; j < h; j++)
-            {
-                data[j] = line & 0xff;
-                line >>= 8;
-            }
-            data += h;
+            store_glyph_row(data, bytes, line & mask);
+            data += bytes;
         }
     }
 
@@ -167,19 +131,17 @@ void glyphop_center_horz(struct font_s *font)
     struct char_info_s *char_info = (struct char_info_s *)font->char_info;
     if(char_info)
     {
-        int gindex = glyph_index(font);
         char_info[gindex].dwidthX = font->width;
         char_info[gindex].lBearing = 0;
         char_info[gindex].rBearing = font->width;
     }
-    force_font_dirty(font);
 }
 
-void glyphop_center_vert(struct font_s *font)
+static void center_vert(struct font_s *font, int gindex)
 {
     // find the topmost and lowermost set pixels in the glyph
     unsigned char *data = font->data;
-    data += get_glyph_index(font);
+    data += gindex*font->charsize;
     unsigned char *data2 = data;
     int h = font->charsize/font->height;
     int i, j, k;
@@ -246,27 +208,24 @@ void glyphop_center_vert(struct font_s *font)
     struct char_info_s *char_info = (struct char_info_s *)font->char_info;
     if(char_info)
     {
-        int gindex = glyph_index(font);
         char_info[gindex].dwidthY = font->height;
         char_info[gindex].charAscent = font->height;
         char_info[gindex].charDescent = 0;
     }
-    force_font_dirty(font);
 }
 
-void glyphop_center_both(struct font_s *font)
+static void center_both(struct font_s *font, int gindex)
 {
-    glyphop_center_horz(font);
-    glyphop_center_vert(font);
+    center_horz(font, gindex);
+    center_vert(font, gindex);
 }
 
-void glyphop_rotate_ccw(struct font_s *font)
+static void rotate_ccw(struct font_s *font, int gindex)
 {
     struct char_info_s *char_info = (struct char_info_s *)font->char_info;
     unsigned char *data = font->data;
-    data += get_glyph_index(font);
+    data += gindex*font->charsize;
     unsigned char *data2 = data;
-    int gindex = glyph_index(font);
     int gw = char_info ? char_info[gindex].dwidthX : (int)font->width;
     int gh = char_info ? char_info[gindex].charAscent+char_info[gindex].charDescent :
                          (int)font->height;
@@ -310,16 +269,14 @@ void glyphop_rotate_ccw(struct font_s *font)
     }
 
     memcpy(data2, buffer, font->charsize);
-    force_font_dirty(font);
 }
 
-void glyphop_rotate_cw(struct font_s *font)
+static void rotate_cw(struct font_s *font, int gindex)
 {
     struct char_info_s *char_info = (struct char_info_s *)font->char_info;
     unsigned char *data = font->data;
-    data += get_glyph_index(font);
+    data += gindex*font->charsize;
     unsigned char *data2 = data;
-    int gindex = glyph_index(font);
     int gw = char_info ? char_info[gindex].dwidthX : (int)font->width;
     int gh = char_info ? char_info[gindex].charAscent+char_info[gindex].charDescent :
                          (int)font->height;
@@ -364,6 +321,267 @@ void glyphop_rotate_cw(struct font_s *font)
     }
 
     memcpy(data2, buffer, font->charsize);
+}
+
+/*
+ * The extended operations work on the selected range of glyphs, or on the
+ * current glyph if there is no selection.
+ */
+struct glyphop_s
+{
+    void (*func)(struct font_s *font, int gindex);
+};
+
+static void glyphop_kernel(struct font_s *font, unsigned int first,
+                           unsigned int count, void *arg)
+{
+    struct glyphop_s *op = (struct glyphop_s *)arg;
+    unsigned int i;
+
+    for(i = first; i < first+count; i++) op->func(font, i);
+}
+
+static void apply_glyphop(struct font_s *font, void (*func)(struct font_s *font, int gindex))
+{
+    struct glyphop_s op = { func };
+    apply_to_selection(font, glyphop_kernel, &op);
+}
+
+void glyphop_center_horz(struct font_s *font)
+{
+    apply_glyphop(font, center_horz);
+}
+
+void glyphop_center_vert(struct font_s *font)
+{
+    apply_glyphop(font, center_vert);
+}
+
+void glyphop_center_both(struct font_s *font)
+{
+    apply_glyphop(font, center_both);
+}
+
+void glyphop_rotate_cw(struct font_s *font)
+{
+    apply_glyphop(font, rotate_cw);
+}
+
+void glyphop_rotate_ccw(struct font_s *font)
+{
+    apply_glyphop(font, rotate_ccw);
+}
+
+
+/*
+ * The style kernels work on whole rows, which are kept aligned to the most
+ * significant bit (see load_glyph_row()), so shifting a row right by one
+ * moves every pixel in it one place to the right.
+ */
+static void bold_kernel(struct font_s *font, unsigned int first,
+                        unsigned int count, void *arg __attribute__((unused)))
+{
+    unsigned char *data = font->data + (first*font->charsize);
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    unsigned int rows = count*font->height;
+    unsigned int i;
+
+    for(i = 0; i < rows; i++)
+    {
+        uint64_t line = load_glyph_row(data, bytes, mask);
+        store_glyph_row(data, bytes, (line | (line >> 1)) & mask);
+        data += bytes;
+    }
+}
+
+/*
+ * Slant the glyph one pixel to the right for every 4 rows above the
+ * baseline (and to the left below it). If the font doesn't tell us where
+ * the baseline is, we assume the bottom quarter of the cell is reserved
+ * for descenders, which is about right for console fonts.
+ */
+#define OBLIQUE_SLOPE       4
+
+static inline int oblique_baseline(struct font_s *font, int gindex)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+
+    if(char_info && char_info[gindex].charDescent > 0 &&
+                    char_info[gindex].charDescent < (int)font->height)
+        return font->height-1-char_info[gindex].charDescent;
+
+    return font->height-1-(font->height/4);
+}
+
+static inline int oblique_shift(int baseline, int row)
+{
+    int d = baseline-row;
+    /* round towards minus infinity, so rows below the baseline go left */
+    return (d >= 0) ? d/OBLIQUE_SLOPE : -((-d+OBLIQUE_SLOPE-1)/OBLIQUE_SLOPE);
+}
+
+static void oblique_kernel(struct font_s *font, unsigned int first,
+                           unsigned int count, void *arg __attribute__((unused)))
+{
+    unsigned char *data = font->data + (first*font->charsize);
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    unsigned int g;
+    int y;
+
+    for(g = first; g < first+count; g++)
+    {
+        int baseline = oblique_baseline(font, g);
+
+        for(y = 0; y < (int)font->height; y++)
+        {
+            uint64_t line = load_glyph_row(data, bytes, mask);
+            int shift = oblique_shift(baseline, y);
+
+            if(shift > 0) line >>= shift;
+            else if(shift < 0) line <<= -shift;
+            store_glyph_row(data, bytes, line & mask);
+            data += bytes;
+        }
+    }
+}
+
+/*
+ * The outline is the glyph grown by one pixel in all 8 directions, minus
+ * the glyph itself.
+ */
+static void outline_kernel(struct font_s *font, unsigned int first,
+                           unsigned int count, void *arg __attribute__((unused)))
+{
+    unsigned char *data = font->data + (first*font->charsize);
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    uint64_t rows[MAX_HEIGHT];
+    unsigned int g;
+    int y, h = font->height;
+
+    for(g = first; g < first+count; g++)
+    {
+        for(y = 0; y < h; y++)
+            rows[y] = load_glyph_row(data+(y*bytes), bytes, mask);
+
+        for(y = 0; y < h; y++)
+        {
+            uint64_t grown = rows[y];
+
+            if(y > 0) grown |= rows[y-1];
+            if(y < h-1) grown |= rows[y+1];
+            grown |= (grown >> 1) | (grown << 1);
+            store_glyph_row(data, bytes, grown & ~rows[y] & mask);
+            data += bytes;
+        }
+    }
+}
+
+/*
+ * Grow the glyph metrics of the given glyphs (if the font has them) to
+ * cover the pixels a style operation has added. The pixels never leave the
+ * glyph cell, so the cell stays where it is (for PCF fonts, that is where
+ * lBearing and charAscent put it), and the bearings and the BBX only move
+ * by as much as the ink went past them, keeping their signs.
+ */
+static void grow_char_info(struct font_s *font, unsigned int first,
+                           unsigned int count)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    struct ink_box_s box;
+    unsigned int i;
+    int xorigin, ascent, left, top, right, bottom;
+
+    if(!char_info) return;
+
+    for(i = first; i < first+count; i++)
+    {
+        struct char_info_s *c = &char_info[i];
+
+        get_glyph_ink_box(font, i, &box);
+        if(ink_box_empty(&box)) continue;
+
+        get_glyph_origin(font, i, &xorigin, &ascent);
+        left = xorigin+box.left;
+        right = xorigin+box.right;
+        top = ascent-box.top;
+        bottom = ascent-box.bottom;
+
+        if(c->lBearing > left) c->lBearing = left;
+        if(c->rBearing < right) c->rBearing = right;
+        if(c->charAscent < top) c->charAscent = top;
+        if(c->charDescent < -bottom) c->charDescent = -bottom;
+
+        if(c->BBw <= 0 || c->BBh <= 0)
+        {
+            c->BBXoff = left;
+            c->BBYoff = bottom;
+            c->BBw = right-left;
+            c->BBh = top-bottom;
+            continue;
+        }
+
+        if(c->BBXoff+c->BBw < right) c->BBw = right-c->BBXoff;
+        if(c->BBYoff+c->BBh < top) c->BBh = top-c->BBYoff;
+
+        if(c->BBXoff > left)
+        {
+            c->BBw += c->BBXoff-left;
+            c->BBXoff = left;
+        }
+
+        if(c->BBYoff > bottom)
+        {
+            c->BBh += c->BBYoff-bottom;
+            c->BBYoff = bottom;
+        }
+    }
+}
+
+/*
+ * Style operations work on the selected glyphs if there is a selection,
+ * otherwise they work on the whole font.
+ */
+static unsigned int get_style_range(struct font_s *font, unsigned int *first)
+{
+    if(selection_anchor >= 0) return get_glyph_selection(font, first);
+
+    *first = 0;
+    return font->length;
+}
+
+void style_bold(struct font_s *font)
+{
+    unsigned int first, count = get_style_range(font, &first);
+
+    undo_begin_glyphs(font, first, count);
+    for_each_glyph_range(font, first, count, bold_kernel, NULL);
+    grow_char_info(font, first, count);
+    undo_end(font);
     force_font_dirty(font);
 }
 
+void style_oblique(struct font_s *font)
+{
+    unsigned int first, count = get_style_range(font, &first);
+
+    undo_begin_glyphs(font, first, count);
+    for_each_glyph_range(font, first, count, oblique_kernel, NULL);
+    grow_char_info(font, first, count);
+
+    undo_end(font);
+    force_font_dirty(font);
+}
+
+void style_outline(struct font_s *font)
+{
+    unsigned int first, count = get_style_range(font, &first);
+
+    undo_begin_glyphs(font, first, count);
+    for_each_glyph_range(font, first, count, outline_kernel, NULL);
+    grow_char_info(font, first, count);
+    undo_end(font);
+    force_font_dirty(font);
+}
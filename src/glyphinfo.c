@@ -23,6 +23,7 @@
 #include "view.h"
 #include "glyph.h"
 #include "menu.h"
+#include "undo.h"
 
 /***********************************
  * Show Glyph information
@@ -91,7 +92,7 @@ void show_glyph_info(struct font_s *font)
     int first_entry    = 0;
     int selected_entry = 0;
     int vis_entries    = h-2;
-    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info+index;
     char t[10];
     char m[80];
     char title[24];
@@ -111,7 +112,7 @@ refresh:
     for(i = 0; i < vis_entries; i++)
     {
         j = first_entry+i;
-        sprintf(m, "%s: %d", info_str[j], get_val(&char_info[index], j));
+        sprintf(m, "%s: %d", info_str[j], get_val(char_info, j));
         /* print that entry */
         if(i == selected_entry) setScreenColors(BLACK, BGWHITE);
         else setScreenColors(WHITE, BGDEFAULT);
@@ -135,6 +136,7 @@ refresh:
             case('d'):
             case('D'):      // put the default value
                 i = first_entry+selected_entry;
+                undo_begin_glyphs(font, index, 1);
                 switch(i)
                 {
                     case 0: char_info->encoding     = -1; break;
@@ -142,29 +144,32 @@ refresh:
                     case 2: char_info->swidthY      = 0; break;
                     case 3: char_info->dwidthX      = font->width; break;
                     case 4: char_info->dwidthY      = 0; break;
-                    case 5: char_info->BBw          = char_info[i].dwidthX; break;
-                    case 6: char_info->BBh          = char_info[i].charAscent +
-                                                      char_info[i].charDescent;
+                    case 5: char_info->BBw          = char_info->dwidthX; break;
+                    case 6: char_info->BBh          = char_info->charAscent +
+                                                      char_info->charDescent;
                             break;
                     case 7: char_info->BBXoff       = 0; break;
                     case 8: char_info->BBYoff       = 0; break;
-                    case 9: char_info->rBearing     = char_info[i].dwidthX; break;
+                    case 9: char_info->rBearing     = char_info->dwidthX; break;
                     case 10: char_info->lBearing    = 0; break;
                     case 11: char_info->charAscent  = font->height; break;
                     case 12: char_info->charDescent = 0; break;
                 }
+                undo_end(font);
+                force_font_dirty(font);
                 goto draw_win;
                 break;
 
             case(ENTER_KEY):
                 i = first_entry+selected_entry;
                 char *r = 0;
-                sprintf(t, "%d", get_val(&char_info[index], i));
+                sprintf(t, "%d", get_val(char_info, i));
                 r = inputBoxI("Enter new value:", t, info_str[i]);
                 /* check result */
                 if(r)
                 {
                     j = atoi(r);
+                    undo_begin_glyphs(font, index, 1);
                     switch(i)
                     {
                         case 0: char_info->encoding     = j; break;
@@ -181,6 +186,8 @@ refresh:
                         case 11: char_info->charAscent   = j; break;
                         case 12: char_info->charDescent = j; break;
                     }
+                    undo_end(font);
+                    force_font_dirty(font);
                 }
                 goto draw_win;
                 break;
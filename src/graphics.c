@@ -0,0 +1,189 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: graphics.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "defs.h"
+#include "graphics.h"
+
+/*
+ * Get the size of a terminal cell in pixels. Not all terminals fill in the
+ * pixel size of the window, so we fall back to a common size.
+ */
+void get_cell_size(int *width, int *height)
+{
+    struct winsize ws;
+
+    *width = DEFAULT_CELL_WIDTH;
+    *height = DEFAULT_CELL_HEIGHT;
+
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 &&
+       ws.ws_col && ws.ws_row && ws.ws_xpixel && ws.ws_ypixel)
+    {
+        *width = ws.ws_xpixel/ws.ws_col;
+        *height = ws.ws_ypixel/ws.ws_row;
+    }
+}
+
+/*
+ * Sixel images are sent in one color (register 1) over a transparent
+ * background (the 1 in P2), so unset pixels show the terminal background.
+ */
+void sixel_begin(FILE *out, int width, int height)
+{
+    fprintf(out, "\033P0;1;0q\"1;1;%d;%d#1;2;100;100;100#1", width, height);
+}
+
+void sixel_end(FILE *out)
+{
+    fprintf(out, "\033\\");
+}
+
+static int sixel_put_run(struct report_s *out, int c, int count)
+{
+    char buf[16];
+    int len;
+
+    if(count > 3) len = sprintf(buf, "!%d%c", count, c);
+    else for(len = 0; len < count; len++) buf[len] = (char)c;
+
+    return report_write(out, buf, len);
+}
+
+/*
+ * Encode height rows (which should be a multiple of SIXEL_BAND_HEIGHT, any
+ * rows missing from the last band are taken as empty) as sixel bands. Runs
+ * of the same sixel are compressed and empty sixels at the end of a band
+ * are not sent. Returns 0 on memory error.
+ */
+int sixel_encode_rows(struct report_s *out, unsigned char *rows, int pitch,
+                      int width, int height)
+{
+    int y, x, k, c, last, run;
+
+    for(y = 0; y < height; y += SIXEL_BAND_HEIGHT)
+    {
+        int n = (height-y < SIXEL_BAND_HEIGHT) ? height-y : SIXEL_BAND_HEIGHT;
+        unsigned char *band = rows+(y*pitch);
+
+        /* find the last column with set pixels */
+        for(last = width-1; last >= 0; last--)
+        {
+            for(k = 0; k < n; k++)
+                if(band[(k*pitch)+(last/8)] & (0x80 >> (last & 7))) break;
+            if(k < n) break;
+        }
+
+        for(x = 0, run = 0, c = -1; x <= last; x++)
+        {
+            int v = 0;
+
+            for(k = 0; k < n; k++)
+                if(band[(k*pitch)+(x/8)] & (0x80 >> (x & 7))) v |= 1 << k;
+
+            if(v+63 == c)
+            {
+                run++;
+                continue;
+            }
+
+            if(run && !sixel_put_run(out, c, run)) return 0;
+            c = v+63;
+            run = 1;
+        }
+
+        if(run && !sixel_put_run(out, c, run)) return 0;
+        if(!report_write(out, "-", 1)) return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Kitty images are sent as 24-bit RGB pixels in base64. As every pixel is
+ * 3 bytes, each one is exactly one base64 group: white pixels are "////"
+ * and black ones "AAAA", and encoded rows can be joined in any order.
+ * Returns 0 on memory error.
+ */
+int kitty_encode_rows(struct report_s *out, unsigned char *rows, int pitch,
+                      int width, int height)
+{
+    int y, x;
+
+    for(y = 0; y < height; y++, rows += pitch)
+    {
+        for(x = 0; x < width; x++)
+        {
+            char *px = (rows[x/8] & (0x80 >> (x & 7))) ? "////" : "AAAA";
+            if(!report_write(out, px, 4)) return 0;
+        }
+    }
+
+    return 1;
+}
+
+void kitty_begin(struct kitty_writer_s *kw, FILE *out, int width, int height)
+{
+    kw->out = out;
+    kw->width = width;
+    kw->height = height;
+    kw->chunks = 0;
+    kw->len = 0;
+}
+
+static void kitty_send_chunk(struct kitty_writer_s *kw, int more)
+{
+    if(kw->chunks++ == 0)
+        fprintf(kw->out, "\033_Ga=T,f=24,s=%d,v=%d,C=1,m=%d;",
+                kw->width, kw->height, more);
+    else
+        fprintf(kw->out, "\033_Gm=%d;", more);
+
+    fwrite(kw->chunk, 1, kw->len, kw->out);
+    fprintf(kw->out, "\033\\");
+    kw->len = 0;
+}
+
+/*
+ * Send base64 data, KITTY_CHUNK_SIZE bytes per escape sequence. The data
+ * is held back until a chunk is full, as the last chunk must be marked as
+ * such.
+ */
+void kitty_write(struct kitty_writer_s *kw, char *data, size_t len)
+{
+    while(len)
+    {
+        size_t n;
+
+        if(kw->len == KITTY_CHUNK_SIZE) kitty_send_chunk(kw, 1);
+        n = KITTY_CHUNK_SIZE-kw->len;
+        if(n > len) n = len;
+
+        memcpy(kw->chunk+kw->len, data, n);
+        kw->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void kitty_end(struct kitty_writer_s *kw)
+{
+    kitty_send_chunk(kw, 0);
+}
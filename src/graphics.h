@@ -0,0 +1,68 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: graphics.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef GRAPHICS_H
+#define GRAPHICS_H
+
+#include <stdio.h>
+#include "fonttools.h"
+
+/*
+ * Encoders for terminal graphics protocols. Images are 1-bit, given as rows
+ * of pixels packed 8 to a byte, leftmost pixel in the most significant bit.
+ * Images are encoded a few rows at a time into a report_s buffer, so the
+ * caller can keep (and reuse) the encoded parts of an image, then send
+ * them one after the other between the begin and end calls below.
+ */
+#define GRAPHICS_SIXEL          0
+#define GRAPHICS_KITTY          1
+
+/* sixel images are encoded in bands of 6 pixel rows */
+#define SIXEL_BAND_HEIGHT       6
+
+/* the biggest payload of one kitty graphics escape sequence */
+#define KITTY_CHUNK_SIZE        4096
+
+/* used if the terminal doesn't tell us the size of a cell in pixels */
+#define DEFAULT_CELL_WIDTH      8
+#define DEFAULT_CELL_HEIGHT     16
+
+struct kitty_writer_s
+{
+    FILE *out;
+    int width, height;
+    int chunks;                     /* chunks sent so far */
+    size_t len;
+    char chunk[KITTY_CHUNK_SIZE];
+};
+
+/* graphics.c */
+void get_cell_size(int *width, int *height);
+void sixel_begin(FILE *out, int width, int height);
+int sixel_encode_rows(struct report_s *out, unsigned char *rows, int pitch,
+                      int width, int height);
+void sixel_end(FILE *out);
+int kitty_encode_rows(struct report_s *out, unsigned char *rows, int pitch,
+                      int width, int height);
+void kitty_begin(struct kitty_writer_s *kw, FILE *out, int width, int height);
+void kitty_write(struct kitty_writer_s *kw, char *data, size_t len);
+void kitty_end(struct kitty_writer_s *kw);
+
+#endif
@@ -0,0 +1,293 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: ink.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include "core.h"
+#ifndef FONTOPIA_LIBRARY
+#include "defs.h"
+#endif
+#include "view.h"
+#include "metadata.h"
+#include "parallel.h"
+#include "ink.h"
+#include "undo.h"
+
+/*
+ * OR all the rows of the glyph together, then the first and last set bits
+ * of the result are the left and right edges of the ink. With the rows
+ * aligned to the most significant bit, these are the count of leading zeros
+ * and 64 minus the count of trailing zeros.
+ */
+void get_glyph_ink_box(struct font_s *font, unsigned int gindex,
+                       struct ink_box_s *box)
+{
+    unsigned char *data = font->data+(gindex*font->charsize);
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    uint64_t line, ink = 0;
+    int y, top = -1, bottom = 0;
+
+    for(y = 0; y < (int)font->height; y++, data += bytes)
+    {
+        if(!(line = load_glyph_row(data, bytes, mask))) continue;
+        if(top < 0) top = y;
+        bottom = y+1;
+        ink |= line;
+    }
+
+    if(!ink)
+    {
+        box->left = box->top = box->right = box->bottom = 0;
+        return;
+    }
+
+    box->left = __builtin_clzll(ink);
+    box->right = 64-__builtin_ctzll(ink);
+    box->top = top;
+    box->bottom = bottom;
+}
+
+static void ink_box_kernel(struct font_s *font, unsigned int first,
+                           unsigned int count, void *arg)
+{
+    struct ink_box_s *boxes = (struct ink_box_s *)arg;
+
+    while(count--)
+    {
+        get_glyph_ink_box(font, first, &boxes[first]);
+        first++;
+    }
+}
+
+/*
+ * Get the ink boxes of all the glyphs in the font. If total is not NULL,
+ * it is set to the union of all the boxes.
+ */
+void get_font_ink_boxes(struct font_s *font, struct ink_box_s *boxes,
+                        struct ink_box_s *total)
+{
+    unsigned int i;
+
+    for_each_glyph_range(font, 0, font->length, ink_box_kernel, boxes);
+    if(!total) return;
+
+    total->left = font->width;
+    total->top = font->height;
+    total->right = total->bottom = 0;
+
+    for(i = 0; i < font->length; i++)
+    {
+        if(ink_box_empty(&boxes[i])) continue;
+        if(boxes[i].left < total->left) total->left = boxes[i].left;
+        if(boxes[i].top < total->top) total->top = boxes[i].top;
+        if(boxes[i].right > total->right) total->right = boxes[i].right;
+        if(boxes[i].bottom > total->bottom) total->bottom = boxes[i].bottom;
+    }
+
+    if(ink_box_empty(total)) total->left = total->top = total->bottom = 0;
+}
+
+/*
+ * Get the position of the glyph cell relative to the glyph origin: the x
+ * coordinate of the cell's left column, and how many of its rows are above
+ * the baseline. PCF glyph cells are described by their metrics, others by
+ * the font bounding box.
+ */
+void get_glyph_origin(struct font_s *font, unsigned int gindex,
+                      int *xorigin, int *ascent)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    struct metadata_item_s *meta = (struct metadata_item_s *)font->metadata;
+
+    if(font->version == VER_PCF && char_info)
+    {
+        *xorigin = char_info[gindex].lBearing;
+        *ascent = char_info[gindex].charAscent;
+    }
+    else if(font->has_metadata && meta)
+    {
+        *xorigin = meta[METADATA_FONTBOUNDINGBOX_XOFF].value;
+        *ascent = font->height+meta[METADATA_FONTBOUNDINGBOX_YOFF].value;
+    }
+    else
+    {
+        *xorigin = 0;
+        *ascent = font->height;
+    }
+}
+
+/*
+ * Set the bounding box (BBX) of each glyph in char_info to its ink box, in
+ * BDF coordinates, i.e. relative to the glyph origin with y going up. The
+ * PCF ink metrics are derived from the same fields when the font is saved.
+ * Returns 0 if the font has no char_info, or on memory error.
+ */
+int set_font_ink_metrics(struct font_s *font)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    struct ink_box_s *boxes;
+    unsigned int i;
+    int xorigin, ascent;
+
+    if(!char_info || !font->data) return 0;
+
+    boxes = (struct ink_box_s *)malloc(font->length*sizeof(struct ink_box_s));
+    if(!boxes) return 0;
+    get_font_ink_boxes(font, boxes, NULL);
+
+    for(i = 0; i < font->length; i++)
+    {
+        if(ink_box_empty(&boxes[i]))
+        {
+            char_info[i].BBw = char_info[i].BBh = 0;
+            char_info[i].BBXoff = char_info[i].BBYoff = 0;
+            continue;
+        }
+
+        get_glyph_origin(font, i, &xorigin, &ascent);
+        char_info[i].BBw = boxes[i].right-boxes[i].left;
+        char_info[i].BBh = boxes[i].bottom-boxes[i].top;
+        char_info[i].BBXoff = xorigin+boxes[i].left;
+        char_info[i].BBYoff = ascent-boxes[i].bottom;
+    }
+
+    free(boxes);
+    return 1;
+}
+
+#ifndef FONTOPIA_LIBRARY
+
+/*
+ * Remove the rows at the top and bottom of the glyph cell that are empty
+ * in all the glyphs.
+ */
+void trim_empty_rows(struct font_s *font)
+{
+    struct metadata_item_s *meta = (struct metadata_item_s *)font->metadata;
+    struct char_info_s *char_info = NULL;
+    struct ink_box_s *boxes, total;
+    unsigned char *newdata;
+    unsigned int i, bytes = (font->width+7)/8;
+    unsigned int new_charsize;
+    int top, bottom;
+    char msg[128];
+
+    boxes = (struct ink_box_s *)malloc(font->length*sizeof(struct ink_box_s));
+    if(!boxes) goto memory_error;
+    get_font_ink_boxes(font, boxes, &total);
+    free(boxes);
+
+    if(ink_box_empty(&total))
+    {
+        status_error("The font has no set pixels");
+        return;
+    }
+
+    top = total.top;
+    bottom = font->height-total.bottom;
+
+    if(!top && !bottom)
+    {
+        msgBox("There are no empty rows to trim.", BUTTON_OK, INFO);
+        return;
+    }
+
+    sprintf(msg, "Remove %d empty row(s) from the top\n"
+                 "and %d from the bottom of all glyphs?", top, bottom);
+    if(msgBox(msg, BUTTON_YES|BUTTON_NO, CONFIRM) != BUTTON_YES) return;
+
+    new_charsize = (total.bottom-total.top)*bytes;
+    newdata = (unsigned char *)malloc(font->length*new_charsize);
+    if(!newdata) goto memory_error;
+
+    for(i = 0; i < font->length; i++)
+        memcpy(newdata+(i*new_charsize),
+               font->data+(i*font->charsize)+(top*bytes), new_charsize);
+
+    /*
+     * the module resets the glyph metrics on a height change, but trimming
+     * keeps the glyph widths and bearings, so save them to put back.
+     */
+    if(font->char_info)
+    {
+        char_info = (struct char_info_s *)malloc(font->length*
+                                                 sizeof(struct char_info_s));
+        if(!char_info)
+        {
+            free(newdata);
+            goto memory_error;
+        }
+        memcpy(char_info, font->char_info,
+               font->length*sizeof(struct char_info_s));
+    }
+
+    undo_begin_font(font);
+    font->height = total.bottom-total.top;
+    font->charsize = new_charsize;
+    font->module->handle_hw_change(font, (char *)newdata,
+                                   font->length*new_charsize);
+    free(newdata);
+
+    if(font->has_metadata && meta)
+    {
+        meta[METADATA_FONT_ASCENT].value -= top;
+        meta[METADATA_FONT_DESCENT].value -= bottom;
+        if(meta[METADATA_FONT_ASCENT].value < 0)
+            meta[METADATA_FONT_ASCENT].value = 0;
+        if(meta[METADATA_FONT_DESCENT].value < 0)
+            meta[METADATA_FONT_DESCENT].value = 0;
+        meta[METADATA_FONTBOUNDINGBOX_Y].value = font->height;
+        meta[METADATA_FONTBOUNDINGBOX_YOFF].value += bottom;
+    }
+
+    /*
+     * each glyph loses the top rows of its own cell, and whatever was below
+     * the last inked row of the font.
+     */
+    if(char_info)
+    {
+        for(i = 0; i < font->length; i++)
+        {
+            int gh = char_info[i].charAscent+char_info[i].charDescent;
+
+            if(gh > total.bottom) gh = total.bottom;
+            gh -= top;
+            if(gh < 0) gh = 0;
+            char_info[i].charAscent -= top;
+            char_info[i].charDescent = gh-char_info[i].charAscent;
+        }
+
+        memcpy(font->char_info, char_info,
+               font->length*sizeof(struct char_info_s));
+        free(char_info);
+    }
+
+    set_font_ink_metrics(font);
+    calc_max_zoom(font);
+    reset_all_cursors();
+    force_font_dirty(font);
+    undo_end(font);
+    return;
+
+memory_error:
+
+    status_error("Insufficient memory");
+}
+
+#endif      /* FONTOPIA_LIBRARY */
@@ -0,0 +1,48 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: ink.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef INK_H
+#define INK_H
+
+#include "font_ops.h"
+
+/*
+ * The ink box of a glyph is the smallest rectangle that holds all of its
+ * set pixels, in pixels from the top left corner of the glyph cell. The
+ * right and bottom edges are exclusive. Empty glyphs have an all-zero box.
+ */
+struct ink_box_s
+{
+    int left, top, right, bottom;
+};
+
+#define ink_box_empty(b)        ((b)->right == 0)
+
+/* ink.c */
+void get_glyph_ink_box(struct font_s *font, unsigned int gindex,
+                       struct ink_box_s *box);
+void get_font_ink_boxes(struct font_s *font, struct ink_box_s *boxes,
+                        struct ink_box_s *total);
+void get_glyph_origin(struct font_s *font, unsigned int gindex,
+                      int *xorigin, int *ascent);
+int set_font_ink_metrics(struct font_s *font);
+void trim_empty_rows(struct font_s *font);
+
+#endif
@@ -153,3 +153,150 @@ void do_left(struct font_s *font)
     }
 }
 
+
+static inline int charmap_rows(struct font_s *font)
+{
+    int w = right_window.cols_per_row;
+
+    return (font->length+w-1)/w;
+}
+
+/*
+ * Move the charmap cursor to the given glyph, scrolling the window only if
+ * the glyph is not already visible.
+ */
+void goto_glyph(struct font_s *font, int index)
+{
+    int w = right_window.cols_per_row;
+    int row;
+
+    if(font->length == 0) return;
+    if(index >= (int)font->length) index = font->length-1;
+    if(index < 0) index = 0;
+
+    row = index/w;
+
+    if(row < right_window.first_vis_row)
+        right_window.first_vis_row = row;
+    else if(row >= right_window.first_vis_row+right_window.height)
+        right_window.first_vis_row = row-right_window.height+1;
+
+    right_window.cursor.row = row-right_window.first_vis_row;
+    right_window.cursor.col = index%w;
+}
+
+/*
+ * Scroll the charmap by a whole window (dir is 1 or -1), keeping the
+ * cursor at the same place in the window.
+ */
+static void charmap_page(struct font_s *font, int dir)
+{
+    int h = right_window.height;
+    int rows = charmap_rows(font);
+    int last_first = (rows > h) ? rows-h : 0;
+    int row = right_window.first_vis_row+right_window.cursor.row+(dir*h);
+
+    right_window.first_vis_row += dir*h;
+    if(right_window.first_vis_row > last_first)
+        right_window.first_vis_row = last_first;
+    if(right_window.first_vis_row < 0) right_window.first_vis_row = 0;
+
+    if(row >= rows) row = rows-1;
+    if(row < 0) row = 0;
+
+    goto_glyph(font, (row*right_window.cols_per_row)+right_window.cursor.col);
+}
+
+void do_pgup(struct font_s *font)
+{
+    if(active_window == &right_window)
+    {
+        charmap_page(font, -1);
+        refresh_view_status_msg(font_file_name, font);
+    }
+    else
+    {
+        left_window.cursor.row = 0;
+        refresh_left_window(font);
+    }
+}
+
+void do_pgdown(struct font_s *font)
+{
+    if(active_window == &right_window)
+    {
+        charmap_page(font, 1);
+        refresh_view_status_msg(font_file_name, font);
+    }
+    else
+    {
+        left_window.cursor.row = font->height-1;
+        refresh_left_window(font);
+    }
+}
+
+void do_home(struct font_s *font)
+{
+    if(active_window == &right_window)
+    {
+        goto_glyph(font, 0);
+        refresh_view_status_msg(font_file_name, font);
+    }
+    else
+    {
+        left_window.cursor.col = 0;
+        refresh_left_window(font);
+    }
+}
+
+void do_end(struct font_s *font)
+{
+    if(active_window == &right_window)
+    {
+        goto_glyph(font, font->length-1);
+        refresh_view_status_msg(font_file_name, font);
+    }
+    else
+    {
+        left_window.cursor.col = font->width-1;
+        refresh_left_window(font);
+    }
+}
+
+/*
+ * Ask the user for a glyph to jump to. The glyph can be given as an index
+ * (decimal, or hex with a leading 0x), or as a percentage of the font
+ * length (e.g. 50%).
+ */
+void do_goto_glyph(struct font_s *font)
+{
+    char *input, *end, *p;
+    long n;
+
+    if(font->length == 0) return;
+
+    input = inputBoxI("Go to glyph (index, 0x-prefixed hex index, or\n"
+                      "a percentage of the font, e.g. 50%):",
+                      "", " Go To Glyph ");
+    if(!input || strlen(input) == 0) return;
+
+    /* base 0 would read a leading zero as octal, so pick the base here */
+    for(p = input; *p == ' '; p++) ;
+    n = strtol(input, &end,
+               (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) ? 16 : 10);
+
+    if(end == input || n < 0 || (*end && strcmp(end, "%")))
+    {
+        msgBox("Invalid glyph index.", BUTTON_OK, ERROR);
+        return;
+    }
+
+    if(*end == '%')
+    {
+        if(n > 100) n = 100;
+        n = (n*(long)(font->length-1))/100;
+    }
+
+    active_window = &right_window;
+    goto_glyph(font, (n >= (long)font->length) ? (int)font->length-1 : (int)n);
+}
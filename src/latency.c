@@ -0,0 +1,222 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: latency.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "latency.h"
+
+/*
+ * The histograms are log-linear, like HdrHistogram's: times are kept in
+ * microseconds, exactly up to 32, and above that with 16 buckets for each
+ * power of two, i.e. to within 1/16th (6%) of the real value. 448 buckets
+ * go up to 2^31 us, more than half an hour.
+ */
+#define LATENCY_SUB_BITS        4
+#define LATENCY_SUB_COUNT       (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS         ((32-LATENCY_SUB_BITS)*LATENCY_SUB_COUNT)
+#define LATENCY_MAX_COMMANDS    64
+
+struct latency_hist_s
+{
+    char *command;
+    unsigned long count;
+    unsigned long long total, max;
+    unsigned int buckets[LATENCY_BUCKETS];
+};
+
+int latency_enabled = 0;
+
+static char *latency_file_name = NULL;
+static struct latency_hist_s *hists = NULL;
+static int hist_count = 0;
+
+/* the key being handled */
+static char *cur_command = NULL;
+static unsigned long long cur_start = 0;
+
+static unsigned long long now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static int bucket_index(unsigned long long us)
+{
+    int msb = 63-__builtin_clzll(us|1);
+    int shift;
+
+    if(us < 2*LATENCY_SUB_COUNT) return (int)us;
+    if(msb > 30) return LATENCY_BUCKETS-1;
+
+    shift = msb-LATENCY_SUB_BITS;
+    return (shift << LATENCY_SUB_BITS) + (int)(us >> shift);
+}
+
+/* the highest time that goes in a bucket */
+static unsigned long long bucket_value(int i)
+{
+    int shift;
+
+    if(i < 2*LATENCY_SUB_COUNT) return i;
+
+    shift = (i >> LATENCY_SUB_BITS)-1;
+    return ((unsigned long long)((i & (LATENCY_SUB_COUNT-1))+LATENCY_SUB_COUNT+1)
+                                                            << shift)-1;
+}
+
+static struct latency_hist_s *get_hist(char *command)
+{
+    int i;
+
+    for(i = 0; i < hist_count; i++)
+    {
+        if(strcmp(hists[i].command, command) == 0) return &hists[i];
+    }
+
+    if(hist_count == LATENCY_MAX_COMMANDS) return NULL;
+
+    memset(&hists[hist_count], 0, sizeof(struct latency_hist_s));
+    hists[hist_count].command = command;
+    return &hists[hist_count++];
+}
+
+static void latency_exit()
+{
+    latency_write();
+}
+
+void latency_start(char *file_name)
+{
+    hists = (struct latency_hist_s *)calloc(LATENCY_MAX_COMMANDS,
+                                            sizeof(struct latency_hist_s));
+    if(!hists) return;
+
+    latency_file_name = file_name;
+    latency_enabled = 1;
+    atexit(latency_exit);
+}
+
+/*
+ * A key was read, and is about to be handled. Until main() names the
+ * command it runs for the key, the time goes to "other".
+ */
+void latency_key()
+{
+    cur_command = "other";
+    cur_start = now_us();
+}
+
+/* main() is about to run the named command for the current key */
+void latency_command(char *name)
+{
+    if(cur_command) cur_command = name;
+}
+
+/* the key was handled, and the screen updated */
+void latency_frame_done()
+{
+    struct latency_hist_s *hist;
+    unsigned long long us;
+
+    if(!cur_command) return;
+
+    us = now_us()-cur_start;
+
+    if((hist = get_hist(cur_command)))
+    {
+        hist->count++;
+        hist->total += us;
+        if(us > hist->max) hist->max = us;
+        hist->buckets[bucket_index(us)]++;
+    }
+
+    cur_command = NULL;
+}
+
+/* the time under which p percent of the keys were handled */
+static unsigned long long percentile(struct latency_hist_s *hist, double p)
+{
+    unsigned long long want = (unsigned long long)(hist->count*p/100.0+0.5);
+    unsigned long long seen = 0;
+    int i;
+
+    if(want < 1) want = 1;
+
+    for(i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        if((seen += hist->buckets[i]) >= want)
+        {
+            unsigned long long v = bucket_value(i);
+            return (v > hist->max) ? hist->max : v;
+        }
+    }
+
+    return hist->max;
+}
+
+/*
+ * Write one JSON object per command, e.g.
+ *
+ *   {"command":"do_right","count":210,"mean_us":412,"p50_us":383,
+ *    "p90_us":543,"p99_us":1151,"p999_us":2175,"max_us":2203,
+ *    "buckets":[[351,12],[367,40],...]}
+ *
+ * Each bucket is the highest time that falls in it and the number of keys.
+ * Commands that open a dialog include the time the dialog was open. Returns
+ * 1 on success, 0 on error.
+ */
+int latency_write()
+{
+    FILE *file;
+    int i, j, first, res;
+
+    if(!latency_enabled) return 0;
+    if(!(file = fopen(latency_file_name, "w"))) return 0;
+
+    for(i = 0; i < hist_count; i++)
+    {
+        struct latency_hist_s *hist = &hists[i];
+
+        fprintf(file, "{\"command\":\"%s\",\"count\":%lu,\"mean_us\":%llu,"
+                      "\"p50_us\":%llu,\"p90_us\":%llu,\"p99_us\":%llu,"
+                      "\"p999_us\":%llu,\"max_us\":%llu,\"buckets\":[",
+                      hist->command, hist->count, hist->total/hist->count,
+                      percentile(hist, 50), percentile(hist, 90),
+                      percentile(hist, 99), percentile(hist, 99.9), hist->max);
+
+        for(j = 0, first = 1; j < LATENCY_BUCKETS; j++)
+        {
+            if(!hist->buckets[j]) continue;
+            fprintf(file, "%s[%llu,%u]", first ? "" : ",",
+                          bucket_value(j), hist->buckets[j]);
+            first = 0;
+        }
+
+        fprintf(file, "]}\n");
+    }
+
+    res = !ferror(file);
+    if(fclose(file)) res = 0;
+    return res;
+}
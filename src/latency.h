@@ -0,0 +1,38 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: latency.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+/*
+ * Keystroke latency recorder: the time from reading a key to the end of
+ * the screen update it causes, kept as a histogram per command. It is off
+ * unless fontopia was started with --latency.
+ */
+extern int latency_enabled;
+
+/* latency.c */
+void latency_start(char *file_name);
+void latency_key();
+void latency_command(char *name);
+void latency_frame_done();
+int latency_write();
+
+#endif
@@ -0,0 +1,381 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: libfontopia.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <pthread.h>
+#include <limits.h>
+#include "core.h"
+#include "view.h"
+#include "modules/modules.h"
+#include "raster.h"
+#include "libfontopia.h"
+
+/*
+ * The format modules are shared with the editor, and talk back to it
+ * through the status bar and view functions. The library has no screen, so
+ * it has its own versions of these functions, which keep the last error
+ * message for fontopia_last_error(). The library is always headless.
+ *
+ * Each load and write has its own context (see struct font_ctx_s), so
+ * different fonts can be used on different threads at the same time. A
+ * font handle must not be used by two threads at once.
+ */
+
+char *font_file_name = (char *)NULL;
+int startup_rawfont_width = 0;
+int startup_rawfont_height = 0;
+int headless = 1;
+char buffer_mode_on = 0;
+int big_endian;
+
+struct fontopia_font_s
+{
+    struct font_s *font;
+    char *name;                 /* the file name, or the name hint */
+    struct cpmap_s *map;        /* made on first use */
+    int mapsize;
+};
+
+static pthread_once_t lib_once = PTHREAD_ONCE_INIT;
+static __thread char last_error[256];
+
+
+static void lib_init()
+{
+    big_endian = is_big_endian();
+    init_modules();
+}
+
+static void lib_begin()
+{
+    pthread_once(&lib_once, lib_init);
+    last_error[0] = '\0';
+}
+
+static void set_error(char *msg)
+{
+    strncpy(last_error, msg, sizeof(last_error)-1);
+    last_error[sizeof(last_error)-1] = '\0';
+}
+
+
+/*
+ * The editor functions the modules call. The loaders don't touch the views,
+ * but creating an empty font does.
+ */
+void status_error(char *msg)
+{
+    if(msg) set_error(msg);
+}
+
+void status_msg(char *msg __attribute__((unused)))
+{
+}
+
+void refresh_view_status_msg(char *msg __attribute__((unused)),
+                             struct font_s *font __attribute__((unused)))
+{
+}
+
+void refresh_view_status_error(char *msg, struct font_s *font __attribute__((unused)))
+{
+    status_error(msg);
+}
+
+void calc_max_zoom(struct font_s *font)
+{
+    font->current_zoom = 1;
+    font->max_zoom = 1;
+}
+
+void reset_all_cursors()
+{
+}
+
+
+/*
+ * The library API.
+ */
+static fontopia_font *new_handle(struct font_s *font, const char *name)
+{
+    fontopia_font *f;
+
+    if(!font) return (fontopia_font *)NULL;
+
+    if(!(f = (fontopia_font *)calloc(1, sizeof(fontopia_font))) ||
+       !(f->name = strdup(name ? name : "untitled")))
+    {
+        free(f);
+        kill_font(font);
+        set_error("Insufficient memory");
+        return (fontopia_font *)NULL;
+    }
+
+    f->font = font;
+    return f;
+}
+
+fontopia_font *fontopia_open(const char *path)
+{
+    struct font_ctx_s ctx;
+
+    if(!path) return (fontopia_font *)NULL;
+    lib_begin();
+    init_font_ctx(&ctx, (char *)path);
+    return new_handle(load_font_file(&ctx), path);
+}
+
+fontopia_font *fontopia_open_memory(const void *data, size_t size, const char *name)
+{
+    fontopia_font *f;
+    struct font_ctx_s ctx;
+    unsigned char *copy;
+
+    if(!data) return (fontopia_font *)NULL;
+    lib_begin();
+
+    /* the parsers change the data as they go, and the file signature check
+     * may look past the end of very short files.
+     */
+    if(!(copy = (unsigned char *)calloc(1, size+64)))
+    {
+        set_error("Insufficient memory");
+        return (fontopia_font *)NULL;
+    }
+
+    memcpy(copy, data, size);
+    init_font_ctx(&ctx, (char *)name);
+    f = new_handle(load_font_data(&ctx, copy, (long)size), name);
+    free(copy);
+    return f;
+}
+
+void fontopia_close(fontopia_font *font)
+{
+    if(!font) return;
+    kill_font(font->font);
+    free(font->map);
+    free(font->name);
+    free(font);
+}
+
+int fontopia_get_metrics(fontopia_font *font, struct fontopia_metrics *metrics)
+{
+    if(!font || !metrics) return -1;
+
+    metrics->length = font->font->length;
+    metrics->width = font->font->width;
+    metrics->height = font->font->height;
+    metrics->row_bytes = (font->font->width+7)/8;
+    metrics->glyph_size = metrics->row_bytes*font->font->height;
+    metrics->format = font->font->version;
+    metrics->has_unicode_table = font->font->has_unicode_table;
+    return 0;
+}
+
+int fontopia_get_glyph(fontopia_font *font, unsigned int index,
+                       unsigned char *buf, size_t size)
+{
+    unsigned char *data;
+    int bytes, i;
+    unsigned int y;
+
+    if(!font || !buf) return -1;
+    bytes = (font->font->width+7)/8;
+
+    if(index >= font->font->length)
+    {
+        set_error("Glyph index out of range");
+        return -1;
+    }
+
+    if(size < (size_t)bytes*font->font->height)
+    {
+        set_error("Buffer too small");
+        return -1;
+    }
+
+    /* our rows are little-endian words, the leftmost pixel in the MSB */
+    data = font->font->data+(index*font->font->charsize);
+
+    for(y = 0; y < font->font->height; y++, data += bytes)
+    {
+        uint64_t line = get_glyph_row(data, bytes);
+
+        for(i = 0; i < bytes; i++)
+            *buf++ = (unsigned char)(line >> ((bytes-1-i)*8));
+    }
+
+    return bytes*font->font->height;
+}
+
+/* build the unicode lookup table the first time it is needed */
+static int make_map(fontopia_font *font)
+{
+    if(!font->map)
+    {
+        if((font->mapsize = get_cpmap(font->font, &font->map)) < 0)
+        {
+            font->mapsize = 0;
+            set_error("Insufficient memory");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int fontopia_glyph_index(fontopia_font *font, uint32_t codepoint)
+{
+    unsigned int g;
+
+    if(!font || make_map(font) < 0) return -1;
+
+    g = find_cpmap_glyph(font->font, font->map, font->mapsize, codepoint);
+    return (g == NO_GLYPH) ? -1 : (int)g;
+}
+
+int fontopia_get_glyph_by_codepoint(fontopia_font *font, uint32_t codepoint,
+                                    unsigned char *buf, size_t size)
+{
+    int g = fontopia_glyph_index(font, codepoint);
+
+    if(g < 0)
+    {
+        set_error("No glyph for this character");
+        return -1;
+    }
+
+    return fontopia_get_glyph(font, g, buf, size);
+}
+
+int fontopia_render_text(fontopia_font *font, const char *text,
+                         struct fontopia_bitmap *bitmap, int x, int y)
+{
+    struct raster_s r;
+    size_t len;
+
+    if(!font || !text || !bitmap || !bitmap->pixels) return -1;
+
+    if((bitmap->bpp != 1 && bitmap->bpp != 8) ||
+       bitmap->width > INT_MAX/8 || bitmap->height > INT_MAX ||
+       bitmap->stride > INT_MAX ||
+       bitmap->stride < (bitmap->bpp == 1 ? (bitmap->width+7)/8 : bitmap->width))
+    {
+        set_error("Invalid bitmap");
+        return -1;
+    }
+
+    if((len = strlen(text)) > INT_MAX || make_map(font) < 0) return -1;
+
+    r.pixels = bitmap->pixels;
+    r.width = bitmap->width;
+    r.height = bitmap->height;
+    r.stride = bitmap->stride;
+    r.bpp = bitmap->bpp;
+    r.color = bitmap->color;
+    return raster_text(font->font, font->map, font->mapsize,
+                       (unsigned char *)text, (int)len, &r, x, y);
+}
+
+int fontopia_text_width(fontopia_font *font, const char *text)
+{
+    size_t len;
+
+    if(!font || !text) return -1;
+    if((len = strlen(text)) > INT_MAX || make_map(font) < 0) return -1;
+
+    return raster_text_width(font->font, font->map, font->mapsize,
+                             (unsigned char *)text, (int)len);
+}
+
+/* name is the file name the BDF and PCF writers see */
+static int write_font(fontopia_font *font, FILE *file, int format, const char *name)
+{
+    struct font_ctx_s ctx;
+
+    lib_begin();
+
+    if(format && format != font->font->version)
+    {
+        /* the unicode table may change with the format */
+        free(font->map);
+        font->map = NULL;
+        font->mapsize = 0;
+        if(!convert_font_version(font->font, format)) return -1;
+    }
+
+    init_font_ctx(&ctx, (char *)name);
+
+    if(write_to_file(&ctx, file, font->font))
+    {
+        set_error("Error writing file");
+        return -1;
+    }
+
+    return 0;
+}
+
+int fontopia_write(fontopia_font *font, FILE *file, int format)
+{
+    if(!font || !file) return -1;
+    return write_font(font, file, format, font->name);
+}
+
+int fontopia_save(fontopia_font *font, const char *path, int format)
+{
+    FILE *file;
+    int res;
+
+    if(!font || !path) return -1;
+
+    if(!(file = fopen(path, "wb")))
+    {
+        set_error("Error opening file");
+        return -1;
+    }
+
+    res = write_font(font, file, format, path);
+    if(fclose(file) && res == 0)
+    {
+        set_error("Error writing file");
+        res = -1;
+    }
+
+    return res;
+}
+
+int fontopia_format_from_name(const char *name)
+{
+    if(!name) return 0;
+    pthread_once(&lib_once, lib_init);
+    return get_version((char *)name);
+}
+
+const char *fontopia_format_name(int format)
+{
+    if(format < FONTOPIA_FORMAT_PSF1 || format > FONTOPIA_FORMAT_PCF) return NULL;
+    pthread_once(&lib_once, lib_init);
+    return get_version_str(format);
+}
+
+const char *fontopia_last_error(void)
+{
+    return last_error;
+}
@@ -0,0 +1,135 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: libfontopia.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef LIBFONTOPIA_H
+#define LIBFONTOPIA_H
+
+/*
+ * libfontopia: the font format modules of fontopia, as a library.
+ *
+ * Fonts are opened from a file or a memory buffer, then their metrics and
+ * glyph bitmaps can be read, and they can be written in any of the formats
+ * fontopia supports. Errors are reported by the return value, with a message
+ * in fontopia_last_error().
+ *
+ * Glyph bitmaps are returned one row after the other, each row taking
+ * (width+7)/8 bytes, with the leftmost pixel in the most significant bit of
+ * the first byte (the same layout as PSF and BDF files).
+ *
+ * A font handle must not be used by two threads at the same time.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* font formats */
+#define FONTOPIA_FORMAT_PSF1        1
+#define FONTOPIA_FORMAT_PSF2        2
+#define FONTOPIA_FORMAT_CP          3
+#define FONTOPIA_FORMAT_RAW         4
+#define FONTOPIA_FORMAT_BDF         5
+#define FONTOPIA_FORMAT_PCF         6
+
+typedef struct fontopia_font_s fontopia_font;
+
+struct fontopia_metrics
+{
+    unsigned int length;            /* number of glyphs */
+    unsigned int width, height;     /* glyph size in pixels */
+    unsigned int row_bytes;         /* bytes per glyph row */
+    unsigned int glyph_size;        /* bytes per glyph bitmap */
+    int format;                     /* one of FONTOPIA_FORMAT_* */
+    int has_unicode_table;
+};
+
+/* open a font file, or a font file that was read into memory (name, which
+ * can be NULL, helps to find the format and the glyph size of raw fonts).
+ */
+fontopia_font *fontopia_open(const char *path);
+fontopia_font *fontopia_open_memory(const void *data, size_t size, const char *name);
+void fontopia_close(fontopia_font *font);
+
+int fontopia_get_metrics(fontopia_font *font, struct fontopia_metrics *metrics);
+
+/* copy the bitmap of a glyph into buf, which must hold at least glyph_size
+ * bytes. Return the number of bytes copied, or -1 on error.
+ */
+int fontopia_get_glyph(fontopia_font *font, unsigned int index,
+                       unsigned char *buf, size_t size);
+int fontopia_get_glyph_by_codepoint(fontopia_font *font, uint32_t codepoint,
+                                    unsigned char *buf, size_t size);
+
+/* the glyph that shows a unicode value, or -1 if there is none. Fonts
+ * without a unicode table are looked up by their glyph encodings (PCF
+ * fonts), and fonts with neither (raw fonts, PSF fonts without a table)
+ * are indexed by the value itself.
+ */
+int fontopia_glyph_index(fontopia_font *font, uint32_t codepoint);
+
+/* a framebuffer to draw text into. Rows are stride bytes apart. At 1 bpp
+ * the leftmost pixel is in the most significant bit of the byte; at 8 bpp
+ * each pixel is a byte, and text pixels are set to color. Only the pixels
+ * of the glyphs are changed, the background is left as it is.
+ */
+struct fontopia_bitmap
+{
+    unsigned char *pixels;
+    unsigned int width, height;     /* in pixels */
+    size_t stride;
+    int bpp;                        /* 1 or 8 */
+    unsigned char color;
+};
+
+/* draw a line of UTF-8 text with its top left corner at x, y (the line is
+ * as high as the font). Glyphs are placed by their BDF/PCF metrics, so
+ * proportional fonts work, and characters the font doesn't have are drawn
+ * as U+FFFD or '?'. Anything outside the bitmap is clipped. Return the x
+ * after the text, or -1 on error.
+ */
+int fontopia_render_text(fontopia_font *font, const char *text,
+                         struct fontopia_bitmap *bitmap, int x, int y);
+
+/* the width in pixels of a line of text, or -1 on error */
+int fontopia_text_width(fontopia_font *font, const char *text);
+
+/* write the font in the given format (0 keeps the current one). Changing
+ * the format converts the font in place, as if it was opened in that format.
+ * Return 0 on success, -1 on error.
+ */
+int fontopia_save(fontopia_font *font, const char *path, int format);
+int fontopia_write(fontopia_font *font, FILE *file, int format);
+
+/* format name (e.g. "BDF") to FONTOPIA_FORMAT_*, or 0 if unknown, and back */
+int fontopia_format_from_name(const char *name);
+const char *fontopia_format_name(int format);
+
+/* the message of the last error in this thread */
+const char *fontopia_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,9 @@
 #include "metadata.h"
 #include "modules/cp.h"
 #include "menu.h"
+#include "fonttools.h"
+#include "undo.h"
+#include "latency.h"
 
 extern int fcloseall (void);    /* stdio.h */
 
@@ -94,10 +97,49 @@ void sighandler(int signo)
 }//end sighandler
 
 
+static inline int is_view_key(int ch)
+{
+    switch(ch)
+    {
+        case(UP_KEY):
+        case(DOWN_KEY):
+        case(LEFT_KEY):
+        case(RIGHT_KEY):
+        case(PGUP_KEY):
+        case(PGDOWN_KEY):
+        case(HOME_KEY):
+        case(END_KEY):
+        case(SPACE_KEY):
+        case(ENTER_KEY):
+        case(TAB_KEY):
+        case(ESC_KEY):
+            return 1;
+
+        case('f'):
+        case('F'):
+            return !CTRL && !ALT;
+    }
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     struct font_s *font;
 
+    /* batch conversion doesn't need the terminal */
+    if(argc > 1 && strcmp(argv[1], "convert") == 0)
+        return convert_main(argc-1, argv+1);
+
+    if(argc > 1 && strcmp(argv[1], "bench") == 0)
+        return bench_main(argc-1, argv+1);
+
+    if(argc > 1 && strcmp(argv[1], "replay") == 0)
+        return replay_main(argc-1, argv+1);
+
+    if(argc > 1 && strcmp(argv[1], "--serve") == 0)
+        return serve_main(argc-1, argv+1);
+
     setlocale(LC_ALL, "");
     init(argc, argv);
 
@@ -106,7 +148,11 @@ int main(int argc, char **argv)
 
     if(font_file_name)
     {
-        if(!(font = load_font_file(font_file_name)))
+        struct font_ctx_s ctx;
+
+        init_font_ctx(&ctx, font_file_name);
+
+        if(!(font = load_font_file(&ctx)))
         {
             refresh();
             if(msgBox("Continue with a new empty font?", 
@@ -121,7 +167,14 @@ int main(int argc, char **argv)
     {
         if(!(font = create_empty_font())) exit_gracefully();
     }
-    //refresh_view_status_msg(font_file_name, font);
+
+    stats_begin(STATS_VIEW);
+    calc_max_zoom(font);
+    reset_all_cursors();
+    stats_end(STATS_VIEW);
+
+    /* load_font_file() doesn't draw, an empty font has been drawn already */
+    if(font_file_name) refresh_view(font);
 
     // we don't need those after start up
     startup_rawfont_width = 0;
@@ -138,17 +191,36 @@ int main(int argc, char **argv)
     int ch = 0;
     char *abt;
 
+    /* tell fontopia replay we are up and ready for keys */
+    replay_frame_done();
+
     while(!end) 
     {    //infinite program loop//
         ch = getKey();
         //printf("%d", ch);
 
+        /* fontopia replay ends each frame with a NUL */
+        if(ch == 0 && replay_frame_fd >= 0)
+        {
+            replay_frame_done();
+            continue;
+        }
+
+        if(latency_enabled) latency_key();
+
+        /* only the keys that move around and edit glyphs are known not to
+         * draw over the windows, anything else may show a dialog, so we
+         * need to redraw the whole screen afterwards.
+         */
+        if(!is_view_key(ch)) invalidate_view();
+
         switch(ch) 
         {
             // CTRL-H (^H) is read as CTRL-Backspace
             case(BACKSPACE_KEY):
                 if(CTRL)
                 {
+                    latency_command("show_readme");
                     //show_readme(readme_file, NULL, 0);
                     fontopia_show_readme(readme_text, " README ");
                     refresh_view_status_msg(font_file_name, font);
@@ -156,23 +228,48 @@ int main(int argc, char **argv)
                 break;
 
             case(UP_KEY):
+                latency_command("do_up");
                 do_up(font);
                 break;
 
             case(DOWN_KEY):
+                latency_command("do_down");
                 do_down(font);
                 break;
 
             case(LEFT_KEY):
+                latency_command("do_left");
                 do_left(font);
                 break;
 
             case(RIGHT_KEY):
+                latency_command("do_right");
                 do_right(font);
                 break;
 
+            case(PGUP_KEY):
+                latency_command("do_pgup");
+                do_pgup(font);
+                break;
+
+            case(PGDOWN_KEY):
+                latency_command("do_pgdown");
+                do_pgdown(font);
+                break;
+
+            case(HOME_KEY):
+                latency_command("do_home");
+                do_home(font);
+                break;
+
+            case(END_KEY):
+                latency_command("do_end");
+                do_end(font);
+                break;
+
             case('a'):
             case('A'):
+                latency_command("showAbout");
                 abt = (char *)malloc(strlen(about_str)+1);
                 if(!abt)
                 {
@@ -195,9 +292,11 @@ int main(int argc, char **argv)
             case('B'):
                 if(!CTRL)
                 {
+                    latency_command("draw_shape");
                     draw_shape(font, 'b');
                     break;
                 }
+                latency_command("toggle_buffer_mode");
                 buffer_mode_on = !buffer_mode_on;
                 if(buffer_mode_on) status_msg("Buffering is ON");
                 else               status_msg("Buffering is OFF");
@@ -207,11 +306,13 @@ int main(int argc, char **argv)
             case('C'):
                 if(CTRL)
                 {
+                    latency_command("copy_glyph");
                     copy_glyph(font, copy_buffer);
                     buffer_is_empty = 0;
                 }
                 else
                 {
+                    latency_command("clear_glyph");
                     clear_glyph(font);
                     refresh_left_window(font);
                 }
@@ -222,6 +323,7 @@ int main(int argc, char **argv)
                 if(CTRL)
                 {
                     /* force saving with new file name */
+                    latency_command("save_font_file");
                     font = save_font_file(font, 1);
                     refresh_left_window(font);
                     refresh_right_window(font);
@@ -229,6 +331,7 @@ int main(int argc, char **argv)
                 }
                 else
                 {
+                    latency_command("invert_glyph");
                     invert_glyph(font);
                     refresh_left_window(font);
                 }
@@ -236,11 +339,31 @@ int main(int argc, char **argv)
 
             case('e'):
             case('E'):
+                latency_command("export_unitab");
                 export_unitab(font);
                 break;
 
+            case('f'):
+            case('F'):
+                if(active_window == &right_window)
+                {
+                    latency_command("toggle_glyph_selection");
+                    toggle_glyph_selection(font);
+                    refresh_right_window(font);
+                    refresh_view_status_msg(font_file_name, font);
+                }
+                break;
+
             case('g'):
             case('G'):
+                if(CTRL)
+                {
+                    latency_command("do_goto_glyph");
+                    do_goto_glyph(font);
+                    refresh_view_status_msg(font_file_name, font);
+                    break;
+                }
+                latency_command("show_glyph_info");
                 show_glyph_info(font);
                 refresh_left_window(font);
                 refresh_right_window(font);
@@ -250,12 +373,14 @@ int main(int argc, char **argv)
             case('H'):
                 if(CTRL)
                 {
+                    latency_command("show_readme");
                     //show_readme(readme_file, NULL, 0);
                     fontopia_show_readme(readme_text, " README ");
                     refresh_view_status_msg(font_file_name, font);
                 }
                 else
                 {
+                    latency_command("flip_glyph_horizontally");
                     flip_glyph_horizontally(font);
                     refresh_left_window(font);
                 }
@@ -263,6 +388,7 @@ int main(int argc, char **argv)
 
             case('i'):
             case('I'):
+                latency_command("import_unitab");
                 import_unitab(font);
                 refresh_left_window(font);
                 refresh_right_window(font);
@@ -290,12 +416,24 @@ int main(int argc, char **argv)
             case('L'):
                 if(!CTRL)
                 {
+                    latency_command("draw_shape");
                     draw_shape(font, 'l');
                 }
+                else if(!latency_enabled)
+                {
+                    status_error("Latency recording is off (see --latency)");
+                }
+                else
+                {
+                    latency_command("latency_write");
+                    if(latency_write()) status_msg("Keystroke latencies written");
+                    else status_error("Failed to write keystroke latencies");
+                }
                 break;
 
             case('m'):
             case('M'):
+                latency_command("show_font_metrics");
                 show_font_metrics(font);
                 refresh_left_window(font);
                 refresh_right_window(font);
@@ -307,6 +445,7 @@ int main(int argc, char **argv)
                 if(CTRL)
                 {
                     struct font_s *old_font = font;
+                    latency_command("new_font_file");
                     font = new_font_file(font);
                     if(old_font != font)
                     {
@@ -332,16 +471,19 @@ int main(int argc, char **argv)
                 if(CTRL)
                 {
                     struct font_s *old_font = font;
+                    latency_command("open_font_file");
                     font = open_font_file(font);
                     if(old_font == font)
                     {
                         refresh_left_window(font);
                         refresh_right_window(font);
                     }
+                    else refresh_view_status_msg(font_file_name, font);
                     hideCursor();
                 }
                 else
                 {
+                    latency_command("show_ext_glyph_operations");
                     show_ext_glyph_operations(font);
                 }
                 break;
@@ -350,10 +492,12 @@ int main(int argc, char **argv)
             case('P'):
                 if(font->version == VER_CP)
                 {
+                    latency_command("cp_change_codepage");
                     cp_change_codepage(font);
                 }
                 else if(font->has_metadata)
                 {
+                    latency_command("show_metadata");
                     show_metadata(font);
                 }
                 refresh_left_window(font);
@@ -364,6 +508,7 @@ int main(int argc, char **argv)
             case('q'):
             case('Q'):
                 //if(CTRL) quit(font);
+                latency_command("quit");
                 quit(font);
                 break;
 
@@ -377,6 +522,7 @@ int main(int argc, char **argv)
                 }
                 else
                 {
+                    latency_command("remove_unitab");
                     if(remove_unitab(font))
                         status_msg("Font unicode table removed successfully");
                     else
@@ -391,6 +537,7 @@ int main(int argc, char **argv)
             case('S'):
                 if(CTRL)
                 {
+                    latency_command("save_font_file");
                     if(SHIFT)    /* force saving with new file name */
                          font = save_font_file(font, 1);
                     else font = save_font_file(font, 0);    /* save with -probably- old name */
@@ -400,6 +547,7 @@ int main(int argc, char **argv)
                 }
                 else
                 {
+                    latency_command("set_glyph");
                     set_glyph(font);
                     refresh_left_window(font);
                 }
@@ -409,14 +557,16 @@ int main(int argc, char **argv)
             case('T'):
                 if(!CTRL)
                 {
-                    /*
-                     * TODO: Add triangle drawing routine.
-                     */
+                    latency_command("show_font_tools");
+                    show_font_tools(font);
+                    refresh_left_window(font);
+                    refresh_right_window(font);
                 }
                 break;
 
             case('u'):
             case('U'):
+                latency_command("open_unicode_table");
                 open_unicode_table(font);
                 refresh_left_window(font);
                 refresh_right_window(font);
@@ -429,6 +579,7 @@ int main(int argc, char **argv)
                 {
                     if(!buffer_is_empty)
                     {
+                        latency_command("paste_glyph");
                         paste_glyph(font, copy_buffer);
                         refresh_left_window(font);
                     }
@@ -439,6 +590,7 @@ int main(int argc, char **argv)
                 }
                 else
                 {
+                    latency_command("flip_glyph_vertically");
                     flip_glyph_vertically(font);
                     refresh_left_window(font);
                 }
@@ -446,6 +598,7 @@ int main(int argc, char **argv)
 
             case('w'):
             case('W'):
+                latency_command("export_glyphs");
                 if(CTRL) export_glyphs(font, 1);    // export as C source file
                 else if(!ALT) export_glyphs(font, 0); // export as plain text
                 break;
@@ -454,31 +607,58 @@ int main(int argc, char **argv)
             case('X'):
                 if(CTRL)
                 {
+                    latency_command("cut_glyph");
                     cut_glyph(font, copy_buffer);
                     buffer_is_empty = 0;
                     refresh_left_window(font);
                     break;
                 }
+                latency_command("zoom_out");
                 zoom_out(font); break;
 
+            case('y'):
+            case('Y'):
+                if(CTRL)
+                {
+                    latency_command("redo");
+                    if(!redo(font)) status_msg("Nothing to redo");
+                    else refresh_view(font);
+                    break;
+                }
+                latency_command("show_style_synthesis");
+                show_style_synthesis(font);
+                refresh_right_window(font);
+                break;
+
             case('z'):
             case('Z'):
+                if(CTRL)
+                {
+                    latency_command("undo");
+                    if(!undo(font)) status_msg("Nothing to undo");
+                    else refresh_view(font);
+                    break;
+                }
+                latency_command("zoom_in");
                 zoom_in(font); break;
 
             case(SPACE_KEY):
             case(ENTER_KEY):
                 if(active_window == &right_window)
                 {
+                    latency_command("edit_glyph");
                     active_window = &left_window;
                 }
                 else
                 {
+                    latency_command("font_toggle_active_bit");
                     font_toggle_active_bit(font);
                 }
                 refresh_left_window(font);
                 break;
 
             case(TAB_KEY):
+                latency_command("next_window");
                 active_window = active_window->next;
                 refresh_left_window(font);
                 break;
@@ -486,16 +666,32 @@ int main(int argc, char **argv)
             case(ESC_KEY):
                 if(active_window == &left_window)
                 {
+                    latency_command("leave_glyph");
                     active_window = &right_window;
                     refresh_left_window(font);
                 }
+                else if(selection_anchor >= 0)
+                {
+                    latency_command("clear_glyph_selection");
+                    clear_glyph_selection();
+                    refresh_right_window(font);
+                    refresh_view_status_msg(font_file_name, font);
+                }
                 break;
 
             default:
                 if(ch >= '1' && ch <= '9') 
+                {
+                    latency_command("cp_change_active_font");
+                    /* the history is for the font we were editing */
+                    if(font->version == VER_CP) undo_clear();
                     cp_change_active_font(font, ch-'0');
+                }
                 break;
         }
+
+        if(latency_enabled) latency_frame_done();
+        if(replay_frame_fd >= 0) replay_key_done();
     }
 
     exit(0);
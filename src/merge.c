@@ -0,0 +1,343 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: merge.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include "defs.h"
+#include "scale.h"
+#include "fonttools.h"
+#include "modules/psf.h"
+
+/***********************************
+ * Font merging
+ ***********************************/
+#define MAX_MERGE_FONTS         (16)
+/* unicode_table_index is 16 bits wide, and 0xFFFF has a special meaning */
+#define MAX_MERGED_GLYPHS       (0xFFFE)
+
+struct merge_s
+{
+    unsigned int count, size;       /* new glyphs */
+    unsigned int *src_font, *src_glyph;
+    unsigned int *start;            /* unicode values of each new glyph */
+    unsigned int *cps;
+    unsigned int cps_count, cps_size;
+};
+
+static inline int grow_array(unsigned int **arr, unsigned int *size,
+                             unsigned int need)
+{
+    unsigned int *tmp;
+    unsigned int sz = *size ? *size : 1024;
+
+    if(need <= *size) return 1;
+    while(sz < need) sz *= 2;
+    if(!(tmp = realloc(*arr, sz*sizeof(unsigned int)))) return 0;
+    *arr = tmp;
+    *size = sz;
+    return 1;
+}
+
+/*
+ * The three arrays share m->size, so they are grown together, to the size
+ * start needs (it has one more entry than the other two).
+ */
+static int add_merge_glyph(struct merge_s *m, unsigned int font, unsigned int glyph)
+{
+    unsigned int size = m->size;
+
+    if(!grow_array(&m->src_font, &size, m->count+2)) return 0;
+    size = m->size;
+    if(!grow_array(&m->src_glyph, &size, m->count+2)) return 0;
+    size = m->size;
+    if(!grow_array(&m->start, &size, m->count+2)) return 0;
+    m->size = size;
+
+    m->src_font[m->count] = font;
+    m->src_glyph[m->count] = glyph;
+    m->count++;
+    return 1;
+}
+
+/*
+ * Get the unicode values of the font's glyphs, in the same layout
+ * read_unicode_values() uses. Fonts without a unicode table use their
+ * glyph encodings. Returns 0 if the font has neither (or on memory error).
+ */
+static int get_font_values(struct font_s *font, unsigned int **cps,
+                           unsigned int **start)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    unsigned int i, k = 0;
+
+    if(font->has_unicode_table) return read_unicode_values(font, cps, start);
+    if(!char_info) return 0;
+
+    *cps = (unsigned int *)malloc(font->length*sizeof(unsigned int));
+    *start = (unsigned int *)malloc((font->length+1)*sizeof(unsigned int));
+    if(!*cps || !*start)
+    {
+        if(*cps) free(*cps);
+        if(*start) free(*start);
+        return 0;
+    }
+
+    for(i = 0; i < font->length; i++)
+    {
+        (*start)[i] = k;
+        if(char_info[i].encoding >= 0) (*cps)[k++] = char_info[i].encoding;
+    }
+
+    (*start)[i] = k;
+    return 1;
+}
+
+static inline void mark_covered(uint64_t *covered, unsigned int c)
+{
+    if(c < MAX_CODEPOINT) covered[c/64] |= (1ULL << (c%64));
+}
+
+static inline int is_covered(uint64_t *covered, unsigned int c)
+{
+    if(c >= MAX_CODEPOINT) return 1;
+    return (covered[c/64] >> (c%64)) & 1;
+}
+
+/*
+ * Copy the given glyphs of src into dest, in the target font's metrics.
+ * Glyphs that fit in the target cell are centered in it, otherwise they
+ * are scaled to the target cell.
+ */
+static int convert_glyphs(struct font_s *font, struct font_s *src,
+                          unsigned int *glyphs, unsigned int count,
+                          unsigned char *dest)
+{
+    unsigned char *tmp;
+    unsigned int i;
+    int y;
+
+    if(src->width == font->width && src->height == font->height)
+    {
+        for(i = 0; i < count; i++)
+            memcpy(dest+(i*font->charsize), src->data+(glyphs[i]*src->charsize),
+                   font->charsize);
+        return 1;
+    }
+
+    if(!(tmp = (unsigned char *)malloc(count*src->charsize))) return 0;
+
+    for(i = 0; i < count; i++)
+        memcpy(tmp+(i*src->charsize), src->data+(glyphs[i]*src->charsize),
+               src->charsize);
+
+    if(src->width <= font->width && src->height <= font->height)
+    {
+        int sbytes = (src->width+7)/8, dbytes = (font->width+7)/8;
+        int dx = (font->width-src->width)/2;
+        int dy = (font->height-src->height)/2;
+        uint64_t mask = glyph_row_mask(src->width);
+
+        memset(dest, 0, count*font->charsize);
+
+        for(i = 0; i < count; i++)
+        {
+            unsigned char *s = tmp+(i*src->charsize);
+            unsigned char *d = dest+(i*font->charsize)+(dy*dbytes);
+
+            for(y = 0; y < (int)src->height; y++)
+            {
+                store_glyph_row(d, dbytes, load_glyph_row(s, sbytes, mask) >> dx);
+                s += sbytes;
+                d += dbytes;
+            }
+        }
+    }
+    else
+    {
+        struct font_s tmp_font;
+
+        memset(&tmp_font, 0, sizeof(struct font_s));
+        tmp_font.data = tmp;
+        scale_glyph_data(&tmp_font, dest, count, src->width, src->height,
+                         font->width, font->height, SCALE_NEAREST);
+    }
+
+    free(tmp);
+    return 1;
+}
+
+/*
+ * Merge glyphs from the src fonts into font. The font's own glyphs come
+ * first, then the src fonts in the given order: a character takes its
+ * glyph from the first font that has it. Each font's glyphs are scanned
+ * once, and a bitmap of the characters we already have tells us which
+ * glyphs to take, so the work is linear in the total number of glyphs.
+ * The new glyphs are added to the end of the font.
+ * Returns the number of glyphs added, or -1 on error.
+ */
+int merge_fonts(struct font_s *font, struct font_s **src, int src_count)
+{
+    struct merge_s m;
+    uint64_t *covered = NULL;
+    unsigned int *cps = NULL, *start = NULL, *glyphs = NULL;
+    unsigned char *data = NULL, *out = NULL;
+    unsigned int i, j, k, n, total, size;
+    int s, res = -1;
+
+    memset(&m, 0, sizeof(struct merge_s));
+    covered = (uint64_t *)calloc(MAX_CODEPOINT/64, sizeof(uint64_t));
+    if(!covered) goto memory_error;
+
+    for(s = -1; s < src_count; s++)
+    {
+        struct font_s *f = (s < 0) ? font : src[s];
+
+        if(!get_font_values(f, &cps, &start))
+        {
+            status_error("Font has no unicode table or glyph encodings");
+            goto end;
+        }
+
+        for(i = 0; i < f->length; i++)
+        {
+            unsigned int first = m.cps_count;
+
+            /* sequences can't be resolved to one glyph, skip them */
+            for(j = start[i]; j < start[i+1] && cps[j] != PSF1_STARTSEQ; j++)
+            {
+                if(is_covered(covered, cps[j])) continue;
+                mark_covered(covered, cps[j]);
+                if(s < 0) continue;
+                if(!grow_array(&m.cps, &m.cps_size, m.cps_count+1)) goto memory_error;
+                m.cps[m.cps_count++] = cps[j];
+            }
+
+            if(m.cps_count == first) continue;
+            if(!add_merge_glyph(&m, s, i)) goto memory_error;
+            m.start[m.count-1] = first;
+            m.start[m.count] = m.cps_count;
+        }
+
+        free(cps);
+        free(start);
+        cps = start = NULL;
+    }
+
+    if(m.count == 0) { res = 0; goto end; }
+
+    if(font->length+m.count > MAX_MERGED_GLYPHS ||
+       (font->version == VER_PSF1 && font->length+m.count > 512))
+    {
+        status_error("Too many glyphs for this font format");
+        goto end;
+    }
+
+    /* PSF1 fonts can only have 256 or 512 glyphs, so pad with blank ones */
+    total = m.count;
+    if(font->version == VER_PSF1)
+        total = ((font->length+m.count <= 256) ? 256 : 512)-font->length;
+
+    size = m.size;
+    if(!grow_array(&m.start, &size, total+1)) goto memory_error;
+    for(k = m.count+1; k <= total; k++) m.start[k] = m.cps_count;
+
+    /* convert the glyphs we took from each font to our metrics */
+    data = (unsigned char *)calloc(total, font->charsize);
+    out = (unsigned char *)malloc(m.count*font->charsize);
+    glyphs = (unsigned int *)malloc(m.count*sizeof(unsigned int));
+    if(!data || !out || !glyphs) goto memory_error;
+
+    for(s = 0; s < src_count; s++)
+    {
+        for(n = 0, k = 0; k < m.count; k++)
+            if(m.src_font[k] == (unsigned int)s) glyphs[n++] = m.src_glyph[k];
+
+        if(!n) continue;
+        if(!convert_glyphs(font, src[s], glyphs, n, out)) goto memory_error;
+
+        for(n = 0, k = 0; k < m.count; k++)
+        {
+            if(m.src_font[k] != (unsigned int)s) continue;
+            memcpy(data+(k*font->charsize), out+(n*font->charsize), font->charsize);
+            n++;
+        }
+    }
+
+    if(append_font_glyphs(font, total, data, m.cps, m.start)) res = m.count;
+    goto end;
+
+memory_error:
+
+    status_error("Insufficient memory");
+
+end:
+
+    if(covered) free(covered);
+    if(cps) free(cps);
+    if(start) free(start);
+    if(glyphs) free(glyphs);
+    if(data) free(data);
+    if(out) free(out);
+    if(m.src_font) free(m.src_font);
+    if(m.src_glyph) free(m.src_glyph);
+    if(m.start) free(m.start);
+    if(m.cps) free(m.cps);
+    return res;
+}
+
+void merge_fonts_from_files(struct font_s *font)
+{
+    struct font_s *src[MAX_MERGE_FONTS];
+    struct font_ctx_s ctx;
+    char *file_name;
+    char msg[128];
+    int i, res, count = 0;
+
+    if(!font->has_unicode_table)
+    {
+        status_error("Font has no unicode table to merge glyphs into");
+        return;
+    }
+
+    while(count < MAX_MERGE_FONTS)
+    {
+        file_name = NULL;
+        res = show_opensave(".", OPEN, &file_name, 0);
+        if(res != OPENSAVE_SUCCESS) break;
+
+        init_font_ctx(&ctx, file_name);
+        src[count] = load_font_file(&ctx);
+        free(file_name);
+        if(src[count]) count++;
+
+        if(msgBox("Add another font? Fonts added first\n"
+                  "take priority over those added later.",
+                  BUTTON_YES|BUTTON_NO, CONFIRM) != BUTTON_YES) break;
+    }
+
+    if(!count) return;
+
+    res = merge_fonts(font, src, count);
+    for(i = 0; i < count; i++) kill_font(src[i]);
+
+    if(res >= 0)
+    {
+        sprintf(msg, "Added %d glyphs from %d font(s).", res, count);
+        msgBox(msg, BUTTON_OK, INFO);
+    }
+}
@@ -19,8 +19,13 @@
  */    
 
 #include <string.h>
+#ifndef FONTOPIA_LIBRARY
 #include <ncurses.h>
+#endif
+#include "core.h"
+#ifndef FONTOPIA_LIBRARY
 #include "defs.h"
+#endif
 #include "metadata.h"
 
 struct metadata_item_s metadata_table[metadata_table_len] =
@@ -84,6 +89,8 @@ int save_metadata_str(struct font_s *font, int index, char *value)
 }
 
 
+#ifndef FONTOPIA_LIBRARY
+
 void show_metadata(struct font_s *font)
 {
     if(!font->has_metadata) return;
@@ -236,3 +243,4 @@ refresh:
     }
 }
 
+#endif      /* FONTOPIA_LIBRARY */
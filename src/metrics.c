@@ -24,28 +24,20 @@
 #include "modules/psf.h"
 #include "modules/cp.h"
 #include "modules/raw.h"
+#include "scale.h"
+#include "undo.h"
 
 extern unsigned short default_unicode_table[]; /* psf.c */
 
 
-void handle_hw_change(struct font_s *font, int old_height, int old_width,
-                                           unsigned int old_length)
+static void __handle_hw_change(struct font_s *font, int old_height, int old_width,
+                               unsigned int old_length, int scale_mode)
 {
     //status_msg("Applying changes to glyph size...");
     
-    char hskip = old_height/font->height;
-    char rhskip = font->height/old_height;
-    char wskip = old_width/font->width;
-    if(wskip && old_width%font->width) wskip++;
-    char rwskip = font->width/old_width;
-    if(rwskip && font->width%old_width) rwskip++;
-    int new_width = (font->width)/8;
-    if(font->width%8) new_width++;
-    int new_bytes = new_width;
-    int old_bytes = (old_width)/8;
-    if(old_width%8) old_bytes++;
-    int new_charsize = font->height * new_width;
-    int old_charsize = old_height * old_bytes;
+    int new_charsize = font->height * ((font->width+7)/8);
+    int old_charsize = old_height * ((old_width+7)/8);
+    unsigned int count = font->data_size/old_charsize;
 
     /* we use old_length here because the user may have chosen another length,
      * we will not apply this until later when we call handle_length_change().
@@ -69,90 +61,10 @@ void handle_hw_change(struct font_s *font, int old_height, int old_width,
     memset((void *)newdata, 0, new_datasize);
 
     status_msg("Applying changes to glyph size...");
-    
-    int i = 0;
-    int i2 = 0;
-    unsigned int base_o1 = 1 << (old_width-1);
-    if(old_width < 8) base_o1 <<= (8-old_width);
-    else if(old_width > 8 && old_width < 16) base_o1 <<= (16-old_width);
-    else if(old_width > 16 && old_width < 32) base_o1 <<= (32-old_width);
-    unsigned int base_o2 = 1 << (font->width-1);
-    if(font->width < 8) base_o2 <<= (8-font->width);
-    else if(font->width > 8 && font->width < 16) base_o2 <<= (16-font->width);
-    else if(font->width > 16 && font->width < 32) base_o2 <<= (32-font->width);
-
-    while(i < (int)font->data_size)
-    {
-        int j = 0;
-        int j2 = 0;
 
-        while(j < old_charsize)
-        {
-            unsigned int line = (unsigned int)(font->data[i+j]);
-            if(old_width > 8) line |= (unsigned int)(font->data[i+j+1]) << 8;
-            if(old_width > 16) line |= (unsigned int)(font->data[i+j+2]) << 16;
-            if(old_width > 24) line |= (unsigned int)(font->data[i+j+3]) << 24;
-            unsigned int line2 = 0;
-            unsigned int o1 = base_o1;
-            unsigned int o2 = base_o2;
-            int k = 0;
-
-            while(k < (int)font->width)
-            {
-                if(wskip)    /* shrinking */
-                {
-                    if(line & o1) line2 |= o2;
-                    o1 >>= wskip;
-                    o2 >>= 1;
-                    k++;
-                }
-                else        /* expanding */
-                {
-                    char rw = rwskip;
-                    while(rw--)
-                    {
-                        if(line & o1) line2 |= o2;
-                        o2 >>= 1;
-                    }
-
-                    o1 >>= 1;
-                    k += rwskip;
-
-                    if(o1 == 0)
-                        while(k++ < (int)font->width) ;
-                }
-            }
-
-            newdata[i2+j2] = (char)(line2 & 0xFF);
-            if(font->width > 8) newdata[i2+j2+1] = (char)((line2 >> 8) & 0xFF);
-            if(font->width > 16) newdata[i2+j2+2] = (char)((line2 >> 16) & 0xFF);
-            if(font->width > 24) newdata[i2+j2+3] = (char)((line2 >> 24) & 0xFF);
-
-            if(hskip)    /* shriking */
-            {
-                j += (hskip*old_bytes);
-                j2 += new_bytes;
-            }
-            else        /* expanding */
-            {
-                char rh = rhskip;
-                while(rh--)
-                {
-                    newdata[i2+j2] = (char)(line2 & 0xFF);
-                    if(font->width > 8) newdata[i2+j2+1] = (char)((line2 >> 8) & 0xFF);
-                    if(font->width > 16) newdata[i2+j2+2] = (char)((line2 >> 16) & 0xFF);
-                    if(font->width > 24) newdata[i2+j2+3] = (char)((line2 >> 24) & 0xFF);
-                    j2 += new_bytes;
-                }
-                j += old_bytes;
-            }
-
-            /* make sure we don't write past this char's size */
-            if(j2 >= new_charsize) break;
-        }
-        i += old_charsize;
-        i2 += new_charsize;
-    }
+    if(count > old_length) count = old_length;
+    scale_glyph_data(font, (unsigned char *)newdata, count, old_width, old_height,
+                     font->width, font->height, scale_mode);
 
     font->charsize = new_charsize;
     font->module->handle_hw_change(font, newdata, new_datasize);
@@ -161,6 +73,14 @@ void handle_hw_change(struct font_s *font, int old_height, int old_width,
     force_font_dirty(font);
 }
 
+void handle_hw_change(struct font_s *font, int old_height, int old_width,
+                                           unsigned int old_length, int scale_mode)
+{
+    stats_begin(STATS_HW_CHANGE);
+    __handle_hw_change(font, old_height, old_width, old_length, scale_mode);
+    stats_end(STATS_HW_CHANGE);
+}
+
 /////////////////////////////////////////////////
 /////////////////////////////////////////////////
 /////////////////////////////////////////////////
@@ -458,29 +378,6 @@ void handle_unicode_table_change(struct font_s *font, char old_has_unicode_table
 }
 
 
-void handle_version_change(struct font_s *font, char old_version)
-{
-    if(font->version == old_version) return;
-
-    char ver = font->version;
-    if(ver > VER_PSF2) font->version = VER_PSF1;
-    font->module->convert_to_psf(font);
-    if(ver > VER_PSF2) font->version = ver;
-
-    struct module_s *newmod = (struct module_s *)NULL;
-    if(font->version <= 2)
-        newmod = get_module_by_name("psf");
-    else
-        newmod = get_module_by_name(get_version_str(font->version));
-
-    if(!newmod) return;
-    font->module = newmod;
-    if(font->version > VER_PSF2)
-        font->module->handle_version_change(font, old_version);
-    force_font_dirty(font);
-}
-
-
 void refresh_metrics_window(struct font_s *font, int x, int y, int sel)
 {
     /* print metrics */
@@ -837,6 +734,19 @@ skip:
         }
     }
 
+    /* offer pixel-art upscaling if the glyphs are being doubled or quadrupled */
+    int scale_mode = SCALE_NEAREST;
+
+    if(can_scale_smooth(old_width, old_height, font->width, font->height))
+    {
+        int m = msgBox("Glyphs are being scaled up. Use smooth\n"
+                       "(Scale2x) scaling instead of plain pixel\n"
+                       "doubling?", 
+                       BUTTON_YES|BUTTON_NO, CONFIRM);
+
+        if(m == BUTTON_YES) scale_mode = SCALE_SMOOTH;
+    }
+
     if(!ok_to_change_length(font, old_length))
     {
         goto cancel;
@@ -847,7 +757,22 @@ skip:
     font->has_unicode_table = old_has_unicode_table;
     font->version = old_version;
 
-    handle_hw_change(font, old_height, old_width, old_length);
+    /* record the font as it was before the change */
+    unsigned int new_height = font->height;
+    unsigned int new_width = font->width;
+    unsigned int new_charsize = font->charsize;
+    unsigned int new_length = font->length;
+    font->height = old_height;
+    font->width = old_width;
+    font->charsize = old_charsize;
+    font->length = old_length;
+    undo_begin_font(font);
+    font->height = new_height;
+    font->width = new_width;
+    font->charsize = new_charsize;
+    font->length = new_length;
+
+    handle_hw_change(font, old_height, old_width, old_length, scale_mode);
     handle_length_change(font, old_length);
 
     font->has_unicode_table = tmp_has_unicode_table;
@@ -856,6 +781,7 @@ skip:
     handle_unicode_table_change(font, old_has_unicode_table);
     handle_version_change(font, old_version);
     calc_max_zoom(font);
+    undo_end(font);
     //status_msg("Font metrics updated successfully.");
     return 0;
 
@@ -19,9 +19,13 @@
  */    
 
 #include <ctype.h>
+#include "../core.h"
+#ifndef FONTOPIA_LIBRARY
 #include "../defs.h"
+#endif
 #include "../view.h"
 #include "../metadata.h"
+#include "../ink.h"
 #include "bdf.h"
 
 struct bdf_keyword_s bdf_keywords[] =
@@ -75,11 +79,6 @@ struct bdf_keyword_s bdf_keywords[] =
   { "ENDCHAR",            BDF_REQ_YES, BDF_GLYPH_SCOPE,  0, { 0 } },
 };
 
-/* we will use this bitmap to check that all the required words
- * were found in the file, otherwise the file is considered corrupt.
- */
-unsigned long long keyword_bitmap;
-
 /* Helper function: skip all spaces to the next non-space char */
 static inline void skip_spaces(char **s)
 {
@@ -88,23 +87,22 @@ static inline void skip_spaces(char **s)
     *s = s2;
 }
 
-char buf[512];
-
-/* Helper function: get the next keyword */
-static inline char *get_keyword(char **s)
+/* Helper function: get the next keyword into the context's buffer */
+static inline char *get_keyword(struct font_ctx_s *ctx, char **s)
 {
-    int counter = 0;
+    char *buf = ctx->buf;
+    int counter = 0, max = sizeof(ctx->buf)-1;
     char *s2 = *s;
 
     if(*s2 == '\"')
     {
         s2++;
-        while(*s2 && *s2 != '\"') { buf[counter++] = *s2++; }
-        s2++;
+        while(*s2 && *s2 != '\"') { if(counter < max) buf[counter++] = *s2; s2++; }
+        if(*s2) s2++;
     }
     else
     {
-        while(*s2 && *s2 != ' ') { buf[counter++] = *s2++; }
+        while(*s2 && *s2 != ' ') { if(counter < max) buf[counter++] = *s2; s2++; }
     }
 
     buf[counter] = '\0';
@@ -130,24 +128,24 @@ static inline char get_keyword_index(char *keyword)
 }
 
 /* Helper function: get keyword argument of type STRING */
-static inline char *get_string(char **s)
+static inline char *get_string(struct font_ctx_s *ctx, char **s)
 {
     skip_spaces(s);
-    return get_keyword(s);
+    return get_keyword(ctx, s);
 }
 
 /* Helper function: get keyword argument of type INTEGER */
-static inline int get_integer(char **s)
+static inline int get_integer(struct font_ctx_s *ctx, char **s)
 {
     skip_spaces(s);
-    return atoi(get_keyword(s));
+    return atoi(get_keyword(ctx, s));
 }
 
 /* Helper function: get keyword argument of type NUMBER */
-static inline int get_number(char **s)
+static inline int get_number(struct font_ctx_s *ctx, char **s)
 {
     skip_spaces(s);
-    return atof(get_keyword(s));
+    return atof(get_keyword(ctx, s));
 }
 
 /* Helper function: get hex number, used in parsing BITMAP structure */
@@ -247,12 +245,14 @@ go:
 }
 
 
-struct font_s *bdf_load_font_file(char *file_name)
+struct font_s *bdf_load_font_file(struct font_ctx_s *ctx)
 {
+    char *file_name = ctx->file_name;
     FILE *font_file = (FILE *)NULL;
     char *file_data = (char *)NULL;
     struct font_s *font = (struct font_s *)NULL;
     if(!file_name) return (struct font_s *)NULL;
+    stats_begin(STATS_READ);
     if(!(font_file = fopen(file_name, "rb")))
     {
         status_error("Error opening file");
@@ -275,7 +275,9 @@ struct font_s *bdf_load_font_file(char *file_name)
     i = fread(file_data, 1, file_size, font_file);
     if(i != file_size) goto file_read_error;
     fclose(font_file);
-    font = bdf_load_font(file_name, (unsigned char *)file_data, file_size);
+    stats_end(STATS_READ);
+    stats_add(STATS_BYTES_READ, file_size);
+    font = bdf_load_font(ctx, (unsigned char *)file_data, file_size);
     free(file_data);
     return font;
     
@@ -297,15 +299,13 @@ end:
 }
 
 
-struct font_s *bdf_load_font(char *file_name, unsigned char *file_data, 
+struct font_s *bdf_load_font(struct font_ctx_s *ctx, unsigned char *file_data, 
                              long file_size __attribute__((unused)))
 {
     struct font_s *font = (struct font_s *)NULL;
     font = (struct font_s *)malloc(sizeof(struct font_s));
     if(!font) goto memory_error;
 
-    (void)file_name;
-
     memset((void *)font, 0, sizeof(struct font_s));
     unsigned char *data = (unsigned char *)NULL;
     unsigned short *unicode_info = NULL;
@@ -321,9 +321,12 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
     /* to be assigned later when we know char count */
     struct char_info_s *char_info = NULL;
 
-    char *s = strtok((char *)file_data, "\n");
+    /* we will use this bitmap to check that all the required words
+     * were found in the file, otherwise the file is considered corrupt.
+     */
+    char *s = strtok_r((char *)file_data, "\n", &ctx->next_line);
     if(!s) goto file_read_error;
-    keyword_bitmap = 0;
+    ctx->keyword_bitmap = 0;
 
     /* there is no signature. just make sure the first line is legit. */
     /*
@@ -343,12 +346,11 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
     int xoff = 0, yoff = 0;
     int globalxoff = 0, globalyoff = 0;
     int i, chars = 0;
-    unsigned int data_index = 0;
     
     do
     {
         skip_spaces(&s);
-        char *keyword = get_keyword(&s);
+        char *keyword = get_keyword(ctx, &s);
         char index = get_keyword_index(keyword);
 
         if(index == BDF_TOTAL_KEYWORDS)
@@ -360,7 +362,7 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
         }
 
         /* mark the keyword as found in our bitmap */
-        keyword_bitmap |= (1 << index);
+        ctx->keyword_bitmap |= (1ULL << index);
 
         /* now check the keyword */
         switch(index)
@@ -386,112 +388,113 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
             case FONT_KEYWORD:
                 skip_spaces(&s);
                 int z = 0;
-                while(*s != '\0') buf[z++] = *s++;
-                save_metadata_str(font, METADATA_FONT, buf); //get_string(&s));
+                while(*s != '\0' && z < (int)sizeof(ctx->buf)-1) ctx->buf[z++] = *s++;
+                ctx->buf[z] = '\0';
+                save_metadata_str(font, METADATA_FONT, ctx->buf); //get_string(ctx, &s));
                 break;
 
             case COPYRIGHT_KEYWORD:
-                save_metadata_str(font, METADATA_COPYRIGHT, get_string(&s));
+                save_metadata_str(font, METADATA_COPYRIGHT, get_string(ctx, &s));
                 break;
 
             case FONT_VERSION_KEYWORD:
-                save_metadata_str(font, METADATA_FONT_VERSION, get_string(&s));
+                save_metadata_str(font, METADATA_FONT_VERSION, get_string(ctx, &s));
                 break;
 
             case FONT_TYPE_KEYWORD:
-                save_metadata_str(font, METADATA_FONT_TYPE, get_string(&s));
+                save_metadata_str(font, METADATA_FONT_TYPE, get_string(ctx, &s));
                 break;
 
             case FOUNDRY_KEYWORD:
-                save_metadata_str(font, METADATA_FOUNDRY, get_string(&s));
+                save_metadata_str(font, METADATA_FOUNDRY, get_string(ctx, &s));
                 break;
 
             case FAMILY_NAME_KEYWORD:
-                save_metadata_str(font, METADATA_FAMILY_NAME, get_string(&s));
+                save_metadata_str(font, METADATA_FAMILY_NAME, get_string(ctx, &s));
                 break;
 
             case WEIGHT_NAME_KEYWORD:
-                save_metadata_str(font, METADATA_WEIGHT_NAME, get_string(&s));
+                save_metadata_str(font, METADATA_WEIGHT_NAME, get_string(ctx, &s));
                 break;
 
             case SLANT_KEYWORD:
-                save_metadata_str(font, METADATA_SLANT, get_string(&s));
+                save_metadata_str(font, METADATA_SLANT, get_string(ctx, &s));
                 break;
 
             case SETWIDTH_NAME_KEYWORD:
-                save_metadata_str(font, METADATA_SETWIDTH_NAME, get_string(&s));
+                save_metadata_str(font, METADATA_SETWIDTH_NAME, get_string(ctx, &s));
                 break;
 
             case PIXEL_SIZE_KEYWORD:
-                metadata[METADATA_PIXEL_SIZE].value = get_integer(&s);
+                metadata[METADATA_PIXEL_SIZE].value = get_integer(ctx, &s);
                 break;
 
             case POINT_SIZE_KEYWORD:
-                metadata[METADATA_POINT_SIZE].value = get_integer(&s);
+                metadata[METADATA_POINT_SIZE].value = get_integer(ctx, &s);
                 break;
 
             case RESOLUTION_X_KEYWORD:
-                metadata[METADATA_RESOLUTION_X].value = get_integer(&s);
+                metadata[METADATA_RESOLUTION_X].value = get_integer(ctx, &s);
                 break;
 
             case RESOLUTION_Y_KEYWORD:
-                metadata[METADATA_RESOLUTION_Y].value = get_integer(&s);
+                metadata[METADATA_RESOLUTION_Y].value = get_integer(ctx, &s);
                 break;
 
             case SPACING_KEYWORD:
-                save_metadata_str(font, METADATA_SPACING, get_string(&s));
+                save_metadata_str(font, METADATA_SPACING, get_string(ctx, &s));
                 break;
 
             case AVERAGE_WIDTH_KEYWORD:
-                metadata[METADATA_AVERAGE_WIDTH].value = get_integer(&s);
+                metadata[METADATA_AVERAGE_WIDTH].value = get_integer(ctx, &s);
                 break;
 
             case CHARSET_REGISTRY_KEYWORD:
-                save_metadata_str(font, METADATA_CHARSET_REGISTRY, get_string(&s));
+                save_metadata_str(font, METADATA_CHARSET_REGISTRY, get_string(ctx, &s));
                 break;
 
             case CHARSET_ENCODING_KEYWORD:
-                save_metadata_str(font, METADATA_CHARSET_ENCODING, get_string(&s));
+                save_metadata_str(font, METADATA_CHARSET_ENCODING, get_string(ctx, &s));
                 break;
 
             case ADD_STYLE_NAME_KEYWORD:
-                save_metadata_str(font, METADATA_ADD_STYLE_NAME, get_string(&s));
+                save_metadata_str(font, METADATA_ADD_STYLE_NAME, get_string(ctx, &s));
                 break;
 
             case UNDERLINE_POSITION_KEYWORD:
-                metadata[METADATA_UNDERLINE_POSITION].value = get_integer(&s);
+                metadata[METADATA_UNDERLINE_POSITION].value = get_integer(ctx, &s);
                 break;
 
             case UNDERLINE_THICKNESS_KEYWORD:
-                metadata[METADATA_UNDERLINE_THICKNESS].value = get_integer(&s);
+                metadata[METADATA_UNDERLINE_THICKNESS].value = get_integer(ctx, &s);
                 break;
 
             case CAP_HEIGHT_KEYWORD:
-                metadata[METADATA_CAP_HEIGHT].value = get_integer(&s);
+                metadata[METADATA_CAP_HEIGHT].value = get_integer(ctx, &s);
                 break;
 
             case X_HEIGHT_KEYWORD:
-                metadata[METADATA_X_HEIGHT].value = get_integer(&s);
+                metadata[METADATA_X_HEIGHT].value = get_integer(ctx, &s);
                 break;
 
             case FONT_ASCENT_KEYWORD:
-                metadata[METADATA_FONT_ASCENT].value = get_integer(&s);
+                metadata[METADATA_FONT_ASCENT].value = get_integer(ctx, &s);
                 break;
 
             case FONT_DESCENT_KEYWORD:
-                metadata[METADATA_FONT_DESCENT].value = get_integer(&s);
+                metadata[METADATA_FONT_DESCENT].value = get_integer(ctx, &s);
                 break;
 
             case DEFAULT_CHAR_KEYWORD:
-                metadata[METADATA_DEFAULT_CHAR].value = get_integer(&s);
+                metadata[METADATA_DEFAULT_CHAR].value = get_integer(ctx, &s);
                 break;
 
             case FONTBOUNDINGBOX_KEYWORD:
                 if(scope != BDF_GLOBAL_SCOPE) goto corrupt_file;
-                globalw = get_integer(&s);
-                globalh = get_integer(&s);
-                globalxoff = get_integer(&s);
-                globalyoff = get_integer(&s);
+                globalw = get_integer(ctx, &s);
+                globalh = get_integer(ctx, &s);
+                globalxoff = get_integer(ctx, &s);
+                globalyoff = get_integer(ctx, &s);
                 font->width = globalw;
                 font->height = globalh;
                 globaln = ((globalw+7)/8)*2;
@@ -504,7 +507,7 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
 
             case CHARS_KEYWORD:
                 scope = BDF_CHARS_SCOPE;
-                font->length = get_integer(&s);
+                font->length = get_integer(ctx, &s);
 
                 if(font->length > (unsigned int)-1)
                 {
@@ -579,7 +582,12 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
                         strcat(buf, "' not in Unicode, Adobe\n"
                                     "Standard Encoding, or Postscript char\n"
                                     "name lists. I Can't read this encoding!");
-                        msgBox(buf, BUTTON_OK, ERROR);
+#ifdef FONTOPIA_LIBRARY
+                        status_error(buf);
+#else
+                        if(headless) status_error(buf);
+                        else msgBox(buf, BUTTON_OK, ERROR);
+#endif
                         goto go;
                     }
                 }
@@ -604,10 +612,10 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
 
             case BBX_KEYWORD:
                 if(scope != BDF_GLYPH_SCOPE) goto corrupt_file;
-                w = get_integer(&s);
-                h = get_integer(&s);
-                xoff = get_integer(&s);
-                yoff = get_integer(&s);
+                w = get_integer(ctx, &s);
+                h = get_integer(ctx, &s);
+                xoff = get_integer(ctx, &s);
+                yoff = get_integer(ctx, &s);
 
                 if(font->char_info)
                 {
@@ -622,8 +630,8 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
                 if(scope != BDF_GLYPH_SCOPE) goto corrupt_file;
                 if(font->char_info)
                 {
-                    int swx1 = get_integer(&s);
-                    int swy1 = get_integer(&s);
+                    int swx1 = get_integer(ctx, &s);
+                    int swy1 = get_integer(ctx, &s);
                     char_info[chars].swidthX = swx1;
                     char_info[chars].swidthY = swy1;
                 }
@@ -633,8 +641,8 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
                 if(scope != BDF_GLYPH_SCOPE) goto corrupt_file;
                 if(font->char_info)
                 {
-                    int dwx1 = get_integer(&s);
-                    int dwy1 = get_integer(&s);
+                    int dwx1 = get_integer(ctx, &s);
+                    int dwy1 = get_integer(ctx, &s);
                     char_info[chars].dwidthX = dwx1;
                     char_info[chars].dwidthY = dwy1;
                 }
@@ -644,7 +652,7 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
                 if(scope != BDF_GLYPH_SCOPE) goto corrupt_file;
                 if(font->char_info)
                 {
-                    int encoding = get_integer(&s);
+                    int encoding = get_integer(ctx, &s);
                     char_info[chars].encoding = encoding;
                 }
                 break;
@@ -658,58 +666,50 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
                     //w = globalw; h = globalh;
                 }
 
-                i = h;
-                data_index = chars * font->charsize;
-
-                while(i && (s = strtok(NULL, "\n")))
+                /*
+                 * the bitmap covers the glyph's bounding box (BBX), place it
+                 * in the glyph cell relative to the font bounding box.
+                 */
+                stats_begin(STATS_DECODE);
                 {
-                    /* how many nibbles do we have per line? */
-                    unsigned int n = ((w+7)/8)*2;
-                    skip_spaces(&s);
-                    //printf("0x%s: ", s);
-                    if(strlen(s) < n) goto corrupt_file;
-
-                    unsigned int line = get_hex(s, n);
-                    unsigned int j;
-
-                    /* convert nibble count to byte count */
-                    n >>= 1;
-                    for(j = 0; j < n; j++)
-                    {
-                        data[data_index+j] = line & 0xFF;
-                        line >>= 8;
-                    }
+                    unsigned char *glyph = data+(chars*font->charsize);
+                    int bytes = globaln >> 1;
+                    int row = (globalh+globalyoff)-(yoff+h);
+                    int col = xoff-globalxoff;
+                    uint64_t mask = glyph_row_mask(globalw);
+
+                    if(row+h > globalh) row = globalh-h;
+                    if(row < 0) row = 0;
+                    memset(glyph, 0, font->charsize);
 
-                    n = globaln >> 1;
-                    for( ; j < n; j++)
+                    for(i = 0; i < h; i++)
                     {
-                        data[data_index+j] = 0;
-                    }
-                    data_index += n;
-                    i--;
-                }
+                        /* how many nibbles do we have per line? */
+                        unsigned int n = ((w+7)/8)*2;
+                        unsigned int j;
+                        uint64_t line = 0;
 
-                if(i) goto corrupt_file;
-                /* fill the rest of lines (if any) with zeroes */
-                i = globalh-h;
+                        if(!(s = strtok_r(NULL, "\n", &ctx->next_line))) goto corrupt_file;
+                        skip_spaces(&s);
+                        if(strlen(s) < n) goto corrupt_file;
 
-                while(i--)
-                {
-                    /* how many nibbles do we have per line? */
-                    unsigned int n = ((globalw+7)/8)*2;
-                    n >>= 1;
-                    unsigned int j;
+                        /* read one byte at a time, leftmost pixel in the MSB */
+                        for(j = 0; j < n/2 && j < 8; j++)
+                            line |= (uint64_t)get_hex(s+(j*2), 2) << (56-(j*8));
 
-                    for(j = 0; j < n; j++)
-                    {
-                        data[data_index+j] = 0;
+                        if(col >= 64 || col <= -64) line = 0;
+                        else if(col >= 0) line >>= col;
+                        else line <<= -col;
+
+                        if(row+i < globalh)
+                            store_glyph_row(glyph+((row+i)*bytes), bytes, line & mask);
                     }
-                    data_index += n;
                 }
+                stats_end(STATS_DECODE);
 
                 break;
         }
-    } while((s = strtok(NULL, "\n")));
+    } while((s = strtok_r(NULL, "\n", &ctx->next_line)));
 
     /* check we got all chars */
     if(chars != (int)font->length) goto corrupt_file;
@@ -719,20 +719,18 @@ struct font_s *bdf_load_font(char *file_name, unsigned char *file_data,
     {
         if(bdf_keywords[i].required)
         {
-            if(!(keyword_bitmap & (1 << i))) goto corrupt_file;
+            if(!(ctx->keyword_bitmap & (1ULL << i))) goto corrupt_file;
         }
     }
     
     /* passed all tests? great! */
     create_empty_unitab(font);
     get_font_unicode_table(font);
-    calc_max_zoom(font);
     font->state = OPENED;
     font->module = get_module_by_name("bdf");
     /* something REALLY WRONG happended here */
     if(!font->module) goto undefined_error;
         
-    reset_all_cursors();
     return font;
 
 undefined_error:
@@ -765,7 +763,7 @@ go:
 }
 
 
-int bdf_write_to_file(FILE *file, struct font_s *font)
+int bdf_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font)
 {
     if(!file || !font) return 1;
     int res;
@@ -778,9 +776,9 @@ int bdf_write_to_file(FILE *file, struct font_s *font)
     }
     else
     {
-        char *name = strrchr(font_file_name, '/');
-        if(name) name++;
-        else name = font_file_name;
+        char *name = ctx->file_name ? ctx->file_name : "untitled";
+        char *slash = strrchr(name, '/');
+        if(slash) name = slash+1;
 
         char *dot = strrchr(name, '.');
         if(dot)
@@ -831,6 +829,11 @@ int bdf_write_to_file(FILE *file, struct font_s *font)
     int i, j, l;
     unsigned char *data = font->data;
     struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+
+    /* shrink each glyph's BBX to its ink */
+    int inked = set_font_ink_metrics(font);
 
     for(i = 0; i < (int)font->length; i++)
     {
@@ -879,25 +882,49 @@ int bdf_write_to_file(FILE *file, struct font_s *font)
 
         res = fprintf(file, "BITMAP\n");
 
-        for(j = 0; j < (int)font->height; j++)
+        if(inked)
         {
-            unsigned int line2 = 0;
-            unsigned int line = 0;
+            /* write only the part of the glyph cell inside the glyph's BBX */
+            int xorigin, ascent, left, top;
+            int n = (char_info[i].BBw+7)/8;
+
+            get_glyph_origin(font, i, &xorigin, &ascent);
+            left = char_info[i].BBXoff-xorigin;
+            top = ascent-char_info[i].BBYoff-char_info[i].BBh;
 
-            for(l = 0; l < ((int)font->width+7)/8; l++)
+            for(j = 0; j < char_info[i].BBh; j++)
             {
-                line = (line) | (unsigned int)data[l] << (l*8);
+                uint64_t line = load_glyph_row(data+((top+j)*bytes), bytes, mask) << left;
+
+                for(l = 0; l < n; l++)
+                    fprintf(file, "%02X", (unsigned int)(line >> (56-(l*8))) & 0xFF);
+                res = fprintf(file, "\n");
             }
 
-            line2 = line;
-            l = (font->width+7)/8;
+            data += font->charsize;
+        }
+        else
+        {
+            for(j = 0; j < (int)font->height; j++)
+            {
+                unsigned int line2 = 0;
+                unsigned int line = 0;
 
-            if(l == 1) fprintf(file, "%02X\n", line2);
-            else if(l == 2) fprintf(file, "%04X\n", line2);
-            else if(l == 3) fprintf(file, "%06X\n", line2);
-            else if(l == 4) fprintf(file, "%08X\n", line2);
-            else fprintf(file, "%0X\n", line2);
-            data += l;
+                for(l = 0; l < ((int)font->width+7)/8; l++)
+                {
+                    line = (line) | (unsigned int)data[l] << (l*8);
+                }
+
+                line2 = line;
+                l = (font->width+7)/8;
+
+                if(l == 1) fprintf(file, "%02X\n", line2);
+                else if(l == 2) fprintf(file, "%04X\n", line2);
+                else if(l == 3) fprintf(file, "%06X\n", line2);
+                else if(l == 4) fprintf(file, "%08X\n", line2);
+                else fprintf(file, "%0X\n", line2);
+                data += l;
+            }
         }
 
         res = fprintf(file, "ENDCHAR\n");
@@ -962,6 +989,8 @@ void bdf_handle_version_change(struct font_s *font,
     font->file_hdr = 0;
     //bdf_kill_unitab(font);
 
+    struct metadata_item_s *metadata;
+
     if(!font->has_metadata)
     {
         font->has_metadata = 1;
@@ -969,6 +998,11 @@ void bdf_handle_version_change(struct font_s *font,
         if(!font->metadata) return;
         /* copy the standard metadata table, to fill it later */
         memcpy(font->metadata, (void *)&metadata_table, sizeof(metadata_table));
+        /* the glyphs sit on the baseline, as create_char_info() assumes */
+        metadata = (struct metadata_item_s *)font->metadata;
+        metadata[METADATA_PIXEL_SIZE].value = font->height;
+        metadata[METADATA_FONT_ASCENT].value = font->height;
+        metadata[METADATA_FONT_DESCENT].value = 0;
     }
 
     if(!font->char_info)
@@ -976,7 +1010,7 @@ void bdf_handle_version_change(struct font_s *font,
         create_char_info(font);
     }
 
-    struct metadata_item_s *metadata = (struct metadata_item_s *)font->metadata;
+    metadata = (struct metadata_item_s *)font->metadata;
     metadata[METADATA_FONTBOUNDINGBOX_X].value = font->width;
     metadata[METADATA_FONTBOUNDINGBOX_Y].value = font->height;
     metadata[METADATA_FONTBOUNDINGBOX_XOFF].value = 0;
@@ -1082,6 +1116,8 @@ int bdf_next_acceptable_height(struct font_s *font)
  * ******************************/
 struct module_s bdf_module;
 
+struct file_sig_s bdf_sig = { 0, 9, "STARTFONT", NULL, NULL, NULL };
+
 void bdf_init_module()
 {
     strcpy(bdf_module.mod_name, "bdf");
@@ -1108,5 +1144,6 @@ void bdf_init_module()
     bdf_module.next_acceptable_height = bdf_next_acceptable_height;
     register_module(&bdf_module);
     add_file_extension("bdf", "bdf");
+    add_file_signature(&bdf_sig, "bdf");
 }
 
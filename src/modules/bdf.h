@@ -114,9 +114,9 @@ struct bdf_keyword_s
 
 
 struct font_s *bdf_create_empty_font();
-struct font_s *bdf_load_font_file(char *file_name);
-struct font_s *bdf_load_font(char *file_name, unsigned char *file_data, long file_size);
-int bdf_write_to_file(FILE *file, struct font_s *font);
+struct font_s *bdf_load_font_file(struct font_ctx_s *ctx);
+struct font_s *bdf_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size);
+int bdf_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font);
 void bdf_handle_hw_change(struct font_s *font, char *newdata, long new_datasize);
 void bdf_handle_version_change(struct font_s *font, char old_version);
 //void bdf_export_unitab(struct font_s *font, FILE *f);
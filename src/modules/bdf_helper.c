@@ -19,7 +19,7 @@
  */    
 
 #include <ctype.h>
-#include "../defs.h"
+#include "../core.h"
 #include "../view.h"
 #include "../metadata.h"
 #include "bdf.h"
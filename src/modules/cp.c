@@ -18,10 +18,15 @@
  *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
  */    
 
+#ifndef FONTOPIA_LIBRARY
 #include <ncurses.h>
+#endif
 #include "cp.h"
 #include "cp_include.h"
+#include "../core.h"
+#ifndef FONTOPIA_LIBRARY
 #include "../defs.h"
+#endif
 #include "../view.h"
 
 int cp_files_count = 33+49;
@@ -170,8 +175,9 @@ end:
 }
 
 
-int cp_write_to_file(FILE *file, struct font_s *font)
+int cp_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font)
 {
+    (void)ctx;
     if(!file || !font) return 1;
     size_t res;
     /* 1- write the header */
@@ -184,12 +190,14 @@ int cp_write_to_file(FILE *file, struct font_s *font)
 }
 
 
-struct font_s *cp_load_font_file(char *file_name)
+struct font_s *cp_load_font_file(struct font_ctx_s *ctx)
 {
+    char *file_name = ctx->file_name;
     FILE *font_file = (FILE *)NULL;
     char *file_data = (char *)NULL;
     struct font_s *font = (struct font_s *)NULL;
     if(!file_name) return (struct font_s *)NULL;
+    stats_begin(STATS_READ);
     if(!(font_file = fopen(file_name, "rb")))
     {
         status_error("Error opening file");
@@ -212,7 +220,9 @@ struct font_s *cp_load_font_file(char *file_name)
     i = fread(file_data, 1, file_size, font_file);
     if(i != file_size) goto file_read_error;
     fclose(font_file);
-    font = cp_load_font(file_name, (unsigned char *)file_data, file_size);
+    stats_end(STATS_READ);
+    stats_add(STATS_BYTES_READ, file_size);
+    font = cp_load_font(ctx, (unsigned char *)file_data, file_size);
     free(file_data);
     return font;
     
@@ -234,13 +244,13 @@ end:
 }
 
 
-struct font_s *cp_load_font(char *file_name, unsigned char *file_data, long file_size)
+struct font_s *cp_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size)
 {
     struct font_s *font = (struct font_s *)NULL;
     struct cp_header *hdr = (struct cp_header *)file_data;
     int i;
 
-    (void)file_name;
+    (void)ctx;
 
     /* Basic error checking */
     if(!hdr->entry_hdr.cpeh_size) goto corrupt_file;
@@ -280,10 +290,13 @@ struct font_s *cp_load_font(char *file_name, unsigned char *file_data, long file
     font->file_hdr = cphdr;
     font->header_size = sizeof(struct cp_header);
 
+    /* the glyphs are used as they are in the file */
+    stats_begin(STATS_DECODE);
     font->raw_data_size = file_size-sizeof(struct cp_header);
     font->raw_data = (void *)malloc(font->raw_data_size);
     if(!font->raw_data) goto memory_error;
     memcpy((void *)font->raw_data, (void *)(file_data+sizeof(struct cp_header)), font->raw_data_size);
+    stats_end(STATS_DECODE);
     //font->raw_data = file_data;
     //font->data = (unsigned char *)(first_font_hdr);
     font->data = (unsigned char *)font->raw_data;
@@ -297,13 +310,10 @@ struct font_s *cp_load_font(char *file_name, unsigned char *file_data, long file
     cp_handle_unicode_table_change(font);
     
     font->state = OPENED;
-    calc_max_zoom(font);
-    
     font->module = get_module_by_name("cp");
     /* something REALLY WRONG happended here */
     if(!font->module) goto undefined_error;
 
-    reset_all_cursors();
     return font;
 
 undefined_error:
@@ -652,13 +662,20 @@ void cp_handle_unicode_table_change(struct font_s *font)
         font->utf_version = VER_PSF1;
         //status_error("CP fonts have no Unicode tables");
     }
-
-    calc_max_zoom(font);
 }
 
 
 int show_cp_selection_dialog(int first_selection)
 {
+    if(first_selection < 0) first_selection = 0;
+    if(first_selection >= cp_files_original_ones) first_selection = cp_files_original_ones-1;
+
+#ifdef FONTOPIA_LIBRARY
+    /* no one to ask, keep the default (codepage 437 for new fonts) */
+    return first_selection;
+#else
+    if(headless) return first_selection;
+
     int h = 12;
     int w = 32;
     int x = 1, y = 1;
@@ -668,9 +685,6 @@ int show_cp_selection_dialog(int first_selection)
     if(w > SCREEN_W) w = SCREEN_W-1;
     else y = (SCREEN_W-w)/2;
   
-    if(first_selection < 0) first_selection = 0;
-    if(first_selection >= cp_files_original_ones) first_selection = cp_files_original_ones-1;
-  
     int vis_entries = h-1;
     int selected_entry = 0;
     int first_vis_entry = 0;
@@ -730,6 +744,7 @@ draw_win:
                 return -1;
         }
     }
+#endif
 }
 
 
@@ -751,6 +766,7 @@ void cp_change_codepage(struct font_s *font)
     cp_kill_unitab(font);
     font->has_unicode_table = 1;
     cp_handle_unicode_table_change(font);
+    calc_max_zoom(font);
 }
 
 
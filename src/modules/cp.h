@@ -62,9 +62,9 @@ struct cp_header
 }__attribute__((packed));
 
 struct font_s *cp_create_empty_font();
-struct font_s *cp_load_font_file(char *file_name);
-struct font_s *cp_load_font(char *file_name, unsigned char *file_data, long file_size);
-int cp_write_to_file(FILE *file, struct font_s *font);
+struct font_s *cp_load_font_file(struct font_ctx_s *ctx);
+struct font_s *cp_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size);
+int cp_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font);
 void cp_change_active_font(struct font_s *font, char cp_index);
 void cp_handle_hw_change(struct font_s *font, char *newdata, long new_datasize);
 void cp_handle_version_change(struct font_s *font, char old_version);
@@ -29,6 +29,8 @@
 #define MAX_MODULE_NAME_LEN         10
 #define MAX_FILE_EXTENSION_LEN      5
 
+struct font_ctx_s;
+
 struct module_s
 {
     char mod_name[MAX_MODULE_NAME_LEN+1];
@@ -36,9 +38,9 @@ struct module_s
     char max_height;                /* max font height */
     unsigned int max_length;        /* max font length */
     struct font_s *(*create_empty_font)();
-    int (*write_to_file)(FILE *file, struct font_s *font);
-    struct font_s *(*load_font_file)(char *file_name);
-    struct font_s *(*load_font)(char *file_name, unsigned char *file_data, long file_size);
+    int (*write_to_file)(struct font_ctx_s *ctx, FILE *file, struct font_s *font);
+    struct font_s *(*load_font_file)(struct font_ctx_s *ctx);
+    struct font_s *(*load_font)(struct font_ctx_s *ctx, unsigned char *file_data, long file_size);
     void (*handle_hw_change)(struct font_s *font, char *newdata, long new_datasize);
     void (*shrink_glyphs)(struct font_s *font, int old_length);
     void (*expand_glyphs)(struct font_s *font, int old_length, int option);
@@ -19,9 +19,10 @@
  */    
 
 #include <ctype.h>
-#include "../defs.h"
+#include "../core.h"
 #include "../view.h"
 #include "../metadata.h"
+#include "../ink.h"
 #include "pcf.h"
 
 extern unsigned short default_unicode_table[]; /* psf.c */
@@ -74,7 +75,7 @@ static inline int32_t pcf_get_lsbint(int32_t i)
 /*
  * make sure the font has a name and other basic data, usually called before saving to file.
  */
-void __pcf_check_font_meta(struct font_s *font, int index, char *value)
+void __pcf_check_font_meta(struct font_s *font, int index, char *value, char *file_name)
 {
     struct metadata_item_s *meta = (struct metadata_item_s *)font->metadata;
 
@@ -88,9 +89,10 @@ void __pcf_check_font_meta(struct font_s *font, int index, char *value)
     {
         case METADATA_FONT:
         case METADATA_FAMILY_NAME:
-            name = strrchr(font_file_name, '/');
+            if(!file_name) file_name = "untitled";
+            name = strrchr(file_name, '/');
             if(name) name++;
-            else name = font_file_name;
+            else name = file_name;
 
             char *dot = strrchr(name, '.');
             if(dot)
@@ -113,17 +115,17 @@ void __pcf_check_font_meta(struct font_s *font, int index, char *value)
     }
 }
 
-void pcf_check_font_meta(struct font_s *font)
+void pcf_check_font_meta(struct font_s *font, char *file_name)
 {
-    __pcf_check_font_meta(font, METADATA_FONT, NULL);
-    __pcf_check_font_meta(font, METADATA_FAMILY_NAME, NULL);
-    __pcf_check_font_meta(font, METADATA_FONT_TYPE, "Bitmap");
-    __pcf_check_font_meta(font, METADATA_WEIGHT_NAME, "Medium");
-    __pcf_check_font_meta(font, METADATA_SLANT, "R");
-    __pcf_check_font_meta(font, METADATA_SETWIDTH_NAME, "Normal");
-    __pcf_check_font_meta(font, METADATA_SPACING, "C");
-    __pcf_check_font_meta(font, METADATA_CHARSET_REGISTRY, "ISO8859");
-    __pcf_check_font_meta(font, METADATA_CHARSET_ENCODING, "1");
+    __pcf_check_font_meta(font, METADATA_FONT, NULL, file_name);
+    __pcf_check_font_meta(font, METADATA_FAMILY_NAME, NULL, file_name);
+    __pcf_check_font_meta(font, METADATA_FONT_TYPE, "Bitmap", file_name);
+    __pcf_check_font_meta(font, METADATA_WEIGHT_NAME, "Medium", file_name);
+    __pcf_check_font_meta(font, METADATA_SLANT, "R", file_name);
+    __pcf_check_font_meta(font, METADATA_SETWIDTH_NAME, "Normal", file_name);
+    __pcf_check_font_meta(font, METADATA_SPACING, "C", file_name);
+    __pcf_check_font_meta(font, METADATA_CHARSET_REGISTRY, "ISO8859", file_name);
+    __pcf_check_font_meta(font, METADATA_CHARSET_ENCODING, "1", file_name);
 }
 
 /////////////////////////////////////////////
@@ -182,13 +184,15 @@ go:
 }
 
 
-struct font_s *pcf_load_font_file(char *file_name)
+struct font_s *pcf_load_font_file(struct font_ctx_s *ctx)
 {
+    char *file_name = ctx->file_name;
     FILE *font_file = (FILE *)NULL;
     char *file_data = (char *)NULL;
     struct font_s *font = (struct font_s *)NULL;
     if(!file_name) return (struct font_s *)NULL;
 
+    stats_begin(STATS_READ);
     if(!(font_file = fopen(file_name, "rb")))
     {
         status_error("Error opening file");
@@ -212,7 +216,9 @@ struct font_s *pcf_load_font_file(char *file_name)
     i = fread(file_data, 1, file_size, font_file);
     if(i != file_size) goto file_read_error;
     fclose(font_file);
-    font = pcf_load_font(file_name, (unsigned char *)file_data, file_size);
+    stats_end(STATS_READ);
+    stats_add(STATS_BYTES_READ, file_size);
+    font = pcf_load_font(ctx, (unsigned char *)file_data, file_size);
     free(file_data);
     return font;
     
@@ -268,10 +274,10 @@ int alloc_font_data(struct font_s *font)
     return 1;
 }
 
-struct font_s *pcf_load_font(char *file_name, unsigned char *file_data,
+struct font_s *pcf_load_font(struct font_ctx_s *ctx, unsigned char *file_data,
                              long file_size __attribute__((unused)))
 {
-    (void)file_name;
+    (void)ctx;
 
     struct font_s *font = (struct font_s *)NULL;
     font = (struct font_s *)malloc(sizeof(struct font_s));
@@ -366,16 +372,16 @@ struct font_s *pcf_load_font(char *file_name, unsigned char *file_data,
         
     if(bitmaps)
     {
+        stats_begin(STATS_DECODE);
         if(!get_bitmap_table(bitmaps, font)) goto corrupt_file;
+        stats_end(STATS_DECODE);
     }
         
-    calc_max_zoom(font);
     font->state = OPENED;
     font->module = get_module_by_name("pcf");
     /* something REALLY WRONG happended here */
     if(!font->module) goto undefined_error;
         
-    reset_all_cursors();
     return font;
 
 undefined_error:
@@ -656,12 +662,15 @@ int get_ink_metrics_table(char *table_data, struct font_s *font)
         struct compressed_metrics *metric = (struct compressed_metrics *)(table_data+6);
                 struct char_info_s *ci = font->char_info;
 
+        // keep the ink box in the glyph's BBX, the way BDF describes it
         while(i-- > 0)
         {
-            ci->BBXoff = metric->left_side_bearing-0x80;
-            ci->BBYoff = metric->right_side_bearing-0x80;
-            ci->BBw    = metric->character_width-0x80;
-            ci->BBh    = metric->character_ascent-0x80;
+            int lsb = metric->left_side_bearing-0x80;
+            int descent = metric->character_descent-0x80;
+            ci->BBXoff = lsb;
+            ci->BBYoff = -descent;
+            ci->BBw    = metric->right_side_bearing-0x80-lsb;
+            ci->BBh    = metric->character_ascent-0x80+descent;
             ci++;
             metric++;
         }
@@ -679,9 +688,9 @@ int get_ink_metrics_table(char *table_data, struct font_s *font)
         while(i--)
         {
             ci->BBXoff = metric->left_side_bearing;
-            ci->BBYoff = metric->right_side_bearing;
-            ci->BBw    = metric->character_width;
-            ci->BBh    = metric->character_ascent;
+            ci->BBYoff = -metric->character_descent;
+            ci->BBw    = metric->right_side_bearing-metric->left_side_bearing;
+            ci->BBh    = metric->character_ascent+metric->character_descent;
             ci++;
             metric++;
         }
@@ -692,6 +701,11 @@ int get_ink_metrics_table(char *table_data, struct font_s *font)
     return 0;
 }
 
+static inline int table_get_short(int16_t n, int swapbytes)
+{
+    return swapbytes ? (int16_t)swap_word((u_int16_t)n) : n;
+}
+
 int get_accel_table(char *table_data, struct font_s *font)
 {
     struct accel_table *acc = (struct accel_table *)table_data;
@@ -706,10 +720,15 @@ int get_accel_table(char *table_data, struct font_s *font)
     metadata[METADATA_FONT_DESCENT].value = descent;
     int i;
 
-    metadata[METADATA_FONTBOUNDINGBOX_X].value = acc->minbounds.left_side_bearing;
-    metadata[METADATA_FONTBOUNDINGBOX_Y].value = acc->minbounds.right_side_bearing;
-    metadata[METADATA_FONTBOUNDINGBOX_XOFF].value = acc->minbounds.character_width;
-    metadata[METADATA_FONTBOUNDINGBOX_YOFF].value = acc->minbounds.character_ascent;
+    // the font bounding box is the union of all the glyph metrics
+    int minlsb  = table_get_short(acc->minbounds.left_side_bearing, swapbytes);
+    int maxrsb  = table_get_short(acc->maxbounds.right_side_bearing, swapbytes);
+    int maxasc  = table_get_short(acc->maxbounds.character_ascent, swapbytes);
+    int maxdesc = table_get_short(acc->maxbounds.character_descent, swapbytes);
+    metadata[METADATA_FONTBOUNDINGBOX_X].value = maxrsb-minlsb;
+    metadata[METADATA_FONTBOUNDINGBOX_Y].value = maxasc+maxdesc;
+    metadata[METADATA_FONTBOUNDINGBOX_XOFF].value = minlsb;
+    metadata[METADATA_FONTBOUNDINGBOX_YOFF].value = -maxdesc;
 
     if(acc->const_metrics)
     {
@@ -841,6 +860,9 @@ int get_bitmap_table(char *table_data, struct font_s *font)
                 d += diff;
                 k += diff;
             }
+            /* the font height came from the metrics, don't trust the bitmaps */
+            if(data+(w > gw ? w : gw) > font->data+font->data_size)
+                goto corrupt_file;
             unsigned int l2 = l;
             int w2 = 0;
             while(w2++ < w)
@@ -891,33 +913,28 @@ int get_encodings_table(char *table_data, struct font_s *font)
     struct metadata_item_s *metadata = (struct metadata_item_s *)font->metadata;
     metadata[METADATA_DEFAULT_CHAR].value = default_char;
 
-    int ilen = (max_char_or_byte2-min_char_or_byte2+1)*(max_byte1-min_byte1+1);
+    min_char_or_byte2 &= 0xff;
+    max_char_or_byte2 &= 0xff;
+    min_byte1 &= 0xff;
+    max_byte1 &= 0xff;
+    if(max_char_or_byte2 < min_char_or_byte2 || max_byte1 < min_byte1) return 0;
+
+    int cols = max_char_or_byte2-min_char_or_byte2+1;
+    int ilen = cols*(max_byte1-min_byte1+1);
     int i, j;
 
-    if(!min_byte1 && !max_byte1)    // single byte encodings
-    {
-        for(i = 0; i < ilen; i++)
-        {
-            j = glyphindex[i];
-            if(swapbytes) j = swap_word(j & 0xffff);
-                        // 0xffff means no glyph for that encoding
-            if(j != 0xffff) char_info[j].encoding = i;
-        }
-    }
-    else                // double byte encoding
-    {
-        min_byte1 &= 0xff;
-        min_char_or_byte2 &= 0xff;
-        int min = (min_byte1 << 8) | (min_char_or_byte2);
+    // glyphs that are not in the table have no encoding
+    for(i = 0; i < (int)font->length; i++) char_info[i].encoding = -1;
 
-        for(i = 0; i < ilen; i++)
-        {
-            j = glyphindex[i];
-            if(swapbytes) j = swap_word(j & 0xffff);
-                        // 0xffff means no glyph for that encoding
-            if(j != 0xffff) char_info[j].encoding = min;
-            min++;
-        }
+    // the table has a row of cols entries for each first byte
+    for(i = 0; i < ilen; i++)
+    {
+        j = glyphindex[i] & 0xffff;
+        if(swapbytes) j = swap_word(j);
+                    // 0xffff means no glyph for that encoding
+        if(j != 0xffff && (unsigned int)j < font->length)
+            char_info[j].encoding = ((min_byte1+(i/cols)) << 8) |
+                                    (min_char_or_byte2+(i%cols));
     }
 
     return 1;
@@ -1059,7 +1076,100 @@ int file_write_compressed_metrics(struct compressed_metrics *metrics, FILE *file
     return 0;
 }
 
-int pcf_write_to_file(FILE *file, struct font_s *font)
+/*
+ * Get the ink metrics of a glyph from its ink box. The glyph cell is placed
+ * by the glyph's metrics, which is how we write the bitmaps.
+ */
+static void get_ink_metrics(struct char_info_s *ci, struct ink_box_s *box,
+                            struct uncompressed_metrics *m)
+{
+    m->character_width = ci->dwidthX;
+    m->character_attributes = 0;
+
+    if(ink_box_empty(box))
+    {
+        m->left_side_bearing = m->right_side_bearing = 0;
+        m->character_ascent = m->character_descent = 0;
+        return;
+    }
+
+    m->left_side_bearing = ci->lBearing+box->left;
+    m->right_side_bearing = ci->lBearing+box->right;
+    m->character_ascent = ci->charAscent-box->top;
+    m->character_descent = box->bottom-ci->charAscent;
+}
+
+#define MIN_FIELD(f)    if(m.f < acc->minbounds.f) acc->minbounds.f = m.f
+#define MAX_FIELD(f)    if(m.f > acc->maxbounds.f) acc->maxbounds.f = m.f
+
+/*
+ * Fill the accelerators table: the min and max bounds of the glyph metrics,
+ * and the flags the X server uses to take shortcuts when drawing.
+ */
+static void get_accel_bounds(struct font_s *font, struct ink_box_s *ink,
+                             struct accel_table *acc)
+{
+    struct metadata_item_s *meta = (struct metadata_item_s *)font->metadata;
+    struct char_info_s *ci = (struct char_info_s *)font->char_info;
+    struct uncompressed_metrics m, m2;
+    unsigned int i;
+
+    memset(acc, 0, sizeof(struct accel_table));
+    acc->font_ascent = meta[METADATA_FONT_ASCENT].value;
+    acc->font_descent = meta[METADATA_FONT_DESCENT].value;
+    acc->const_metrics = acc->const_width = 1;
+
+    for(i = 0; i < font->length; i++)
+    {
+        m = (struct uncompressed_metrics)
+            {
+                ci[i].lBearing, ci[i].rBearing, ci[i].dwidthX,
+                ci[i].charAscent, ci[i].charDescent, 0
+            };
+
+        get_ink_metrics(&ci[i], &ink[i], &m2);
+        if(memcmp(&m, &m2, sizeof(m)))
+            acc->ink_metrics = 1;
+
+        if(i == 0)
+        {
+            acc->minbounds = acc->maxbounds = m;
+            acc->max_overlap = m.right_side_bearing-m.character_width;
+            continue;
+        }
+
+        if(m.character_width != ci[0].dwidthX) acc->const_width = 0;
+        if(m.right_side_bearing-m.character_width > acc->max_overlap)
+            acc->max_overlap = m.right_side_bearing-m.character_width;
+
+        MIN_FIELD(left_side_bearing);
+        MIN_FIELD(right_side_bearing);
+        MIN_FIELD(character_width);
+        MIN_FIELD(character_ascent);
+        MIN_FIELD(character_descent);
+        MAX_FIELD(left_side_bearing);
+        MAX_FIELD(right_side_bearing);
+        MAX_FIELD(character_width);
+        MAX_FIELD(character_ascent);
+        MAX_FIELD(character_descent);
+    }
+
+    // all the metrics are the same if their bounds are the same
+    if(memcmp(&acc->minbounds, &acc->maxbounds, sizeof(m))) acc->const_metrics = 0;
+    acc->no_overlap = (acc->max_overlap <= acc->minbounds.left_side_bearing);
+    acc->ink_inside = (acc->max_overlap <= 0 &&
+                       acc->minbounds.left_side_bearing >= 0 &&
+                       acc->maxbounds.character_ascent <= acc->font_ascent &&
+                       acc->maxbounds.character_descent <= acc->font_descent);
+    acc->terminal_font = (acc->const_metrics && acc->ink_inside &&
+                          acc->minbounds.character_ascent == acc->font_ascent &&
+                          acc->minbounds.character_descent == acc->font_descent);
+}
+
+#undef MIN_FIELD
+#undef MAX_FIELD
+
+int pcf_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font)
 {
     if(!file || !font) return 1;
     int32_t res, i, j;
@@ -1069,13 +1179,16 @@ int pcf_write_to_file(FILE *file, struct font_s *font)
     {
         if(!create_char_info(font)) return 1;
     }
-    pcf_check_font_meta(font);
+    pcf_check_font_meta(font, ctx->file_name);
     struct char_info_s *char_info = font->char_info;
+    struct ink_box_s *ink = malloc(font->length*sizeof(struct ink_box_s));
+    if(!ink) return 1;
+    get_font_ink_boxes(font, ink, NULL);
     unsigned char *data = font->data;
     u_int32_t tabcount = 7;
     //struct pcf_toc_entry tables[tabcount];
     struct pcf_toc_entry *tables = malloc(tabcount*sizeof(struct pcf_toc_entry));
-    if(!tables) return 1;
+    if(!tables) { free(ink); return 1; }
   
     // 0 - write the file header
     res = fwrite(filesig, 1, 4, file);
@@ -1161,41 +1274,23 @@ int pcf_write_to_file(FILE *file, struct font_s *font)
     tables[5].type   = PCF_BDF_ENCODINGS;
     tables[5].format = format;
     tables[5].offset = tables[4].offset + tables[4].size;
-    // get the minimum and maximum encodings
-    int min = 0, max = 0;
+    // get the range of each byte of the encodings. Glyphs without an
+    // encoding (or one that doesn't fit in 16 bits) are left out.
+    int min_byte1 = 0xff, max_byte1 = 0;
+    int min_char_or_byte2 = 0xff, max_char_or_byte2 = 0;
     for(i = 0; i < (int)font->length; i++)
     {
-        /*
-         * TODO: This is an awful hack. Sometimes the font contains out-of-range
-         *       encodings (e.g. when shrinking a lengthier font, or changing 
-         *       format from BDF to PCF, etc). We solve this by truncating the
-         *       encoding value to the max (otherwise we will write outside the
-         *       encodings array boundaries and will probably SIGSEGV or SIGABRT).
-         *       This needs to be FIXED!
-         */
-        if(char_info[i].encoding >= (int)font->length) 
-            char_info[i].encoding = font->length-1;
-
         j = char_info[i].encoding;
-        if(j < min) min = j;
-        else if(j > max) max = j;
-    }
-
-    int max_char_or_byte2 = (max >> 8) & 0xff;
-    int min_char_or_byte2 = (min >> 8) & 0xff;
-    int max_byte1 = (max & 0xff);
-    int min_byte1 = (min & 0xff);
+        if(j < 0 || j > 0xffff) continue;
 
-    if(!big_endian)
-    {
-        j = max_char_or_byte2;
-        max_char_or_byte2 = max_byte1;
-        max_byte1 = j;
-        j = min_char_or_byte2;
-        min_char_or_byte2 = min_byte1;
-        min_byte1 = j;
+        if((j >> 8) < min_byte1) min_byte1 = j >> 8;
+        if((j >> 8) > max_byte1) max_byte1 = j >> 8;
+        if((j & 0xff) < min_char_or_byte2) min_char_or_byte2 = j & 0xff;
+        if((j & 0xff) > max_char_or_byte2) max_char_or_byte2 = j & 0xff;
     }
 
+    if(min_byte1 > max_byte1) min_byte1 = min_char_or_byte2 = 0;
+
     int enc_len = sizeof(u_int16_t)*
                     ((max_char_or_byte2-min_char_or_byte2+1)*
                         (max_byte1-min_byte1+1));
@@ -1222,7 +1317,7 @@ int pcf_write_to_file(FILE *file, struct font_s *font)
     res = file_write_lsbint(nprops, file);
     //char strings[string_size];
     char *strings = (char *)malloc(string_size);
-    if(!strings) return 1;
+    if(!strings) { free(ink); return 1; }
     char *sp = strings;
 
     for(i = 0; i < metadata_table_len; i++)
@@ -1265,29 +1360,23 @@ int pcf_write_to_file(FILE *file, struct font_s *font)
     while(pad2-- > 0) putc(0, file);
 
     // write the accelerators table
+    struct accel_table acc;
+    get_accel_bounds(font, ink, &acc);
     res = file_write_lsbint(tables[1].format, file);
+    putc(acc.no_overlap, file);
+    putc(acc.const_metrics, file);
+    putc(acc.terminal_font, file);
+    putc(acc.const_width, file);
+    putc(acc.ink_inside, file);
+    putc(acc.ink_metrics, file);
+    putc(acc.draw_direction, file);
     putc(0, file);
-    putc(1, file);
-    putc(1, file);
-    putc(1, file);
-    putc(0, file);
-    putc(0, file);
-    putc(0, file);
-    putc(0, file);
-    res = file_write_lsbint(meta[METADATA_FONT_ASCENT].value, file);
-    res = file_write_lsbint(meta[METADATA_FONT_DESCENT].value, file);
-    j = 0;
-    res = file_write_lsbint(j, file);
-    struct uncompressed_metrics bounds = 
-    { 
-        meta[METADATA_FONTBOUNDINGBOX_X].value,
-        meta[METADATA_FONTBOUNDINGBOX_Y].value,
-        meta[METADATA_FONTBOUNDINGBOX_XOFF].value,
-        meta[METADATA_FONTBOUNDINGBOX_YOFF].value,
-        0, 0
-    };
-    res = file_write_uncompressed_metrics(&bounds, file);
-    res = file_write_uncompressed_metrics(&bounds, file);
+    res = file_write_lsbint(acc.font_ascent, file);
+    res = file_write_lsbint(acc.font_descent, file);
+    res = file_write_lsbint(acc.max_overlap, file);
+    res = file_write_uncompressed_metrics(&acc.minbounds, file);
+    res = file_write_uncompressed_metrics(&acc.maxbounds, file);
+    struct uncompressed_metrics bounds;
 
     // write the metrics table
     res = file_write_lsbint(tables[2].format, file);
@@ -1348,81 +1437,40 @@ int pcf_write_to_file(FILE *file, struct font_s *font)
 //exit(0);
 
     // write the ink metrics table
-    // NOTE: this is the same code as for the metrics table above
     res = file_write_lsbint(tables[4].format, file);
     j = font->length;
     res = file_write_lsbint(j, file);
     for(i = 0; i < (int)font->length; i++)
     {
-        bounds = (struct uncompressed_metrics)
-            { 
-                char_info[i].lBearing, char_info[i].rBearing, char_info[i].dwidthX,
-                char_info[i].charAscent, char_info[i].charDescent, 0
-            };
+        get_ink_metrics(&char_info[i], &ink[i], &bounds);
         res = file_write_uncompressed_metrics(&bounds, file);
     }
 
     // write the encodings table
     res = file_write_lsbint(tables[5].format, file);
     u_int16_t k;
-    // do we need one byte or two bytes for the encodings?
-    if(max < 256)
-    {
-        k = min & 0xffff;
-        res = file_write_lsbshort(k, file);
-        k = max & 0xffff;
-        res = file_write_lsbshort(k, file);
-        k = 0;
-        res = file_write_lsbshort(k, file);
-        res = file_write_lsbshort(k, file);
-    }
-    else
-    {
-        i = min;
-        j = max;
-        if(big_endian)
-        {
-            k = (i >> 8) & 0xff;
-            res = file_write_lsbshort(k, file);
-            k = (j >> 8) & 0xff;
-            res = file_write_lsbshort(k, file);
-            k = i & 0xff;
-            res = file_write_lsbshort(k, file);
-            k = j & 0xff;
-            res = file_write_lsbshort(k, file);
-        }
-        else
-        {
-            k = i & 0xff;
-            res = file_write_lsbshort(k, file);
-            k = j & 0xff;
-            res = file_write_lsbshort(k, file);
-            k = (i >> 8) & 0xff;
-            res = file_write_lsbshort(k, file);
-            k = (j >> 8) & 0xff;
-            res = file_write_lsbshort(k, file);
-        }
-    }
+    k = min_char_or_byte2;
+    res = file_write_lsbshort(k, file);
+    k = max_char_or_byte2;
+    res = file_write_lsbshort(k, file);
+    k = min_byte1;
+    res = file_write_lsbshort(k, file);
+    k = max_byte1;
+    res = file_write_lsbshort(k, file);
     k = meta[METADATA_DEFAULT_CHAR].value;
     res = file_write_lsbshort(k, file);
     
     // assemble the encodings table
     u_int16_t *encodings = (u_int16_t *)malloc(enc_len);
-    if(!encodings) return 1;
+    if(!encodings) { free(ink); return 1; }
     memset(encodings, 0xff, enc_len);
     for(i = 0; i < (int)font->length; i++)
     {
-        int enc1 = (char_info[i].encoding >> 8) & 0xff;
-        int enc2 = char_info[i].encoding & 0xff;
-        if(big_endian)
-        {
-            j = enc1;
-            enc1 = enc2;
-            enc2 = j;
-        }
-        j = (enc1-min_byte1)*(max_char_or_byte2-min_char_or_byte2+1)+enc2-min_char_or_byte2;
+        j = char_info[i].encoding;
+        if(j < 0 || j > 0xffff) continue;
+        j = ((j >> 8)-min_byte1)*(max_char_or_byte2-min_char_or_byte2+1)+
+            (j & 0xff)-min_char_or_byte2;
         encodings[j] = i;
-        //printf("j = %d, i = %d, enc_len/2 = %d, min = %d, max = %d\n", j, i, enc_len/2, min, max);
     }
     res = fwrite(encodings, 1, enc_len, file);
 
@@ -1438,6 +1486,7 @@ int pcf_write_to_file(FILE *file, struct font_s *font)
 
     free(strings);
     free(tables);
+    free(ink);
     free(encodings);
     if(res == EOF) return 1;
     return 0;
@@ -126,9 +126,9 @@ int get_encodings_table(char *table_data, struct font_s *font);
 int get_swidths_table(char *table_data, struct font_s *font);
 
 struct font_s *pcf_create_empty_font();
-struct font_s *pcf_load_font_file(char *file_name);
-struct font_s *pcf_load_font(char *file_name, unsigned char *file_data, long file_size);
-int pcf_write_to_file(FILE *file, struct font_s *font);
+struct font_s *pcf_load_font_file(struct font_ctx_s *ctx);
+struct font_s *pcf_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size);
+int pcf_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font);
 void pcf_handle_hw_change(struct font_s *font, char *newdata, long new_datasize);
 int pcf_create_unitab(struct font_s *font);
 void bdf_kill_unitab(struct font_s *font);
@@ -133,8 +133,9 @@ go:
 }
 
 
-int psf_write_to_file(FILE *file, struct font_s *font)
+int psf_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font)
 {
+    (void)ctx;
     int res;
 
     /* 1- write the header */
@@ -269,12 +270,14 @@ int psf_write_to_file(FILE *file, struct font_s *font)
     return 0;
 }
 
-struct font_s *psf_load_font_file(char *file_name)
+struct font_s *psf_load_font_file(struct font_ctx_s *ctx)
 {
+    char *file_name = ctx->file_name;
     long i;
     FILE *font_file = (FILE *)NULL;
     struct font_s *font = (struct font_s *)NULL;
     unsigned char *file_data = (unsigned char *)NULL;
+    stats_begin(STATS_READ);
     if(!(font_file = fopen(file_name, "rb"))) return (struct font_s *)NULL;
     i = fseek(font_file, 0, SEEK_END);
     long file_size = ftell(font_file);
@@ -288,7 +291,9 @@ struct font_s *psf_load_font_file(char *file_name)
     i = fread(file_data, 1, file_size, font_file);
     if(i != file_size) goto file_read_error;
     fclose(font_file);
-    font = psf_load_font(file_name, file_data, file_size);
+    stats_end(STATS_READ);
+    stats_add(STATS_BYTES_READ, file_size);
+    font = psf_load_font(ctx, file_data, file_size);
     free(file_data);
     return font;
     
@@ -309,13 +314,13 @@ end:
     return (struct font_s *)NULL;
 }
 
-struct font_s *psf_load_font(char *file_name, unsigned char *file_data, long file_size)
+struct font_s *psf_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size)
 {
     struct font_s *font = (struct font_s *)NULL;
     struct psf2_header *hdr = (struct psf2_header *)file_data;
     struct psf1_header *hdr_old = (struct psf1_header *)hdr;
 
-    (void)file_name;
+    (void)ctx;
     
     font = (struct font_s *)malloc(sizeof(struct font_s));
     if(!font) goto memory_error;
@@ -384,6 +389,7 @@ struct font_s *psf_load_font(char *file_name, unsigned char *file_data, long fil
        */
     }
 
+    stats_begin(STATS_DECODE);
     font->data_size = font->length * font->charsize;
     font->data = (unsigned char *)malloc(font->data_size);
     if(!font->data) goto memory_error;
@@ -419,6 +425,7 @@ struct font_s *psf_load_font(char *file_name, unsigned char *file_data, long fil
             }
         }
     }
+    stats_end(STATS_DECODE);
     
     if(font->has_unicode_table)
     {
@@ -439,13 +446,11 @@ struct font_s *psf_load_font(char *file_name, unsigned char *file_data, long fil
     if(!create_empty_unitab(font)) goto memory_error;
     get_font_unicode_table(font);
 
-    calc_max_zoom(font);
     font->state = OPENED;
     font->module = get_module_by_name("psf");
     /* something REALLY WRONG happended here */
     if(!font->module) goto undefined_error;
 
-    reset_all_cursors();
     return font;
 
 undefined_error:
@@ -834,11 +839,10 @@ long psf_make_utf16_unitab(struct font_s *new_font, unsigned short **_unicode_ta
         int cnt = 0;
 
         unsigned int c = 0;
-        new_font->unicode_array_index = 0;
-        new_font->unicode_index = 0;
+        struct utf_cursor_s cur = { 0 };
         do
         {
-            c = get_next_utf(new_font);
+            c = get_next_utf(new_font, &cur);
             unicode_table[draft_index++] = c;
 
             if(c == PSF1_SEPARATOR)
@@ -853,7 +857,7 @@ long psf_make_utf16_unitab(struct font_s *new_font, unsigned short **_unicode_ta
                  */
                 int bytes = 0;
                 while(new_font->unicode_info
-                        [new_font->unicode_array_index+bytes] 
+                        [cur.index+bytes] 
                             != PSF2_SEPARATOR) bytes++;
 
                 /* add extra byte for the separator */
@@ -865,7 +869,7 @@ long psf_make_utf16_unitab(struct font_s *new_font, unsigned short **_unicode_ta
 
                 do
                 {
-                    c = get_next_utf(new_font);
+                    c = get_next_utf(new_font, &cur);
                     unicode_table[draft_index++] = c;
                 } while(c != PSF1_SEPARATOR);
 
@@ -878,7 +882,7 @@ long psf_make_utf16_unitab(struct font_s *new_font, unsigned short **_unicode_ta
                 if(cnt > 1)
                 {
                     int bytes = 0;
-                    int m = new_font->unicode_array_index;
+                    int m = cur.index;
                     while(new_font->unicode_info[m+bytes] != PSF2_SEPARATOR) bytes++;
                     bytes += 2;
                     bytes *= sizeof(unsigned short);
@@ -892,7 +896,7 @@ long psf_make_utf16_unitab(struct font_s *new_font, unsigned short **_unicode_ta
 
                         do
                         {
-                            c = get_next_utf(new_font);
+                            c = get_next_utf(new_font, &cur);
                             unicode_table[draft_index++] = c;
                         } while(c != PSF1_SEPARATOR);
                         i++; cnt = 0;
@@ -21,7 +21,7 @@
 #ifndef PSF_H
 #define PSF_H
 
-#include "../defs.h"
+#include "../core.h"
 #include "../view.h"
 #include "../glyph.h"
 #include "modules.h"
@@ -88,9 +88,9 @@ static inline int verify_psf1_hdr(struct psf1_header *hdr)
 
 
 struct font_s *psf_create_empty_font();
-int psf_write_to_file(FILE *file, struct font_s *font);
-struct font_s *psf_load_font_file(char *file_name);
-struct font_s *psf_load_font(char *file_name, unsigned char *file_data, long file_size);
+int psf_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font);
+struct font_s *psf_load_font_file(struct font_ctx_s *ctx);
+struct font_s *psf_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size);
 void psf_init_module();
 void psf_handle_hw_change(struct font_s *font, char *newdata, long new_datasize);
 void psf_shrink_glyphs(struct font_s *font, int old_length);
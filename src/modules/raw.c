@@ -19,7 +19,7 @@
  */    
 
 #include "raw.h"
-#include "../defs.h"
+#include "../core.h"
 #include "../view.h"
 
 int raw_acceptable_filesize(long file_size)
@@ -102,13 +102,15 @@ end:
 }
 
 
-struct font_s *raw_load_font_file(char *file_name)
+struct font_s *raw_load_font_file(struct font_ctx_s *ctx)
 {
+    char *file_name = ctx->file_name;
     FILE *font_file = (FILE *)NULL;
     char *file_data = (char *)NULL;
     struct font_s *font = (struct font_s *)NULL;
     if(!file_name) return (struct font_s *)NULL;
 
+    stats_begin(STATS_READ);
     if(!(font_file = fopen(file_name, "rb")))
     {
         status_error("Error opening file");
@@ -139,7 +141,9 @@ struct font_s *raw_load_font_file(char *file_name)
     i = fread(file_data, 1, file_size, font_file);
     if(i != file_size) goto file_read_error;
     fclose(font_file);
-    font = raw_load_font(file_name, (unsigned char *)file_data, file_size);
+    stats_end(STATS_READ);
+    stats_add(STATS_BYTES_READ, file_size);
+    font = raw_load_font(ctx, (unsigned char *)file_data, file_size);
     free(file_data);
     return font;
     
@@ -199,7 +203,7 @@ struct filesize_s
     { 0, NULL, 0, 0, 0 }
 };
 
-struct font_s *raw_load_font(char *file_name, unsigned char *file_data, long file_size)
+struct font_s *raw_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size)
 {
     int i;
     struct font_s *font = (struct font_s *)NULL;
@@ -212,7 +216,7 @@ struct font_s *raw_load_font(char *file_name, unsigned char *file_data, long fil
     {
         if(file_candidates[i].filesize != file_size) continue;
 
-        if(strstr(file_name, file_candidates[i].namepart))
+        if(ctx->file_name && strstr(ctx->file_name, file_candidates[i].namepart))
         {
             font->height = file_candidates[i].height;
             font->width = file_candidates[i].width;
@@ -224,11 +228,11 @@ struct font_s *raw_load_font(char *file_name, unsigned char *file_data, long fil
     // nothing found, so try to guess from the file size
     if(file_candidates[i].namepart == NULL)
     {
-        if(startup_rawfont_width >= 4 && startup_rawfont_width <= 128 &&
-           startup_rawfont_height >= 4 && startup_rawfont_height <= 128)
+        if(ctx->raw_width >= 4 && ctx->raw_width <= 128 &&
+           ctx->raw_height >= 4 && ctx->raw_height <= 128)
         {
-            font->height   = startup_rawfont_height;
-            font->width    = startup_rawfont_width;
+            font->height   = ctx->raw_height;
+            font->width    = ctx->raw_width;
             font->charsize = ((font->width+7)/8)*font->height;
         }
         else
@@ -268,19 +272,19 @@ struct font_s *raw_load_font(char *file_name, unsigned char *file_data, long fil
     font->file_hdr = (void *)NULL;
     font->header_size = 0;
     font->utf_version = 0;
+    stats_begin(STATS_DECODE);
     font->data = (unsigned char *)malloc(file_size);
     if(!font->data) goto memory_error;
     memcpy((void *)font->data, (void *)file_data, file_size);
     font->data_size = file_size;
     font->state = OPENED;
-    calc_max_zoom(font);
     reverse_glyph_rows(font);
+    stats_end(STATS_DECODE);
 
     font->module = get_module_by_name("raw");
     /* something REALLY WRONG happended here */
     if(!font->module) goto undefined_error;
 
-    reset_all_cursors();
     return font;
 
 undefined_error:
@@ -300,8 +304,9 @@ end:
 }
 
 
-int raw_write_to_file(FILE *file, struct font_s *font)
+int raw_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font)
 {
+    (void)ctx;
     if(!file || !font) return 1;
 
     int i, j, k;
@@ -27,9 +27,9 @@
 #include "psf.h"
 
 struct font_s *raw_create_empty_font();
-struct font_s *raw_load_font_file(char *file_name);
-struct font_s *raw_load_font(char *file_name, unsigned char *file_data, long file_size);
-int raw_write_to_file(FILE *file, struct font_s *font);
+struct font_s *raw_load_font_file(struct font_ctx_s *ctx);
+struct font_s *raw_load_font(struct font_ctx_s *ctx, unsigned char *file_data, long file_size);
+int raw_write_to_file(struct font_ctx_s *ctx, FILE *file, struct font_s *font);
 void raw_handle_hw_change(struct font_s *font, char *newdata, long new_datasize);
 void raw_handle_version_change(struct font_s *font, char old_version);
 void raw_export_unitab(struct font_s *font, FILE *f);
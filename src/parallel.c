@@ -0,0 +1,97 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: parallel.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+struct glyph_job_s
+{
+    struct font_s *font;
+    unsigned int first, count;
+    glyph_kernel_t kernel;
+    void *arg;
+};
+
+int get_cpu_count()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if(n < 1) return 1;
+    if(n > PARALLEL_MAX_THREADS) return PARALLEL_MAX_THREADS;
+    return (int)n;
+}
+
+static void *glyph_job_thread(void *p)
+{
+    struct glyph_job_s *job = (struct glyph_job_s *)p;
+    job->kernel(job->font, job->first, job->count, job->arg);
+    return NULL;
+}
+
+/*
+ * Run the given kernel on glyphs [first, first+count). Big ranges are
+ * split into equal chunks that run on their own threads, while small
+ * ranges (or if we fail to start a thread) run on the calling thread.
+ */
+void for_each_glyph_range(struct font_s *font, unsigned int first,
+                          unsigned int count, glyph_kernel_t kernel, void *arg)
+{
+    int threads = get_cpu_count();
+    pthread_t tid[PARALLEL_MAX_THREADS];
+    struct glyph_job_s jobs[PARALLEL_MAX_THREADS];
+    char started[PARALLEL_MAX_THREADS];
+    unsigned int chunk;
+    int i;
+
+    if(!count) return;
+
+    if(threads > (int)(count/(PARALLEL_MIN_GLYPHS/2)))
+        threads = count/(PARALLEL_MIN_GLYPHS/2);
+
+    if(count < PARALLEL_MIN_GLYPHS || threads < 2)
+    {
+        kernel(font, first, count, arg);
+        return;
+    }
+
+    chunk = (count+threads-1)/threads;
+
+    for(i = 0; i < threads; i++)
+    {
+        jobs[i].font = font;
+        jobs[i].first = first + (i*chunk);
+        jobs[i].count = (i == threads-1) ? count - (i*chunk) : chunk;
+        jobs[i].kernel = kernel;
+        jobs[i].arg = arg;
+
+        /* the first chunk is ours */
+        if(i == 0) { started[i] = 0; continue; }
+        started[i] = (pthread_create(&tid[i], NULL, glyph_job_thread, &jobs[i]) == 0);
+    }
+
+    kernel(font, jobs[0].first, jobs[0].count, arg);
+
+    for(i = 1; i < threads; i++)
+    {
+        if(started[i]) pthread_join(tid[i], NULL);
+        else kernel(font, jobs[i].first, jobs[i].count, arg);
+    }
+}
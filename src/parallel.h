@@ -0,0 +1,43 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: parallel.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "font_ops.h"
+
+/* don't bother starting threads for less glyphs than this */
+#define PARALLEL_MIN_GLYPHS         (256)
+#define PARALLEL_MAX_THREADS        (32)
+
+/*
+ * A glyph kernel works on count glyphs starting at glyph first. Kernels
+ * are called from worker threads, so they must only touch the glyphs
+ * they were given, and must not call any of the screen functions.
+ */
+typedef void (*glyph_kernel_t)(struct font_s *font, unsigned int first,
+                               unsigned int count, void *arg);
+
+/* parallel.c */
+int get_cpu_count();
+void for_each_glyph_range(struct font_s *font, unsigned int first,
+                          unsigned int count, glyph_kernel_t kernel, void *arg);
+
+#endif
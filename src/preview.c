@@ -0,0 +1,641 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: preview.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <ncurses.h>
+#include "defs.h"
+#include "view.h"
+#include "shadow.h"
+#include "fonttools.h"
+#include "graphics.h"
+#include "glyph.h"
+
+/*
+ * The preview pane draws text (or the whole font) with the font's own
+ * bitmaps, packing several pixels into each terminal cell. Glyphs are
+ * drawn into a 1-bit canvas, which is then converted to cells a byte of
+ * canvas at a time through the lookup tables below.
+ * On terminals that support it, the preview can also be sent as a sixel or
+ * kitty image, with one pixel per pixel (or more, if scaled).
+ */
+#define PREVIEW_BRAILLE         0       /* 2x4 pixels per cell */
+#define PREVIEW_HALFBLOCK       1       /* 1x2 pixels per cell */
+#define PREVIEW_SIXEL           2
+#define PREVIEW_KITTY           3
+#define PREVIEW_MODES           4
+
+#define MAX_PREVIEW_SCALE       8
+
+/* encoded image lines kept between frames */
+#define TILE_CACHE_SIZE         128
+
+/* braille_lut[dy][byte] has the dots of 4 cells (2 pixels each) for row dy
+ * of a cell, one cell per 8 bits, leftmost cell in the lowest 8 bits.
+ */
+static uint32_t braille_lut[4][256];
+/* spread_lut[byte] moves pixel k of a byte to bit 2k */
+static uint16_t spread_lut[256];
+static int luts_ready = 0;
+
+/* indexed by (top pixel << 1) | bottom pixel */
+static unsigned int half_blocks[4] = { ' ', 0x2584, 0x2580, 0x2588 };
+
+/* one encoded line of text of a graphics preview */
+struct tile_s
+{
+    int line;                   /* -1 if not used */
+    int mode, scale, width;
+    uint32_t hash;              /* of the glyphs in the line */
+    struct report_s data;
+};
+
+struct preview_s
+{
+    struct font_s *font;
+    unsigned int *glyphs;       /* glyphs to show, NULL for the whole font */
+    unsigned int count;
+    int mode;
+    int scale;                  /* pixel size in graphics modes */
+    int first_line;
+    unsigned char *canvas;
+    int pitch;
+    int image_width, image_height;  /* of the image on the screen */
+    struct tile_s tiles[TILE_CACHE_SIZE];
+};
+
+static void init_luts()
+{
+    /* braille dots 1-8 for (x, y) pixels of a cell */
+    static unsigned char dots[4][2] =
+    {
+        { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 },
+    };
+    int dy, b, k;
+
+    for(b = 0; b < 256; b++)
+    {
+        for(dy = 0; dy < 4; dy++)
+        {
+            uint32_t v = 0;
+
+            for(k = 0; k < 4; k++)
+            {
+                uint32_t cell = 0;
+
+                if(b & (0x80 >> (k*2))) cell |= dots[dy][0];
+                if(b & (0x40 >> (k*2))) cell |= dots[dy][1];
+                v |= cell << (k*8);
+            }
+
+            braille_lut[dy][b] = v;
+        }
+
+        spread_lut[b] = 0;
+        for(k = 0; k < 8; k++)
+            if(b & (0x80 >> k)) spread_lut[b] |= 1 << (k*2);
+    }
+
+    luts_ready = 1;
+}
+
+/*
+ * Convert UTF-8 text to a list of glyphs. Chars missing from the font are
+ * shown as '?' (or left blank if the font has no '?').
+ */
+static unsigned int *text_to_glyphs(struct font_s *font, char *text,
+                                    unsigned int *count)
+{
+    unsigned char *s = (unsigned char *)text;
+    unsigned int *glyphs, cp, g, missing;
+    struct cpmap_s *map;
+    int mapsize;
+
+    *count = 0;
+    if((mapsize = get_cpmap(font, &map)) < 0) return NULL;
+    if(!(glyphs = (unsigned int *)malloc((strlen(text)+1)*sizeof(unsigned int))))
+    {
+        free(map);
+        return NULL;
+    }
+
+    missing = find_cpmap_glyph(font, map, mapsize, '?');
+
+    while(*s)
+    {
+        int n = make_utf16(&cp, s);
+        int i;
+
+        /* don't read past a truncated sequence */
+        for(i = 1; i < n; i++) if(!s[i]) break;
+        s += i;
+
+        g = find_cpmap_glyph(font, map, mapsize, cp);
+        glyphs[(*count)++] = (g == NO_GLYPH) ? missing : g;
+    }
+
+    free(map);
+    return glyphs;
+}
+
+/* OR the glyph's pixels into the canvas, clipping at the canvas edges */
+static void blit_glyph(struct preview_s *pv, unsigned int g, int x, int y,
+                       int cw, int ch)
+{
+    struct font_s *font = pv->font;
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    unsigned char *data = font->data+(g*font->charsize);
+    int j, k, shift = x & 7;
+
+    if(x >= cw) return;
+
+    for(j = 0; j < (int)font->height && y+j < ch; j++, data += bytes)
+    {
+        uint64_t bits = load_glyph_row(data, bytes, mask);
+        unsigned char *dest = pv->canvas+((y+j)*pv->pitch)+(x/8);
+
+        if(!bits) continue;
+
+        /* the canvas rows have 8 bytes of slack past the visible width */
+        for(k = 0; k < 8; k++) dest[k] |= (unsigned char)((bits >> shift) >> (56-(k*8)));
+        if(shift) dest[8] |= (unsigned char)(bits << (8-shift));
+    }
+}
+
+static inline int preview_lines(struct preview_s *pv, int gpl)
+{
+    unsigned int count = pv->glyphs ? pv->count : pv->font->length;
+
+    return (count+gpl-1)/gpl;
+}
+
+/*
+ * Draw the visible part of the preview into the shadow buffer. Only the
+ * lines that fit in the pane are drawn, whatever the font size is.
+ * Returns the number of text lines.
+ */
+static int render_preview(struct preview_s *pv, struct shadow_s *sh,
+                          int rows, int cols)
+{
+    struct font_s *font = pv->font;
+    unsigned int count = pv->glyphs ? pv->count : font->length;
+    int cw = (pv->mode == PREVIEW_BRAILLE) ? cols*2 : cols;
+    int ch = (pv->mode == PREVIEW_BRAILLE) ? rows*4 : rows*2;
+    int gpl = cw/(int)font->width;
+    int line, lines, x, y, r, c, k;
+    unsigned int p;
+
+    if(gpl < 1) gpl = 1;
+    lines = preview_lines(pv, gpl);
+
+    memset(pv->canvas, 0, pv->pitch*ch);
+
+    for(line = pv->first_line, y = 0; line < lines && y < ch;
+        line++, y += font->height)
+    {
+        for(p = line*gpl, x = 0; p < count && p < (unsigned int)(line+1)*gpl;
+            p++, x += font->width)
+        {
+            unsigned int g = pv->glyphs ? pv->glyphs[p] : p;
+            if(g != NO_GLYPH) blit_glyph(pv, g, x, y, cw, ch);
+        }
+    }
+
+    /* now convert the canvas to cells */
+    for(r = 0; r < rows; r++)
+    {
+        if(pv->mode == PREVIEW_BRAILLE)
+        {
+            unsigned char *src = pv->canvas+(r*4*pv->pitch);
+
+            for(c = 0; c < cols; c += 4, src++)
+            {
+                uint32_t v = braille_lut[0][src[0]] |
+                             braille_lut[1][src[pv->pitch]] |
+                             braille_lut[2][src[pv->pitch*2]] |
+                             braille_lut[3][src[pv->pitch*3]];
+
+                for(k = 0; k < 4 && c+k < cols; k++, v >>= 8)
+                    shadow_put(sh, r, c+k, (v & 0xff) ? 0x2800+(v & 0xff) : ' ',
+                               WHITE, BGDEFAULT);
+            }
+        }
+        else
+        {
+            unsigned char *src = pv->canvas+(r*2*pv->pitch);
+
+            for(c = 0; c < cols; c += 8, src++)
+            {
+                unsigned int v = (spread_lut[src[0]] << 1) |
+                                 spread_lut[src[pv->pitch]];
+
+                for(k = 0; k < 8 && c+k < cols; k++, v >>= 2)
+                    shadow_put(sh, r, c+k, half_blocks[v & 3],
+                               WHITE, BGDEFAULT);
+            }
+        }
+    }
+
+    return lines;
+}
+
+static char *mode_names[] =
+{
+    "Braille (2x4)", "Half blocks (1x2)", "Sixel", "Kitty",
+};
+
+/* draw the glyph into a 1-bit buffer, each pixel as a scale x scale block */
+static void blit_scaled_glyph(struct font_s *font, unsigned int g,
+                              unsigned char *rows, int pitch, int x, int scale)
+{
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    unsigned char *data = font->data+(g*font->charsize);
+    int j, k, i, l;
+
+    for(j = 0; j < (int)font->height; j++, data += bytes)
+    {
+        uint64_t bits = load_glyph_row(data, bytes, mask);
+
+        for(k = 0; bits; k++, bits <<= 1)
+        {
+            if(!(bits & (1ULL << 63))) continue;
+
+            for(i = 0; i < scale; i++)
+            {
+                unsigned char *dest = rows+(((j*scale)+i)*pitch);
+
+                for(l = x+(k*scale); l < x+((k+1)*scale); l++)
+                    dest[l/8] |= 0x80 >> (l & 7);
+            }
+        }
+    }
+}
+
+static uint32_t line_hash(struct preview_s *pv, int line, int gpl)
+{
+    struct font_s *font = pv->font;
+    unsigned int count = pv->glyphs ? pv->count : font->length;
+    unsigned int p, i;
+    uint32_t hash = 2166136261u;
+
+    for(p = line*gpl; p < count && p < (unsigned int)(line+1)*gpl; p++)
+    {
+        unsigned int g = pv->glyphs ? pv->glyphs[p] : p;
+        unsigned char *data;
+
+        hash = (hash ^ g)*16777619u;
+        if(g == NO_GLYPH) continue;
+
+        data = font->data+(g*font->charsize);
+        for(i = 0; i < font->charsize; i++) hash = (hash ^ data[i])*16777619u;
+    }
+
+    return hash;
+}
+
+/*
+ * Get the encoded image of a line of text, encoding it only if it's not in
+ * the tile cache or its glyphs changed since. Returns NULL on memory error.
+ */
+static struct tile_s *get_tile(struct preview_s *pv, int line, int gpl,
+                               int width, int height)
+{
+    struct font_s *font = pv->font;
+    struct tile_s *tile = &pv->tiles[line % TILE_CACHE_SIZE];
+    unsigned int count = pv->glyphs ? pv->count : font->length;
+    uint32_t hash = line_hash(pv, line, gpl);
+    int pitch = (width+7)/8, res;
+    unsigned char *rows;
+    unsigned int p;
+    int x;
+
+    if(tile->line == line && tile->mode == pv->mode &&
+       tile->scale == pv->scale && tile->width == width && tile->hash == hash)
+        return tile;
+
+    if(!(rows = (unsigned char *)calloc(pitch*height, 1))) return NULL;
+
+    for(p = line*gpl, x = 0; p < count && p < (unsigned int)(line+1)*gpl;
+        p++, x += font->width*pv->scale)
+    {
+        unsigned int g = pv->glyphs ? pv->glyphs[p] : p;
+        if(g != NO_GLYPH) blit_scaled_glyph(font, g, rows, pitch, x, pv->scale);
+    }
+
+    tile->data.len = 0;
+    if(pv->mode == PREVIEW_SIXEL)
+        res = sixel_encode_rows(&tile->data, rows, pitch, width, height);
+    else
+        res = kitty_encode_rows(&tile->data, rows, pitch, width, height);
+    free(rows);
+
+    if(!res)
+    {
+        tile->line = -1;
+        return NULL;
+    }
+
+    tile->line = line;
+    tile->mode = pv->mode;
+    tile->scale = pv->scale;
+    tile->width = width;
+    tile->hash = hash;
+    return tile;
+}
+
+/*
+ * Get the layout of a graphics preview: glyphs per line, the height of a
+ * line in pixels and the number of lines that fit in the pane.
+ */
+static void graphics_layout(struct preview_s *pv, int rows, int cols,
+                            int *gpl, int *line_height, int *vis)
+{
+    struct font_s *font = pv->font;
+    int cell_w, cell_h;
+
+    get_cell_size(&cell_w, &cell_h);
+
+    *gpl = (cols*cell_w)/(int)(font->width*pv->scale);
+    if(*gpl < 1) *gpl = 1;
+
+    /* sixel lines are padded to whole bands, so each line is a tile */
+    *line_height = font->height*pv->scale;
+    if(pv->mode == PREVIEW_SIXEL)
+        *line_height = ((*line_height+SIXEL_BAND_HEIGHT-1)/SIXEL_BAND_HEIGHT)*
+                       SIXEL_BAND_HEIGHT;
+
+    *vis = (rows*cell_h)/(*line_height);
+    if(*vis < 1) *vis = 1;
+}
+
+/*
+ * Send the visible lines of a graphics preview as one image, made of the
+ * cached line tiles. Returns 0 on memory error.
+ */
+static int write_preview_image(struct preview_s *pv, FILE *out,
+                               int gpl, int line_height, int vis)
+{
+    struct font_s *font = pv->font;
+    unsigned int count = pv->glyphs ? pv->count : font->length;
+    int lines = preview_lines(pv, gpl);
+    int width = ((count < (unsigned int)gpl) ? (int)count : gpl)*
+                font->width*pv->scale;
+    int n = (lines-pv->first_line < vis) ? lines-pv->first_line : vis;
+    struct kitty_writer_s kw;
+    int line;
+
+    pv->image_width = width;
+    pv->image_height = n*line_height;
+    if(n <= 0) return 1;
+
+    if(pv->mode == PREVIEW_SIXEL) sixel_begin(out, width, n*line_height);
+    else kitty_begin(&kw, out, width, n*line_height);
+
+    for(line = pv->first_line; line < pv->first_line+n; line++)
+    {
+        struct tile_s *tile = get_tile(pv, line, gpl, width, line_height);
+
+        /* still end the image, so the terminal is not left waiting */
+        if(!tile) break;
+
+        if(pv->mode == PREVIEW_SIXEL) fwrite(tile->data.text, 1, tile->data.len, out);
+        else kitty_write(&kw, tile->data.text, tile->data.len);
+    }
+
+    if(pv->mode == PREVIEW_SIXEL) sixel_end(out);
+    else kitty_end(&kw);
+
+    return (line == pv->first_line+n);
+}
+
+/* remove kitty images from the screen */
+static void clear_kitty_images()
+{
+    fprintf(stdout, "\033_Ga=d\033\\");
+    fflush(stdout);
+}
+
+static void show_preview(struct preview_s *pv)
+{
+    struct shadow_s sh = { 0, 0, NULL, NULL, 0 };
+    int rows = SCREEN_H-3, cols = SCREEN_W-2;
+    int lines, vis, last, ch, i;
+    int gpl = 1, line_height = 1;
+    int old_mode = -1, old_width = 0, old_height = 0;
+    char msg[128];
+
+    if(!luts_ready) init_luts();
+
+    /* the canvas is big enough for the braille mode, which has the most
+     * pixels, plus 8 bytes of slack on each row for blit_glyph().
+     */
+    pv->pitch = ((cols*2+7)/8)+9;
+    if(!(pv->canvas = (unsigned char *)malloc(pv->pitch*rows*4)))
+    {
+        msgBox("Insufficient memory!", BUTTON_OK, ERROR);
+        return;
+    }
+
+    for(i = 0; i < TILE_CACHE_SIZE; i++) pv->tiles[i].line = -1;
+    if(pv->scale < 1) pv->scale = 1;
+
+    drawBox(1, 1, SCREEN_H, SCREEN_W, " Preview ", 1);
+
+    while(1)
+    {
+        int graphics = (pv->mode == PREVIEW_SIXEL || pv->mode == PREVIEW_KITTY);
+
+        if(!shadow_begin(&sh, rows, cols)) break;
+
+        if(graphics)
+        {
+            graphics_layout(pv, rows, cols, &gpl, &line_height, &vis);
+            lines = preview_lines(pv, gpl);
+        }
+        else
+        {
+            int ph = (pv->mode == PREVIEW_BRAILLE) ? rows*4 : rows*2;
+
+            vis = ph/(int)pv->font->height;
+            if(vis < 1) vis = 1;
+            lines = render_preview(pv, &sh, rows, cols);
+        }
+
+        last = (lines > vis) ? lines-vis : 0;
+
+        if(pv->first_line > last)
+        {
+            /* a mode switch can leave us past the end */
+            pv->first_line = last;
+            continue;
+        }
+
+        /* images stay on the screen until drawn over, so clear the pane if
+         * the mode changed or the new image won't cover the old one.
+         */
+        if(old_mode == PREVIEW_KITTY && pv->mode != PREVIEW_KITTY)
+            clear_kitty_images();
+        if(pv->mode != old_mode || old_width > pv->image_width ||
+           old_height > pv->image_height)
+            shadow_invalidate(&sh);
+
+        begin_frame();
+        shadow_flush(&sh, 2, 2);
+        if(graphics)
+            sprintf(msg, "%s x%d | Lines %d-%d of %d | TAB: Mode  +/-: Scale  ESC: Close",
+                    mode_names[pv->mode], pv->scale,
+                    lines ? pv->first_line+1 : 0,
+                    (pv->first_line+vis < lines) ? pv->first_line+vis : lines, lines);
+        else
+            sprintf(msg, "%s | Lines %d-%d of %d | TAB: Switch mode  ESC: Close",
+                    mode_names[pv->mode], lines ? pv->first_line+1 : 0,
+                    (pv->first_line+vis < lines) ? pv->first_line+vis : lines, lines);
+        status_msg(msg);
+        end_frame();
+
+        old_mode = pv->mode;
+
+        if(graphics)
+        {
+            /* the image goes at the top left corner of the pane */
+            if(pv->mode == PREVIEW_KITTY) clear_kitty_images();
+            fprintf(stdout, "\033[2;2H");
+            if(!write_preview_image(pv, stdout, gpl, line_height, vis))
+                status_error("Insufficient memory!");
+            fflush(stdout);
+        }
+        else pv->image_width = pv->image_height = 0;
+
+        old_width = pv->image_width;
+        old_height = pv->image_height;
+
+        ch = getKey();
+
+        switch(ch)
+        {
+            case(UP_KEY):
+                if(pv->first_line > 0) pv->first_line--;
+                break;
+
+            case(DOWN_KEY):
+                if(pv->first_line < last) pv->first_line++;
+                break;
+
+            case(PGUP_KEY):
+                pv->first_line -= vis;
+                if(pv->first_line < 0) pv->first_line = 0;
+                break;
+
+            case(PGDOWN_KEY):
+                pv->first_line += vis;
+                if(pv->first_line > last) pv->first_line = last;
+                break;
+
+            case(HOME_KEY):
+                pv->first_line = 0;
+                break;
+
+            case(END_KEY):
+                pv->first_line = last;
+                break;
+
+            case(TAB_KEY):
+                pv->mode = (pv->mode+1) % PREVIEW_MODES;
+                break;
+
+            case('+'):
+            case('='):
+                if(pv->scale < MAX_PREVIEW_SCALE) pv->scale++;
+                break;
+
+            case('-'):
+                if(pv->scale > 1) pv->scale--;
+                break;
+
+            case(ESC_KEY):
+            case(ENTER_KEY):
+                goto fin;
+        }
+    }
+
+fin:
+    if(old_mode == PREVIEW_KITTY) clear_kitty_images();
+    for(i = 0; i < TILE_CACHE_SIZE; i++) free_report(&pv->tiles[i].data);
+    free(sh.frame);
+    free(sh.shown);
+    free(pv->canvas);
+    pv->canvas = NULL;
+    invalidate_view();
+}
+
+void preview_sample_text(struct font_s *font)
+{
+    struct preview_s pv;
+    char *input;
+
+    if(font->length == 0) return;
+
+    input = inputBoxI("Enter the text to preview:",
+                      "The quick brown fox jumps over the lazy dog. 0123456789",
+                      " Preview Text ");
+    if(!input || strlen(input) == 0) return;
+
+    memset(&pv, 0, sizeof(pv));
+    pv.font = font;
+    pv.mode = PREVIEW_BRAILLE;
+
+    if(!(pv.glyphs = text_to_glyphs(font, input, &pv.count)))
+    {
+        msgBox("Insufficient memory!", BUTTON_OK, ERROR);
+        return;
+    }
+
+    show_preview(&pv);
+    free(pv.glyphs);
+}
+
+void preview_whole_font(struct font_s *font)
+{
+    struct preview_s pv;
+
+    if(font->length == 0) return;
+
+    memset(&pv, 0, sizeof(pv));
+    pv.font = font;
+    pv.mode = PREVIEW_BRAILLE;
+    show_preview(&pv);
+}
+
+void preview_current_glyph(struct font_s *font)
+{
+    struct preview_s pv;
+    unsigned int g;
+
+    if(font->length == 0) return;
+
+    memset(&pv, 0, sizeof(pv));
+    g = get_glyph_index(font)/font->charsize;
+    pv.font = font;
+    pv.glyphs = &g;
+    pv.count = 1;
+    pv.mode = PREVIEW_BRAILLE;
+    pv.scale = 4;
+    show_preview(&pv);
+}
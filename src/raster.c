@@ -0,0 +1,303 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: raster.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "core.h"
+#include "metadata.h"
+#include "ink.h"
+#include "raster.h"
+
+/* drawn for characters the font doesn't have, or '?' if it has none */
+#define REPLACEMENT_CHAR        0xFFFD
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define cpu_to_be64(x)          (x)
+/* the bit of each byte of a word that shows the pixel of that byte */
+#define PIXEL_BITS              0x8040201008040201ULL
+#else
+#define cpu_to_be64(x)          __builtin_bswap64(x)
+#define PIXEL_BITS              0x0102040810204080ULL
+#endif
+
+#define BYTES_7F                0x7F7F7F7F7F7F7F7FULL
+#define BYTES_80                0x8080808080808080ULL
+#define BYTES_01                0x0101010101010101ULL
+
+/*
+ * OR w pixels of line (aligned to the most significant bit) into a 1 bpp
+ * row at pixel x. Where the row has 8 bytes to spare, the line is shifted
+ * into place and ORed in as one big-endian word, with the bits shifted out
+ * of it going to a ninth byte; near the right edge it is done a byte at a
+ * time, so we never touch memory past the last pixel of the row.
+ */
+static inline void or_row_1bpp(unsigned char *dest, int row_bytes, int x,
+                               uint64_t line, int w)
+{
+    int shift = x & 7, n = (shift+w+7)/8, k;
+    uint64_t word = line >> shift, d;
+
+    dest += x/8;
+
+    if(row_bytes-x/8 >= 8)
+    {
+        memcpy(&d, dest, 8);
+        d |= cpu_to_be64(word);
+        memcpy(dest, &d, 8);
+    }
+    else
+    {
+        for(k = 0; k < n && k < 8; k++) dest[k] |= (unsigned char)(word >> (56-k*8));
+    }
+
+    if(n > 8) dest[8] |= (unsigned char)(line << (8-shift));
+}
+
+/*
+ * Set the pixels of an 8 bpp row to color where the w pixels of line are
+ * set. Each byte of line is spread into 8 mask bytes of 0x00 or 0xFF,
+ * which blend the color in: with SSE2, two bytes (16 pixels) at a time by
+ * testing each lane against its bit; otherwise in a 64-bit word, where the
+ * multiply copies the byte into every lane, and adding 0x7F to each lane
+ * carries its bit into the lane's top bit.
+ */
+static inline void expand_row_8bpp(unsigned char *dest, uint64_t line, int w,
+                                   unsigned char color)
+{
+    uint64_t m, d, fill = color*BYTES_01;
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                      1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i fill16 = _mm_set1_epi8((char)color);
+    __m128i v, mask, pixels;
+
+    for( ; x+16 <= w; x += 16, line <<= 16)
+    {
+        if(!(line >> 48)) continue;
+        v = _mm_unpacklo_epi64(_mm_set1_epi8((char)(line >> 56)),
+                               _mm_set1_epi8((char)(line >> 48)));
+        mask = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+        pixels = _mm_loadu_si128((__m128i *)(dest+x));
+        pixels = _mm_or_si128(_mm_andnot_si128(mask, pixels),
+                              _mm_and_si128(mask, fill16));
+        _mm_storeu_si128((__m128i *)(dest+x), pixels);
+    }
+#endif
+
+    for( ; x+8 <= w; x += 8, line <<= 8)
+    {
+        if(!(line >> 56)) continue;
+        m = ((line >> 56)*BYTES_01) & PIXEL_BITS;
+        m = (((m+BYTES_7F) & BYTES_80) >> 7)*0xFF;
+        memcpy(&d, dest+x, 8);
+        d = (d & ~m) | (fill & m);
+        memcpy(dest+x, &d, 8);
+    }
+
+    for( ; x < w; x++, line <<= 1)
+    {
+        if(line >> 63) dest[x] = color;
+    }
+}
+
+/*
+ * Draw the part of a glyph cell from column left to right and row top to
+ * bottom (exclusive), with the top left corner of the cell at x, y. The
+ * part outside the framebuffer is clipped.
+ */
+static void draw_cell(struct font_s *font, unsigned int gindex,
+                      struct raster_s *r, int x, int y,
+                      int left, int top, int right, int bottom)
+{
+    int bytes = (font->width+7)/8, row_bytes = (r->width+7)/8;
+    unsigned char *src, *dest;
+    uint64_t mask, line;
+    int i;
+
+    if(left < -x) left = -x;
+    if(top < -y) top = -y;
+    if(right > r->width-x) right = r->width-x;
+    if(bottom > r->height-y) bottom = r->height-y;
+    if(left >= right || top >= bottom) return;
+
+    mask = glyph_row_mask(right) & ~glyph_row_mask(left);
+    src = font->data+(gindex*font->charsize)+(top*bytes);
+    dest = r->pixels+(long)(y+top)*r->stride;
+
+    for(i = top; i < bottom; i++, src += bytes, dest += r->stride)
+    {
+        if(!(line = load_glyph_row(src, bytes, mask))) continue;
+        line <<= left;
+
+        if(r->bpp == 1) or_row_1bpp(dest, row_bytes, x+left, line, right-left);
+        else expand_row_8bpp(dest+x+left, line, right-left, r->color);
+    }
+}
+
+/* draw the whole glyph cell with its top left corner at x, y */
+void raster_glyph(struct font_s *font, unsigned int gindex,
+                  struct raster_s *r, int x, int y)
+{
+    draw_cell(font, gindex, r, x, y, 0, 0, font->width, font->height);
+}
+
+/*
+ * Decode one UTF-8 character from the len bytes at s. Bad or cut short
+ * sequences give REPLACEMENT_CHAR and take one byte. Returns the number of
+ * bytes used.
+ */
+static int next_char(unsigned char *s, int len, unsigned int *cp)
+{
+    unsigned int c = s[0], min;
+    int n, i;
+
+    if(c < 0x80)
+    {
+        *cp = c;
+        return 1;
+    }
+    else if((c & 0xE0) == 0xC0) { n = 2; c &= 0x1F; min = 0x80; }
+    else if((c & 0xF0) == 0xE0) { n = 3; c &= 0x0F; min = 0x800; }
+    else if((c & 0xF8) == 0xF0) { n = 4; c &= 0x07; min = 0x10000; }
+    else goto bad;
+
+    if(n > len) goto bad;
+
+    for(i = 1; i < n; i++)
+    {
+        if((s[i] & 0xC0) != 0x80) goto bad;
+        c = (c << 6) | (s[i] & 0x3F);
+    }
+
+    if(c < min || c > 0x10FFFF) goto bad;
+    *cp = c;
+    return n;
+
+bad:
+    *cp = REPLACEMENT_CHAR;
+    return 1;
+}
+
+static unsigned int find_glyph(struct font_s *font, struct cpmap_s *map,
+                               int mapsize, unsigned int cp)
+{
+    unsigned int g = find_cpmap_glyph(font, map, mapsize, cp);
+
+    if(g == NO_GLYPH) g = find_cpmap_glyph(font, map, mapsize, REPLACEMENT_CHAR);
+    if(g == NO_GLYPH) g = find_cpmap_glyph(font, map, mapsize, '?');
+    return g;
+}
+
+/* how far the pen moves after the glyph (the DWIDTH of BDF fonts) */
+static inline int glyph_advance(struct font_s *font, unsigned int gindex)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+
+    if(gindex == NO_GLYPH || !char_info) return font->width;
+    return (char_info[gindex].dwidthX > 0) ? char_info[gindex].dwidthX : 0;
+}
+
+/*
+ * The baseline of the line, in rows from the top. Glyphs of PCF fonts each
+ * have their own ascent (see get_glyph_origin()), so the line takes the
+ * tallest one, which is the top of the font bounding box.
+ */
+static int get_line_ascent(struct font_s *font)
+{
+    struct metadata_item_s *meta = (struct metadata_item_s *)font->metadata;
+    int xorigin, ascent;
+
+    if(font->version == VER_PCF && font->has_metadata && meta &&
+       meta[METADATA_FONTBOUNDINGBOX_Y].value > 0)
+        return meta[METADATA_FONTBOUNDINGBOX_Y].value+
+               meta[METADATA_FONTBOUNDINGBOX_YOFF].value;
+
+    get_glyph_origin(font, 0, &xorigin, &ascent);
+    return ascent;
+}
+
+/*
+ * Draw len bytes of UTF-8 text on one line, with the top left corner of the
+ * line at x, y. The line is font->height pixels high. Each glyph is placed
+ * at its origin and moved along by its advance, so proportional BDF and PCF
+ * fonts come out as they should, and only the rows and columns inside the
+ * bounding box (BBX) of the glyph are drawn. map and mapsize are from
+ * get_cpmap(). Returns the x of the pen after the text.
+ */
+int raster_text(struct font_s *font, struct cpmap_s *map, int mapsize,
+                unsigned char *text, int len, struct raster_s *r, int x, int y)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    int baseline, xorigin, ascent, left, top, right, bottom, i;
+    unsigned int cp, g;
+
+    if(!font->length || !font->data) return x;
+    baseline = y+get_line_ascent(font);
+
+    for(i = 0; i < len; x += glyph_advance(font, g))
+    {
+        i += next_char(text+i, len-i, &cp);
+        if((g = find_glyph(font, map, mapsize, cp)) == NO_GLYPH) continue;
+
+        get_glyph_origin(font, g, &xorigin, &ascent);
+        left = 0;
+        top = 0;
+        right = font->width;
+        bottom = font->height;
+
+        if(char_info && char_info[g].BBw > 0 && char_info[g].BBh > 0)
+        {
+            left = char_info[g].BBXoff-xorigin;
+            top = ascent-char_info[g].BBYoff-char_info[g].BBh;
+            right = left+char_info[g].BBw;
+            bottom = top+char_info[g].BBh;
+            if(left < 0) left = 0;
+            if(top < 0) top = 0;
+            if(right > (int)font->width) right = font->width;
+            if(bottom > (int)font->height) bottom = font->height;
+        }
+
+        draw_cell(font, g, r, x+xorigin, baseline-ascent, left, top, right, bottom);
+    }
+
+    return x;
+}
+
+/* the width of the text as raster_text() would draw it */
+int raster_text_width(struct font_s *font, struct cpmap_s *map, int mapsize,
+                      unsigned char *text, int len)
+{
+    unsigned int cp;
+    int i, width = 0;
+
+    if(!font->length || !font->data) return 0;
+
+    for(i = 0; i < len; )
+    {
+        i += next_char(text+i, len-i, &cp);
+        width += glyph_advance(font, find_glyph(font, map, mapsize, cp));
+    }
+
+    return width;
+}
@@ -0,0 +1,49 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: raster.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "font_ops.h"
+
+/*
+ * A framebuffer to draw text into. Rows are stride bytes apart. At 1 bpp
+ * the leftmost pixel of a byte is in its most significant bit; at 8 bpp
+ * each pixel is a byte, and text pixels are set to color. Only the pixels
+ * of the glyphs are touched, the background is left as it is.
+ */
+struct raster_s
+{
+    unsigned char *pixels;
+    int width, height;          /* in pixels */
+    long stride;
+    int bpp;                    /* 1 or 8 */
+    unsigned char color;        /* 8 bpp only */
+};
+
+/* raster.c */
+void raster_glyph(struct font_s *font, unsigned int gindex,
+                  struct raster_s *r, int x, int y);
+int raster_text(struct font_s *font, struct cpmap_s *map, int mapsize,
+                unsigned char *text, int len, struct raster_s *r, int x, int y);
+int raster_text_width(struct font_s *font, struct cpmap_s *map, int mapsize,
+                      unsigned char *text, int len);
+
+#endif
@@ -56,6 +56,100 @@ char *readme_text =
   "- BDF fonts (beta)\n"
   "- PCF font and Windows FON files support are under development\n"
   "\n"
+  "Converting fonts:\n"
+  "=================\n"
+  "Fonts can be converted from the command line, without opening the editor:\n"
+  "\n"
+  "  fontopia convert [options] in-file out-file\n"
+  "\n"
+  "The --format (or -f) option selects the new format (psf1, psf2, cp, raw,\n"
+  "bdf or pcf). Without it, the format is taken from the extension of out-file\n"
+  "(.psf files are written as PSF 2). Raw input fonts need the -w and -i\n"
+  "options, as in the editor. Errors are printed to stderr and the exit status\n"
+  "is non-zero, so this can be used in scripts and build systems. When\n"
+  "converting a CP font, only the first font in the file is converted.\n"
+  "\n"
+  "To convert many fonts at once, give -o (or --output-dir) an output\n"
+  "directory and -f a comma-separated list of formats. The rest of the command\n"
+  "line names font files or directories, which are searched for font files,\n"
+  "and -l adds files listed in a file (- for stdin). The files are converted\n"
+  "in parallel (-j sets the number of jobs, one per CPU by default) and the\n"
+  "directory structure is kept in the output directory:\n"
+  "\n"
+  "  fontopia convert -j 4 -f bdf,pcf -o out-dir fonts/\n"
+  "\n"
+  "A file that fails to convert doesn't stop the others; the number of failed\n"
+  "files is printed at the end. Outputs are named after their input without\n"
+  "its extension, so nothing is converted if two inputs (e.g. x.psf and x.bdf)\n"
+  "would write the same files.\n"
+  "\n"
+  "To see where the time goes, --stats=json prints the time spent reading the\n"
+  "files, parsing them, decoding the glyph bitmaps, building the unicode table\n"
+  "and writing the output, with the bytes read and written, the glyphs decoded\n"
+  "and (if configured with --enable-alloc-stats) the memory allocations made.\n"
+  "--trace=X writes the same phases to file X as Chrome trace events, to be\n"
+  "viewed in chrome://tracing or Perfetto.\n"
+  "\n"
+  "Using fontopia as a library:\n"
+  "============================\n"
+  "The font format modules are also built as a library (libfontopia), which\n"
+  "other programs can use to read and write fonts without running fontopia.\n"
+  "The library doesn't need ncurses or GnuDOS, at build or run time; to build\n"
+  "only the library, run configure with --disable-fontopia. The C API is in\n"
+  "libfontopia.h: fonts are opened from a file or a memory buffer, and the\n"
+  "program can then read the font metrics, get glyph bitmaps by index or by\n"
+  "unicode value, and write the font in any of the supported formats. It can\n"
+  "also draw lines of UTF-8 text into a framebuffer of 1 or 8 bits per pixel\n"
+  "(fontopia_render_text()), placing the glyphs of proportional BDF and PCF\n"
+  "fonts by their metrics. A line takes microseconds, which is quick enough\n"
+  "for status screens while the system boots.\n"
+  "\n"
+  "Benchmarks:\n"
+  "===========\n"
+  "\"make bench\" (or \"fontopia bench\") times loading, saving and converting\n"
+  "fonts in every format, drawing text into 1 and 8 bpp framebuffers, and the\n"
+  "glyph kernels (invert, rotate, center, glyph size change and the unicode\n"
+  "table build). The fonts are made up with random glyphs, at 256, 4096 and\n"
+  "65536 glyphs of 8, 16 and 32 pixels wide. Sizes a format can't hold are\n"
+  "skipped. Each result is printed as a JSON object on a line of its own, with\n"
+  "the wall time of one run, glyphs per second and the peak memory use, so\n"
+  "results can be compared between versions. Options are passed in BENCHFLAGS,\n"
+  "e.g.:\n"
+  "\n"
+  "  make bench BENCHFLAGS=\"-f psf2,bdf -g 4096 -t 1\"\n"
+  "\n"
+  "\"fontopia replay\" plays a key script against the editor, which runs on a\n"
+  "pseudo-terminal of its own, and prints how long each screen update took and\n"
+  "how many bytes the editor sent to the terminal, as JSON lines. Each line of\n"
+  "the script is one frame: the keys the editor handles before it is back in\n"
+  "its main loop, separated by blanks, e.g. \"^G \"100\" ENTER\" to go to glyph 100,\n"
+  "or \"RIGHT *10\" to press RIGHT ten times. Keys are UP, DOWN, LEFT, RIGHT, HOME,\n"
+  "END, PGUP, PGDN, INS, DEL, TAB, ENTER, SPACE, ESC, BACKSPACE, ^X for CTRL+X,\n"
+  "M-x for ALT+x, any other single character, or a \"quoted\" string, and #\n"
+  "starts a comment. With --max-bytes or --max-time, it fails if the editor\n"
+  "sent more bytes, or took longer, than that, so a script can guard the\n"
+  "screen updates against getting slower, e.g.:\n"
+  "\n"
+  "  fontopia replay --max-bytes 50000 edit.keys font.psf\n"
+  "\n"
+  "Font server:\n"
+  "============\n"
+  "\"fontopia --serve socket font-file...\" loads the fonts once and answers\n"
+  "requests for their metrics, for the glyph of a unicode value, and for a line\n"
+  "of UTF-8 text drawn with the font, on a Unix socket. Programs that need the\n"
+  "same fonts can then ask the server instead of parsing the fonts themselves.\n"
+  "The requests and replies are small binary structs, described in src/serve.h.\n"
+  "Every client gets a thread of its own, and many clients can be served at\n"
+  "once. Send SIGHUP to the server to reload the fonts from disk (or send it a\n"
+  "reload request); requests that are already running finish with the old font,\n"
+  "and nobody waits for the new one to load. SIGTERM stops the server.\n"
+  "Only the server's user can connect to the socket, unless --mode says\n"
+  "otherwise (e.g. --mode 660 for its group). Clients past the --clients limit\n"
+  "are told the server is busy, and clients that send nothing for --timeout\n"
+  "seconds are dropped.\n"
+  "\n"
+  "  fontopia --serve /tmp/fonts.sock ter-116n.bdf ter-132n.pcf\n"
+  "\n"
   "WARNING:\n"
   "========\n"
   "(1) There is a major downside currently: fontopia doesn't work with unicode\n"
@@ -73,10 +167,13 @@ char *readme_text =
   "===========\n"
   "Using the editor is very easy:\n"
   "(1)  Navigate the glyphs on the right side window using the arrow keys. Edit\n"
-  "     a single glyph using ENTER (or TAB).\n"
+  "     a single glyph using ENTER (or TAB). PGUP/PGDN scroll a page at a time,\n"
+  "     HOME/END go to the first/last glyph, and CTRL+G goes to a glyph by its\n"
+  "     index or by a percentage of the font (e.g. 50%).\n"
   "(2)  Navigate the bits that form a single bit (on the left side window)\n"
   "     using arrow keys. Press ENTER or SPACE to set/unset the desired bit. Go\n"
-  "     back to right window (glyph list) using TAB.\n"
+  "     back to right window (glyph list) using TAB. Glyphs that are too large for the window (up to 64x128\n"
+  "     pixels) scroll to follow the cursor.\n"
   "(3)  To zoom in (make the glyph on the left look bigger), press Z.\n"
   "(4)  To zoom out, press X.\n"
   "(5)  To open a new file, press CTRL+O.\n"
@@ -112,6 +209,49 @@ char *readme_text =
   "     press any key from '1' to '4' and the respective font will be the\n"
   "     active font to be edited. You can go back and forth by using the\n"
   "     number keys.\n"
+  "(30) To select a range of glyphs, press F on the first glyph in the right\n"
+  "     window, move to the last glyph and press F again (or ESC to cancel).\n"
+  "     C, D, S, H, V and the extended glyph operations (O) then apply to all\n"
+  "     the selected glyphs.\n"
+  "(31) To make a bold, oblique or outline variant of the font, press Y.\n"
+  "     This works on the whole font, or on the selected glyphs if there\n"
+  "     is a selection.\n"
+  "(32) To show the font tools menu, press T. The tools work on the whole font:\n"
+  "     - Find duplicate glyphs: lists glyphs with identical bitmaps and their\n"
+  "       unicode values. PSF2 fonts with a unicode table can be compacted, so\n"
+  "       that each group of duplicates becomes one glyph with all the unicode\n"
+  "       values of the group.\n"
+  "     - Find similar glyphs: lists the pairs of glyphs that differ in only a\n"
+  "       few pixels (e.g. a stray pixel, or a copy that was never finished),\n"
+  "       with their unicode values.\n"
+  "     - Subset font from a text file or a codepoint list: keeps only the\n"
+  "       glyphs needed to show the characters in a UTF-8 text file, or in a\n"
+  "       list of hex values and ranges (e.g. U+0020-U+007E), then offers to\n"
+  "       save the new font.\n"
+  "     - Merge glyphs from other fonts: adds the characters that are missing\n"
+  "       from this font, taking each from the first of the chosen fonts that\n"
+  "       has it. Glyphs of another size are centered or scaled to fit. The font\n"
+  "       needs a unicode table.\n"
+  "     - Trim empty rows: removes the rows at the top and bottom of the glyph\n"
+  "       cell that are empty in all glyphs.\n"
+  "     - Preview sample text, Preview whole font, Preview current glyph: show\n"
+  "       the text you type (or all glyphs of the font, or the current glyph) drawn\n"
+  "       with the font's own bitmaps, using braille (2x4 pixels per cell) or half\n"
+  "       block (1x2 pixels per cell) characters, or as a Sixel or kitty graphics\n"
+  "       image on terminals that support them. TAB switches between the four, +/-\n"
+  "       scale the image, arrows and PGUP/PGDN scroll.\n"
+  "(33) To undo the last change, press CTRL+Z. To redo it, press CTRL+Y.\n"
+  "     Glyph edits are kept as the bits that changed, so the history is\n"
+  "     cheap to keep; changes to the font metrics or length keep a copy of\n"
+  "     the font. The oldest changes are forgotten when the history grows\n"
+  "     past 32 MB (see the --undo-memory option).\n"
+  "(34) To find out which keys are slow to handle, start fontopia with\n"
+  "     --latency FILE. The time from reading each key to the end of the\n"
+  "     screen update it causes is kept as a histogram for the command it\n"
+  "     runs, and the histograms are written to FILE as JSON lines (count,\n"
+  "     mean, 50th/90th/99th/99.9th percentiles and max, in microseconds) on\n"
+  "     exit, or when you press CTRL+L. Keys that open a dialog include the\n"
+  "     time the dialog was open.\n"
   "\n"
   "The unicode values that are mapped to a specific glyph are shown on the\n"
   "status bar (the bottom strip) to the right side.\n"
@@ -128,10 +268,18 @@ char *keys_text =
   "ENTER:  Toggle bit set/unset (if in left window)\n"
   "        Edit glyph (if in right window)\n"
   "SPACE:  As ENTER above\n"
+  "PGUP/PGDN:\n"
+  "        Scroll the glyph list a page up/down (if in right window)\n"
+  "        Go to the top/bottom row of the glyph (if in left window)\n"
+  "HOME/END:\n"
+  "        Go to the first/last glyph (if in right window)\n"
+  "        Go to the first/last column of the glyph (if in left window)\n"
   "^B   :  Switch buffer mode (on/off)\n"
   "^C   :  Copy a glyph\n"
   "^D   :  Save with a new filename (aka Save As..)\n"
+  "^G   :  Go to a glyph by index or percentage of the font\n"
   "^H   :  Show help\n"
+  "^L   :  Write keystroke latencies (with --latency)\n"
   "^N   :  Create a new font from scratch\n"
   "^O   :  Open a new file\n"
   "^Q   :  Quit the editor\n"
@@ -140,19 +288,24 @@ char *keys_text =
   "^V   :  Paste a glyph\n"
   "^W   :  Export font glyphs to a C-style source file\n"
   "^X   :  Cut a glyph\n"
+  "^Y   :  Redo the last undone change\n"
+  "^Z   :  Undo the last change\n"
   "A    :  Show about dialog box\n"
   "C    :  Clear a glyph (i.e. remove all bits)\n"
   "D    :  Invert a glyph\n"
   "E    :  Export font unicode table\n"
+  "F    :  Start/end a glyph selection (in right window)\n"
   "I    :  Import unicode table from another file\n"
   "K    :  Show these keys without the extra jargon\n"
   "M    :  Show font metrics window\n"
   "P    :  Change codepage of a CP font\n"
   "        If font is in BDF format, P shows properties (or metadata)\n"
   "S    :  Set a glyph (i.e. set all bits)\n"
+  "T    :  Show font tools (e.g. find duplicate glyphs)\n"
   "U    :  Show font unicode table\n"
   "W    :  Export font glyphs to a plain text file\n"
   "X    :  Zoom out\n"
+  "Y    :  Synthesize a bold, oblique or outline style of the font\n"
   "Z    :  Zoom in\n"
   "1 to 4 (number keys):\n"
   "        Change the active font in a CP font file\n"
@@ -0,0 +1,687 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: replay.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+/* posix_openpt() and friends */
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <termios.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include "defs.h"
+
+/*
+ * Replay a key script against the editor, to measure how long each screen
+ * update takes and how much it sends to the terminal:
+ *
+ *   fontopia replay [options] script [editor options] [file-name]
+ *
+ * The editor runs in a child process on a pseudo-terminal of its own (80x25
+ * by default), and gets the keys as a terminal would send them. After the
+ * keys of each frame we send a NUL, which the editor's main loop answers
+ * by writing the time it was done with the last key to the --frame-fd
+ * pipe. This way we know when a frame ended without guessing from the
+ * output, even if some of the keys went to a dialog. The editor does the
+ * same once before the first key, when the font is loaded and drawn, and
+ * when it exits.
+ *
+ * Each line of the script is one frame, i.e. the keys the editor handles
+ * before it is back in its main loop. Keys are separated by blanks:
+ *
+ *   UP DOWN LEFT RIGHT HOME END PGUP PGDN INS DEL
+ *   TAB ENTER SPACE ESC BACKSPACE
+ *   ^X          CTRL+X
+ *   M-x         ALT+x
+ *   x           the key x (any other single character)
+ *   "text"      each character of text, one key at a time
+ *   *N          (at the end of a line) repeat the line N times
+ *
+ * and # starts a comment. A dialog is a single frame, e.g. "^G 100 ENTER"
+ * opens the go to glyph dialog, types 100 and closes it.
+ *
+ * Each frame is printed as a JSON object on a line of its own, e.g.
+ *
+ *   {"frame":12,"line":5,"keys":"RIGHT *10","bytes":73,"us":412}
+ *
+ * where us is the time from writing the last key of the frame to the end
+ * of the screen update. Frame 0 is the start up, which includes loading the
+ * font. A summary line with the totals and percentiles comes last.
+ */
+
+#define REPLAY_MAX_KEY          8
+#define REPLAY_SETTLE_MS        5
+
+struct replay_key_s
+{
+    char seq[REPLAY_MAX_KEY];
+    int len;
+};
+
+struct replay_frame_s
+{
+    char *text;
+    int line;
+    struct replay_key_s *keys;
+    int count;
+    int repeat;
+};
+
+struct replay_s
+{
+    int cols, rows;
+    int delay;                  /* ms between keys */
+    int timeout;                /* seconds to wait for a frame */
+    long max_bytes;             /* fail if more bytes are sent */
+    long max_time;              /* fail if the frames take more ms */
+    char *term;
+    struct replay_frame_s *frames;
+    int frame_count;
+    /* the editor */
+    pid_t pid;
+    int master;                 /* our side of its terminal */
+    int frame_fd;               /* where it tells us a frame ended */
+    long long start_time;       /* when it was started */
+};
+
+static struct
+{
+    char *name, *seq;
+} key_names[] =
+{
+    { "UP", "\033[A" }, { "DOWN", "\033[B" }, { "RIGHT", "\033[C" },
+    { "LEFT", "\033[D" }, { "HOME", "\033[H" }, { "END", "\033[F" },
+    { "PGUP", "\033[5~" }, { "PGDN", "\033[6~" }, { "INS", "\033[2~" },
+    { "DEL", "\033[3~" }, { "TAB", "\t" }, { "ENTER", "\r" },
+    { "SPACE", " " }, { "ESC", "\033" }, { "BACKSPACE", "\177" },
+};
+
+/* set by --frame-fd in the editor we are replaying into */
+int replay_frame_fd = -1;
+
+/* when the editor was last done with a key */
+static long long key_done_time = 0;
+
+static long long now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static void write_frame_time()
+{
+    if(write(replay_frame_fd, &key_done_time, sizeof(key_done_time))
+                                            != sizeof(key_done_time))
+        replay_frame_fd = -1;
+}
+
+/*
+ * stdout may be closed by now (see exit_gracefully()), and what is left in
+ * it is flushed after this, so we can't flush it first.
+ */
+static void replay_exit()
+{
+    key_done_time = now_us();
+    if(replay_frame_fd >= 0) write_frame_time();
+}
+
+/* called by the editor for --frame-fd */
+void replay_start(int fd)
+{
+    replay_frame_fd = fd;
+    atexit(replay_exit);
+}
+
+/* called by the editor when it is done with a key */
+void replay_key_done()
+{
+    key_done_time = now_us();
+}
+
+/* called by the editor when it reads the NUL that ends a frame */
+void replay_frame_done()
+{
+    if(replay_frame_fd < 0) return;
+    if(!key_done_time) key_done_time = now_us();
+
+    fflush(stdout);
+    write_frame_time();
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms/1000, (ms%1000)*1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+static int add_key(struct replay_frame_s *frame, char *seq, int len)
+{
+    struct replay_key_s *keys;
+
+    keys = (struct replay_key_s *)realloc(frame->keys,
+                                    (frame->count+1)*sizeof(struct replay_key_s));
+    if(!keys) return 0;
+
+    frame->keys = keys;
+    memcpy(keys[frame->count].seq, seq, len);
+    keys[frame->count++].len = len;
+    return 1;
+}
+
+/* parse one line of the script, returns 0 on error */
+static int parse_line(struct replay_frame_s *frame, char *line)
+{
+    char *p = line, *tok, c;
+    unsigned int i;
+
+    frame->repeat = 1;
+
+    while(1)
+    {
+        while(*p == ' ' || *p == '\t') p++;
+        if(!*p || *p == '#') return 1;
+
+        if(*p == '"')
+        {
+            for(p++; *p && *p != '"'; p++)
+            {
+                if(*p == '\\' && p[1]) p++;
+                if(!add_key(frame, p, 1)) return 0;
+            }
+            if(*p++ != '"') return 0;
+            continue;
+        }
+
+        for(tok = p; *p && *p != ' ' && *p != '\t'; p++) ;
+        c = *p;
+        *p = '\0';
+
+        if(tok[0] == '*' && tok[1])
+        {
+            if((frame->repeat = atoi(tok+1)) <= 0) return 0;
+        }
+        else if(!tok[1])
+        {
+            if(!add_key(frame, tok, 1)) return 0;
+        }
+        else if(tok[0] == '^' && !tok[2])
+        {
+            char ctrl = tok[1] & 0x1f;
+            if(!add_key(frame, &ctrl, 1)) return 0;
+        }
+        else if(tok[0] == 'M' && tok[1] == '-' && tok[2] && !tok[3])
+        {
+            char alt[2] = { '\033', tok[2] };
+            if(!add_key(frame, alt, 2)) return 0;
+        }
+        else
+        {
+            for(i = 0; i < sizeof(key_names)/sizeof(key_names[0]); i++)
+            {
+                if(strcasecmp(tok, key_names[i].name) == 0) break;
+            }
+
+            if(i == sizeof(key_names)/sizeof(key_names[0])) return 0;
+            if(!add_key(frame, key_names[i].seq, strlen(key_names[i].seq)))
+                return 0;
+        }
+
+        *p = c;
+    }
+}
+
+static int read_script(struct replay_s *replay, char *file_name)
+{
+    struct replay_frame_s *frame;
+    FILE *file;
+    char buf[1024], *nl;
+    int line = 0;
+
+    if(!(file = fopen(file_name, "r")))
+    {
+        fprintf(stderr, "fontopia: Failed to open %s\n", file_name);
+        return 0;
+    }
+
+    while(fgets(buf, sizeof(buf), file))
+    {
+        line++;
+        if((nl = strchr(buf, '\n'))) *nl = '\0';
+
+        frame = (struct replay_frame_s *)realloc(replay->frames,
+                        (replay->frame_count+1)*sizeof(struct replay_frame_s));
+        if(!frame) goto memory_error;
+
+        replay->frames = frame;
+        frame += replay->frame_count;
+        memset(frame, 0, sizeof(struct replay_frame_s));
+        frame->line = line;
+
+        if(!(frame->text = strdup(buf))) goto memory_error;
+
+        if(!parse_line(frame, buf))
+        {
+            fprintf(stderr, "fontopia: %s:%d: Invalid key\n", file_name, line);
+            free(frame->text);
+            free(frame->keys);
+            fclose(file);
+            return 0;
+        }
+
+        /* blank lines and comments have no keys */
+        if(frame->count) replay->frame_count++;
+        else free(frame->text);
+    }
+
+    fclose(file);
+    return 1;
+
+memory_error:
+
+    fprintf(stderr, "fontopia: Insufficient memory\n");
+    fclose(file);
+    return 0;
+}
+
+static void free_script(struct replay_s *replay)
+{
+    int i;
+
+    for(i = 0; i < replay->frame_count; i++)
+    {
+        free(replay->frames[i].text);
+        free(replay->frames[i].keys);
+    }
+
+    free(replay->frames);
+}
+
+/* run the editor on a new pseudo-terminal */
+static int start_editor(struct replay_s *replay, int argc, char **argv)
+{
+    struct winsize ws = { replay->rows, replay->cols, 0, 0 };
+    char **args, fd[16];
+    int pipefd[2], slave, i;
+
+    if((replay->master = posix_openpt(O_RDWR | O_NOCTTY)) < 0 ||
+       grantpt(replay->master) != 0 || unlockpt(replay->master) != 0 ||
+       ioctl(replay->master, TIOCSWINSZ, &ws) != 0)
+    {
+        perror("fontopia: pseudo-terminal");
+        return 0;
+    }
+
+    if(pipe(pipefd) != 0 ||
+       !(args = (char **)malloc((argc+4)*sizeof(char *))))
+    {
+        perror("fontopia");
+        return 0;
+    }
+
+    sprintf(fd, "%d", pipefd[1]);
+    args[0] = "fontopia";
+    args[1] = "--frame-fd";
+    args[2] = fd;
+    for(i = 0; i < argc; i++) args[i+3] = argv[i];
+    args[argc+3] = NULL;
+
+    fflush(stdout);
+    replay->start_time = now_us();
+
+    if((replay->pid = fork()) < 0)
+    {
+        perror("fontopia: fork");
+        return 0;
+    }
+
+    if(replay->pid == 0)
+    {
+        setsid();
+        if((slave = open(ptsname(replay->master), O_RDWR)) < 0) _exit(127);
+        ioctl(slave, TIOCSCTTY, 0);
+        dup2(slave, 0);
+        dup2(slave, 1);
+        dup2(slave, 2);
+        if(slave > 2) close(slave);
+        close(replay->master);
+        close(pipefd[0]);
+        setenv("TERM", replay->term, 1);
+        execv("/proc/self/exe", args);
+        _exit(127);
+    }
+
+    free(args);
+    close(pipefd[1]);
+    replay->frame_fd = pipefd[0];
+    return 1;
+}
+
+/* read what the editor sent to the terminal, returns the byte count */
+static long read_output(struct replay_s *replay)
+{
+    char buf[4096];
+    long n;
+
+    if(replay->master < 0) return 0;
+
+    if((n = read(replay->master, buf, sizeof(buf))) <= 0)
+    {
+        /* the editor has closed its terminal */
+        close(replay->master);
+        replay->master = -1;
+        return 0;
+    }
+
+    return n;
+}
+
+/*
+ * Wait for the editor to finish a frame, counting the bytes it sends on
+ * the way. Returns 1 when the frame is done, 0 if the editor has exited,
+ * and -1 if we timed out.
+ */
+static int wait_frame(struct replay_s *replay, long *bytes, long long *end)
+{
+    struct pollfd fds[2];
+    long long deadline = now_us()+(long long)replay->timeout*1000000;
+    int res;
+
+    *bytes = 0;
+
+    while(1)
+    {
+        int ms = (int)((deadline-now_us())/1000);
+
+        if(ms < 0) return -1;
+
+        fds[0].fd = replay->frame_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = replay->master;
+        fds[1].events = POLLIN;
+
+        if(poll(fds, (replay->master < 0) ? 1 : 2, ms) < 0) return -1;
+
+        if(replay->master >= 0 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR)))
+            *bytes += read_output(replay);
+
+        if(fds[0].revents & (POLLIN | POLLHUP))
+        {
+            /* if the editor has exited, the frame ends now */
+            *end = now_us();
+            res = (read(replay->frame_fd, end, sizeof(*end)) == sizeof(*end));
+            break;
+        }
+    }
+
+    /*
+     * The terminal may pass on the last of the frame a bit after we are
+     * told the frame ended, so wait for the output to settle.
+     */
+    fds[0].fd = replay->master;
+    fds[0].events = POLLIN;
+
+    while(replay->master >= 0 && poll(fds, 1, REPLAY_SETTLE_MS) > 0)
+        *bytes += read_output(replay);
+
+    return res;
+}
+
+static void print_json_string(char *s)
+{
+    putchar('"');
+
+    for( ; *s; s++)
+    {
+        if(*s == '"' || *s == '\\') printf("\\%c", *s);
+        else if((unsigned char)*s < 0x20) printf("\\u%04x", *s);
+        else putchar(*s);
+    }
+
+    putchar('"');
+}
+
+static int compare_times(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* play the script, returns 0 on success */
+static int replay_script(struct replay_s *replay)
+{
+    struct replay_frame_s *frame;
+    long long start, end, *times = NULL, total_time = 0;
+    long bytes, total_bytes = 0;
+    int i, j, r, frames = 0, total = 1, res;
+
+    for(i = 0; i < replay->frame_count; i++) total += replay->frames[i].repeat;
+
+    if(!(times = (long long *)malloc(total*sizeof(long long))))
+    {
+        fprintf(stderr, "fontopia: Insufficient memory\n");
+        return 1;
+    }
+
+    /* the first frame is the start up */
+    start = replay->start_time;
+    frame = NULL;
+    i = -1;
+    r = 0;
+
+    while(1)
+    {
+        if((res = wait_frame(replay, &bytes, &end)) < 0)
+        {
+            if(frame) fprintf(stderr, "fontopia: Line %d: The editor is still "
+                                      "busy after %d seconds (is a dialog "
+                                      "waiting for more keys?)\n",
+                                      frame->line, replay->timeout);
+            else fprintf(stderr, "fontopia: The editor didn't start\n");
+            free(times);
+            return 1;
+        }
+
+        /* the NUL was read with the last key, e.g. as ALT+ESC */
+        if(frame && end < start)
+        {
+            fprintf(stderr, "fontopia: Line %d: The editor didn't read the last "
+                            "key on its own (try a longer --delay)\n",
+                            frame->line);
+            free(times);
+            return 1;
+        }
+
+        times[frames] = end-start;
+        total_time += end-start;
+        total_bytes += bytes;
+
+        printf("{\"frame\":%d,\"line\":%d,\"keys\":", frames,
+               frame ? frame->line : 0);
+        print_json_string(frame ? frame->text : "");
+        printf(",\"bytes\":%ld,\"us\":%lld}\n", bytes, end-start);
+        frames++;
+
+        /* next frame */
+        if(!frame || ++r == frame->repeat)
+        {
+            r = 0;
+            if(++i == replay->frame_count) break;
+            frame = &replay->frames[i];
+        }
+
+        if(res == 0)
+        {
+            fprintf(stderr, "fontopia: Line %d: The editor has exited\n",
+                            frame->line);
+            free(times);
+            return 1;
+        }
+
+        /*
+         * The keys are sent apart, so that the editor doesn't read an ESC
+         * and the next key as one escape sequence. The NUL at the end is
+         * not timed, as the editor tells us when it was done with the
+         * last key.
+         */
+        for(j = 0; j < frame->count; j++)
+        {
+            if(j) sleep_ms(replay->delay);
+            if(j == frame->count-1) start = now_us();
+
+            if(write(replay->master, frame->keys[j].seq, frame->keys[j].len)
+                                                    != frame->keys[j].len)
+            {
+                fprintf(stderr, "fontopia: Line %d: The editor has exited\n",
+                                frame->line);
+                free(times);
+                return 1;
+            }
+        }
+
+        /* this fails if the last key made the editor quit */
+        sleep_ms(replay->delay);
+        res = (int)write(replay->master, "", 1);
+    }
+
+    qsort(times, frames, sizeof(long long), compare_times);
+    printf("{\"frames\":%d,\"bytes\":%ld,\"total_us\":%lld,\"mean_us\":%lld,"
+           "\"p50_us\":%lld,\"p90_us\":%lld,\"p99_us\":%lld,\"max_us\":%lld}\n",
+           frames, total_bytes, total_time, total_time/frames,
+           times[(frames-1)*50/100], times[(frames-1)*90/100],
+           times[(frames-1)*99/100], times[frames-1]);
+    free(times);
+
+    res = 0;
+
+    if(replay->max_bytes >= 0 && total_bytes > replay->max_bytes)
+    {
+        fprintf(stderr, "fontopia: The editor sent %ld bytes, more than %ld\n",
+                        total_bytes, replay->max_bytes);
+        res = 1;
+    }
+
+    if(replay->max_time >= 0 && total_time > replay->max_time*1000)
+    {
+        fprintf(stderr, "fontopia: The frames took %lld ms, more than %ld\n",
+                        total_time/1000, replay->max_time);
+        res = 1;
+    }
+
+    return res;
+}
+
+static void replay_usage(FILE *f)
+{
+    fprintf(f, "Usage: fontopia replay [options] script [editor options] [file-name]\n"
+               "\nOptions:\n"
+               "  [-b, --max-bytes X]  fail if the editor sends more than X bytes to\n"
+               "                         the terminal\n"
+               "  [-c, --cols X]       make the terminal X columns wide (default: 80)\n"
+               "  [-d, --delay X]      wait X ms between keys, which must be longer than\n"
+               "                         the editor waits after an ESC (default: 50)\n"
+               "  [-h, --help]         show this help and exit\n"
+               "  [-m, --max-time X]   fail if the frames take more than X ms in all\n"
+               "  [-r, --rows X]       make the terminal X rows high (default: 25)\n"
+               "  [-T, --term X]       set TERM to X (default: xterm)\n"
+               "  [-t, --timeout X]    give up if a frame takes more than X seconds\n"
+               "                         (default: 10)\n"
+               "\nEach line of the script is one frame. Results are printed to stdout,\n"
+               "one JSON object per frame, then one with the totals.\n"
+               "\n");
+}
+
+int replay_main(int argc, char **argv)
+{
+    static struct option long_options[] =
+    {
+        { "max-bytes",    required_argument,      0,  'b' },
+        { "cols",         required_argument,      0,  'c' },
+        { "delay",        required_argument,      0,  'd' },
+        { "help",         no_argument,            0,  'h' },
+        { "max-time",     required_argument,      0,  'm' },
+        { "rows",         required_argument,      0,  'r' },
+        { "term",         required_argument,      0,  'T' },
+        { "timeout",      required_argument,      0,  't' },
+        { 0, 0, 0, 0}
+    };
+    struct replay_s replay;
+    int c, status, res;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.cols = 80;
+    replay.rows = 25;
+    replay.delay = 50;
+    replay.timeout = 10;
+    replay.max_bytes = -1;
+    replay.max_time = -1;
+    replay.term = "xterm";
+
+    /* stop at the script name, the rest is for the editor */
+    while((c = getopt_long(argc, argv, "+b:c:d:hm:r:T:t:", long_options, NULL)) != -1)
+    {
+        switch(c)
+        {
+            case 'b': replay.max_bytes = atol(optarg); break;
+            case 'c': replay.cols = atoi(optarg); break;
+            case 'd': replay.delay = atoi(optarg); break;
+            case 'm': replay.max_time = atol(optarg); break;
+            case 'r': replay.rows = atoi(optarg); break;
+            case 'T': replay.term = optarg; break;
+            case 't': replay.timeout = atoi(optarg); break;
+
+            case 'h':
+                replay_usage(stdout);
+                return 0;
+
+            default:
+                replay_usage(stderr);
+                return 1;
+        }
+    }
+
+    if(optind >= argc || replay.cols <= 0 || replay.rows <= 0 ||
+       replay.delay < 0 || replay.timeout <= 0)
+    {
+        replay_usage(stderr);
+        return 1;
+    }
+
+    if(!read_script(&replay, argv[optind]) ||
+       !start_editor(&replay, argc-optind-1, argv+optind+1))
+    {
+        free_script(&replay);
+        return 1;
+    }
+
+    res = replay_script(&replay);
+
+    kill(replay.pid, SIGKILL);
+    waitpid(replay.pid, &status, 0);
+    free_script(&replay);
+    return res;
+}
@@ -0,0 +1,267 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: scale.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include "scale.h"
+#include "parallel.h"
+
+/*
+ * expand_table[f][b] is the 8 pixels of byte b, each repeated f times,
+ * aligned to the most significant bit of a 64-bit word. We use it to
+ * stretch a whole byte of pixels with one lookup.
+ */
+static uint64_t expand_table[MAX_SCALE_FACTOR+1][256];
+static int expand_table_ready = 0;
+
+struct scale_args_s
+{
+    unsigned char *newdata;
+    int old_width, old_height, old_bytes;
+    int new_width, new_height, new_bytes;
+    unsigned int old_charsize, new_charsize;
+    int xfactor;                        /* integer horizontal factor, or 0 */
+    uint64_t old_mask, new_mask;
+    uint64_t col_mask[MAX_WIDTH];       /* source pixel of each new column */
+    unsigned char src_row[MAX_HEIGHT];  /* source row of each new row */
+};
+
+static void init_expand_table()
+{
+    int f, b, k, j;
+
+    if(expand_table_ready) return;
+
+    for(f = 1; f <= MAX_SCALE_FACTOR; f++)
+    {
+        for(b = 0; b < 256; b++)
+        {
+            uint64_t v = 0;
+
+            for(k = 0; k < 8; k++)
+            {
+                if(!(b & (0x80 >> k))) continue;
+                for(j = 0; j < f; j++) v |= 1ULL << (63-(k*f)-j);
+            }
+
+            expand_table[f][b] = v;
+        }
+    }
+
+    expand_table_ready = 1;
+}
+
+static inline uint64_t expand_row(uint64_t line, int factor, int width)
+{
+    uint64_t res = 0;
+    int k;
+
+    for(k = 0; (k*8 < width) && (k*8*factor < 64); k++)
+    {
+        res |= expand_table[factor][(line >> (56-(k*8))) & 0xFF] >> (k*8*factor);
+    }
+
+    return res;
+}
+
+static inline uint64_t scale_row(struct scale_args_s *a, uint64_t line)
+{
+    uint64_t res = 0;
+    int x;
+
+    if(a->xfactor) return expand_row(line, a->xfactor, a->old_width) & a->new_mask;
+
+    for(x = 0; x < a->new_width; x++)
+    {
+        if(line & a->col_mask[x]) res |= 1ULL << (63-x);
+    }
+
+    return res;
+}
+
+static void scale_nearest_kernel(struct font_s *font, unsigned int first,
+                                 unsigned int count, void *arg)
+{
+    struct scale_args_s *a = (struct scale_args_s *)arg;
+    uint64_t rows[MAX_HEIGHT];
+    unsigned int g;
+    int y;
+
+    for(g = first; g < first+count; g++)
+    {
+        unsigned char *src = font->data + (g*a->old_charsize);
+        unsigned char *dest = a->newdata + (g*a->new_charsize);
+
+        for(y = 0; y < a->old_height; y++)
+        {
+            rows[y] = scale_row(a, load_glyph_row(src, a->old_bytes, a->old_mask));
+            src += a->old_bytes;
+        }
+
+        for(y = 0; y < a->new_height; y++)
+        {
+            store_glyph_row(dest, a->new_bytes, rows[a->src_row[y]]);
+            dest += a->new_bytes;
+        }
+    }
+}
+
+/*
+ * Scale2x (aka EPX), done on whole rows at once. For each pixel P with
+ * the neighbours A (above), B (right), C (left) and D (below):
+ *
+ *   E0 = (C == A && C != D && A != B) ? A : P      (top-left)
+ *   E1 = (A == B && A != C && B != D) ? B : P      (top-right)
+ *   E2 = (D == C && D != B && C != A) ? C : P      (bottom-left)
+ *   E3 = (B == D && B != A && D != C) ? D : P      (bottom-right)
+ *
+ * Pixels outside the glyph are taken to be unset.
+ */
+static void scale2x_rows(uint64_t *in, uint64_t *out, int width, int height)
+{
+    uint64_t mask = glyph_row_mask(width);
+    uint64_t new_mask = glyph_row_mask(width*2);
+    int y;
+
+    for(y = 0; y < height; y++)
+    {
+        uint64_t P = in[y];
+        uint64_t A = y ? in[y-1] : 0;
+        uint64_t D = (y < height-1) ? in[y+1] : 0;
+        uint64_t C = (P >> 1) & mask;
+        uint64_t B = (P << 1) & mask;
+        uint64_t ca = ~(C ^ A), cd = ~(C ^ D);
+        uint64_t ab = ~(A ^ B), bd = ~(B ^ D);
+        uint64_t s0 = ca & ~cd & ~ab;
+        uint64_t s1 = ab & ~ca & ~bd;
+        uint64_t s2 = cd & ~bd & ~ca;
+        uint64_t s3 = bd & ~ab & ~cd;
+        uint64_t e0 = (s0 & A) | (~s0 & P);
+        uint64_t e1 = (s1 & B) | (~s1 & P);
+        uint64_t e2 = (s2 & C) | (~s2 & P);
+        uint64_t e3 = (s3 & D) | (~s3 & P);
+
+        /* E0/E2 go to the even output columns, E1/E3 to the odd ones */
+        out[y*2] = ((expand_row(e0, 2, width) & 0xAAAAAAAAAAAAAAAAULL) |
+                    (expand_row(e1, 2, width) & 0x5555555555555555ULL)) & new_mask;
+        out[(y*2)+1] = ((expand_row(e2, 2, width) & 0xAAAAAAAAAAAAAAAAULL) |
+                        (expand_row(e3, 2, width) & 0x5555555555555555ULL)) & new_mask;
+    }
+}
+
+static void scale_smooth_kernel(struct font_s *font, unsigned int first,
+                                unsigned int count, void *arg)
+{
+    struct scale_args_s *a = (struct scale_args_s *)arg;
+    uint64_t rows[MAX_HEIGHT], rows2[MAX_HEIGHT];
+    unsigned int g;
+    int y;
+
+    for(g = first; g < first+count; g++)
+    {
+        unsigned char *src = font->data + (g*a->old_charsize);
+        unsigned char *dest = a->newdata + (g*a->new_charsize);
+        uint64_t *res = rows2;
+
+        for(y = 0; y < a->old_height; y++)
+        {
+            rows[y] = load_glyph_row(src, a->old_bytes, a->old_mask);
+            src += a->old_bytes;
+        }
+
+        scale2x_rows(rows, rows2, a->old_width, a->old_height);
+
+        /* 4x is Scale2x applied twice */
+        if(a->new_width == a->old_width*4)
+        {
+            scale2x_rows(rows2, rows, a->old_width*2, a->old_height*2);
+            res = rows;
+        }
+
+        for(y = 0; y < a->new_height; y++)
+        {
+            store_glyph_row(dest, a->new_bytes, res[y]);
+            dest += a->new_bytes;
+        }
+    }
+}
+
+int can_scale_smooth(int old_width, int old_height,
+                     int new_width, int new_height)
+{
+    if(new_width > MAX_WIDTH || new_height > MAX_HEIGHT) return 0;
+    if(new_width == old_width*2 && new_height == old_height*2) return 1;
+    if(new_width == old_width*4 && new_height == old_height*4) return 1;
+    return 0;
+}
+
+/*
+ * Scale count glyphs from the font's data (which has the old metrics) into
+ * newdata (which has the new metrics). newdata should be big enough to
+ * hold count glyphs of the new size. Integer horizontal factors use the
+ * bit-expansion tables, other ratios pick the nearest source pixel. The
+ * glyphs are scaled in parallel.
+ */
+void scale_glyph_data(struct font_s *font, unsigned char *newdata,
+                      unsigned int count, int old_width, int old_height,
+                      int new_width, int new_height, int mode)
+{
+    struct scale_args_s a;
+    int i;
+
+    init_expand_table();
+
+    a.newdata = newdata;
+    a.old_width = old_width;
+    a.old_height = old_height;
+    a.old_bytes = (old_width+7)/8;
+    a.new_width = new_width;
+    a.new_height = new_height;
+    a.new_bytes = (new_width+7)/8;
+    a.old_charsize = a.old_bytes*old_height;
+    a.new_charsize = a.new_bytes*new_height;
+    a.old_mask = glyph_row_mask(old_width);
+    a.new_mask = glyph_row_mask(new_width);
+    a.xfactor = 0;
+
+    if(new_width >= old_width && (new_width%old_width) == 0 &&
+       (new_width/old_width) <= MAX_SCALE_FACTOR)
+    {
+        a.xfactor = new_width/old_width;
+    }
+
+    for(i = 0; i < new_width; i++)
+    {
+        a.col_mask[i] = 1ULL << (63-((i*old_width)/new_width));
+    }
+
+    for(i = 0; i < new_height; i++)
+    {
+        a.src_row[i] = (i*old_height)/new_height;
+    }
+
+    if(mode == SCALE_SMOOTH &&
+       can_scale_smooth(old_width, old_height, new_width, new_height))
+    {
+        for_each_glyph_range(font, 0, count, scale_smooth_kernel, &a);
+    }
+    else
+    {
+        for_each_glyph_range(font, 0, count, scale_nearest_kernel, &a);
+    }
+}
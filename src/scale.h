@@ -0,0 +1,40 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: scale.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef SCALE_H
+#define SCALE_H
+
+#include "font_ops.h"
+
+/* glyph scaling modes */
+#define SCALE_NEAREST               (0)
+#define SCALE_SMOOTH                (1)     /* Scale2x/EPX, 2x and 4x only */
+
+/* the biggest integer factor we have bit-expansion tables for */
+#define MAX_SCALE_FACTOR            (8)
+
+/* scale.c */
+int can_scale_smooth(int old_width, int old_height,
+                     int new_width, int new_height);
+void scale_glyph_data(struct font_s *font, unsigned char *newdata,
+                      unsigned int count, int old_width, int old_height,
+                      int new_width, int new_height, int mode);
+
+#endif
@@ -0,0 +1,662 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: serve.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+/* accept4() */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <getopt.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "defs.h"
+#include "undo.h"
+#include "modules/modules.h"
+#include "raster.h"
+#include "serve.h"
+
+/*
+ * The font server:
+ *
+ *   fontopia --serve [options] socket font-file...
+ *
+ * loads the fonts once, then answers metrics, glyph and render requests
+ * on a Unix socket (see serve.h for the protocol), so that programs that
+ * need the same fonts don't all have to parse them.
+ *
+ * Every client gets a thread of its own. The fonts are read-only snapshots
+ * that are never changed once loaded. A request takes a reference to the
+ * current snapshot of its font, and works on it without any locks. To
+ * reload a font (on SIGHUP, or a SERVE_OP_RELOAD request), a new snapshot
+ * is loaded on the side and swapped in, and the old one is freed when the
+ * last request using it is done. Readers only ever wait for the swap.
+ *
+ * Clients past the --clients limit are told SERVE_ERR_BUSY and closed,
+ * and clients that are idle for --timeout seconds are dropped, so the
+ * main loop never waits for a client and always sees the signals.
+ */
+
+#define SERVE_MAX_REPLY         (16*1024*1024)
+
+/* one loaded font, which is never changed */
+struct serve_font_s
+{
+    struct font_s *font;
+    struct cpmap_s *map;
+    int mapsize;
+    uint32_t generation;
+    int refs;
+};
+
+struct serve_s
+{
+    char **file_names;
+    struct serve_font_s **fonts;    /* the current snapshots */
+    int font_count;
+    int max_clients;
+    int clients;
+    int timeout;                    /* in seconds, 0 if none */
+    pthread_mutex_t lock;           /* for fonts[] and clients */
+};
+
+static struct serve_s serve;
+static int signal_pipe[2];
+
+
+static struct serve_font_s *load_snapshot(char *file_name)
+{
+    struct serve_font_s *snap;
+    struct font_ctx_s ctx;
+
+    if(!(snap = (struct serve_font_s *)calloc(1, sizeof(struct serve_font_s))))
+        return NULL;
+
+    init_font_ctx(&ctx, file_name);
+
+    if(!(snap->font = load_font_file(&ctx)))
+    {
+        free(snap);
+        return NULL;
+    }
+
+    /* from the unicode table, or the glyph encodings (PCF fonts) */
+    if((snap->mapsize = get_cpmap(snap->font, &snap->map)) < 0)
+    {
+        kill_font(snap->font);
+        free(snap);
+        return NULL;
+    }
+
+    snap->refs = 1;
+    return snap;
+}
+
+static struct serve_font_s *get_snapshot(int i)
+{
+    struct serve_font_s *snap;
+
+    pthread_mutex_lock(&serve.lock);
+    snap = serve.fonts[i];
+    __atomic_add_fetch(&snap->refs, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&serve.lock);
+    return snap;
+}
+
+static void put_snapshot(struct serve_font_s *snap)
+{
+    if(__atomic_sub_fetch(&snap->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+
+    kill_font(snap->font);
+    free(snap->map);
+    free(snap);
+}
+
+/* returns 1 on success, 0 if the font couldn't be loaded */
+static int reload_font(int i)
+{
+    struct serve_font_s *snap, *old;
+
+    if(!(snap = load_snapshot(serve.file_names[i]))) return 0;
+
+    pthread_mutex_lock(&serve.lock);
+    old = serve.fonts[i];
+    snap->generation = old->generation+1;
+    serve.fonts[i] = snap;
+    pthread_mutex_unlock(&serve.lock);
+
+    put_snapshot(old);
+    return 1;
+}
+
+static void *reload_all(void *arg __attribute__((unused)))
+{
+    int i;
+
+    for(i = 0; i < serve.font_count; i++) reload_font(i);
+    return NULL;
+}
+
+
+static int read_all(int fd, void *buf, size_t size)
+{
+    unsigned char *p = (unsigned char *)buf;
+    ssize_t n;
+
+    while(size)
+    {
+        if((n = read(fd, p, size)) <= 0)
+        {
+            if(n < 0 && errno == EINTR) continue;
+            return 0;
+        }
+
+        p += n;
+        size -= n;
+    }
+
+    return 1;
+}
+
+static int write_all(int fd, void *buf, size_t size)
+{
+    unsigned char *p = (unsigned char *)buf;
+    ssize_t n;
+
+    while(size)
+    {
+        if((n = send(fd, p, size, MSG_NOSIGNAL)) <= 0)
+        {
+            if(n < 0 && errno == EINTR) continue;
+            return 0;
+        }
+
+        p += n;
+        size -= n;
+    }
+
+    return 1;
+}
+
+static int send_status(int fd, uint32_t status)
+{
+    struct serve_reply_s reply = { status, 0 };
+
+    return write_all(fd, &reply, sizeof(reply));
+}
+
+/* make a reply with size bytes of data, which go after the header */
+static unsigned char *new_reply(size_t size)
+{
+    unsigned char *buf;
+
+    if(!(buf = (unsigned char *)calloc(1, sizeof(struct serve_reply_s)+size)))
+        return NULL;
+
+    ((struct serve_reply_s *)buf)->status = SERVE_OK;
+    ((struct serve_reply_s *)buf)->size = (uint32_t)size;
+    return buf;
+}
+
+static int send_reply(int fd, unsigned char *buf)
+{
+    int res = write_all(fd, buf, sizeof(struct serve_reply_s)+
+                                 ((struct serve_reply_s *)buf)->size);
+
+    free(buf);
+    return res;
+}
+
+/* a 1 bpp framebuffer for the bitmap that follows the header */
+static void init_raster(struct raster_s *r, struct serve_bitmap_s *bitmap)
+{
+    r->pixels = (unsigned char *)(bitmap+1);
+    r->width = bitmap->width;
+    r->height = bitmap->height;
+    r->stride = bitmap->row_bytes;
+    r->bpp = 1;
+    r->color = 0;
+}
+
+static int do_metrics(int fd, struct serve_font_s *snap)
+{
+    struct serve_metrics_s *metrics;
+    unsigned char *buf;
+
+    if(!(buf = new_reply(sizeof(struct serve_metrics_s))))
+        return send_status(fd, SERVE_ERR_MEMORY);
+
+    metrics = (struct serve_metrics_s *)(buf+sizeof(struct serve_reply_s));
+    metrics->length = snap->font->length;
+    metrics->width = snap->font->width;
+    metrics->height = snap->font->height;
+    metrics->format = snap->font->version;
+    metrics->has_unicode_table = snap->font->has_unicode_table;
+    metrics->generation = snap->generation;
+    return send_reply(fd, buf);
+}
+
+static int do_glyph(int fd, struct serve_font_s *snap, uint32_t cp)
+{
+    struct font_s *font = snap->font;
+    struct serve_bitmap_s *bitmap;
+    unsigned int g = find_cpmap_glyph(font, snap->map, snap->mapsize, cp);
+    int row_bytes = (font->width+7)/8;
+    struct raster_s r;
+    unsigned char *buf;
+
+    if(g == NO_GLYPH) return send_status(fd, SERVE_ERR_GLYPH);
+
+    if(!(buf = new_reply(sizeof(struct serve_bitmap_s)+row_bytes*font->height)))
+        return send_status(fd, SERVE_ERR_MEMORY);
+
+    bitmap = (struct serve_bitmap_s *)(buf+sizeof(struct serve_reply_s));
+    bitmap->glyph = g;
+    bitmap->width = font->width;
+    bitmap->height = font->height;
+    bitmap->row_bytes = row_bytes;
+    init_raster(&r, bitmap);
+    raster_glyph(font, g, &r, 0, 0);
+    return send_reply(fd, buf);
+}
+
+/*
+ * Draw the text on one line, as wide as the glyph advances add up to (see
+ * raster_text()). Characters the font doesn't have are drawn as U+FFFD or
+ * '?' if it has them, or left blank.
+ */
+static int do_render(int fd, struct serve_font_s *snap, unsigned char *text, int len)
+{
+    struct font_s *font = snap->font;
+    struct serve_bitmap_s *bitmap;
+    struct raster_s r;
+    unsigned char *buf;
+    size_t size;
+    int width, row_bytes;
+
+    width = raster_text_width(font, snap->map, snap->mapsize, text, len);
+    row_bytes = (width+7)/8;
+    size = sizeof(struct serve_bitmap_s)+(size_t)row_bytes*font->height;
+
+    if(size > SERVE_MAX_REPLY) return send_status(fd, SERVE_ERR_TOO_BIG);
+    if(!(buf = new_reply(size))) return send_status(fd, SERVE_ERR_MEMORY);
+
+    bitmap = (struct serve_bitmap_s *)(buf+sizeof(struct serve_reply_s));
+    bitmap->glyph = 0;
+    bitmap->width = width;
+    bitmap->height = font->height;
+    bitmap->row_bytes = row_bytes;
+    init_raster(&r, bitmap);
+    raster_text(font, snap->map, snap->mapsize, text, len, &r, 0, 0);
+    return send_reply(fd, buf);
+}
+
+/* answer one request, returns 0 if the client has gone */
+static int handle_request(int fd, struct serve_request_s *req, unsigned char *text)
+{
+    struct serve_font_s *snap;
+    int res;
+
+    if(req->font >= serve.font_count) return send_status(fd, SERVE_ERR_FONT);
+
+    if(req->op == SERVE_OP_RELOAD)
+        return send_status(fd, reload_font(req->font) ? SERVE_OK : SERVE_ERR_LOAD);
+
+    snap = get_snapshot(req->font);
+
+    switch(req->op)
+    {
+        case SERVE_OP_METRICS:
+            res = do_metrics(fd, snap);
+            break;
+
+        case SERVE_OP_GLYPH:
+            res = do_glyph(fd, snap, req->arg);
+            break;
+
+        case SERVE_OP_RENDER:
+            res = do_render(fd, snap, text, req->count);
+            break;
+
+        default:
+            res = send_status(fd, SERVE_ERR_REQUEST);
+            break;
+    }
+
+    put_snapshot(snap);
+    return res;
+}
+
+static void *serve_client(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    struct serve_request_s req;
+    unsigned char text[SERVE_MAX_TEXT];
+
+    while(read_all(fd, &req, sizeof(req)))
+    {
+        if(req.count > SERVE_MAX_TEXT)
+        {
+            /* we can't tell where the next request starts */
+            send_status(fd, SERVE_ERR_TOO_BIG);
+            break;
+        }
+
+        if(!read_all(fd, text, req.count)) break;
+        if(!handle_request(fd, &req, text)) break;
+    }
+
+    close(fd);
+
+    pthread_mutex_lock(&serve.lock);
+    serve.clients--;
+    pthread_mutex_unlock(&serve.lock);
+    return NULL;
+}
+
+/* returns 1 if the client can be served, 0 if there are too many */
+static int add_client(int fd)
+{
+    struct timeval tv = { serve.timeout, 0 };
+    int res = 0;
+
+    pthread_mutex_lock(&serve.lock);
+    if(serve.clients < serve.max_clients)
+    {
+        serve.clients++;
+        res = 1;
+    }
+
+    pthread_mutex_unlock(&serve.lock);
+
+    if(!res) return 0;
+
+    /* a read or a write that times out closes the connection */
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return 1;
+}
+
+static int start_thread(void *(*func)(void *), void *arg)
+{
+    pthread_attr_t attr;
+    pthread_t tid;
+    int res;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    res = pthread_create(&tid, &attr, func, arg);
+    pthread_attr_destroy(&attr);
+    return (res == 0);
+}
+
+
+static void serve_sighandler(int signo)
+{
+    char c = (signo == SIGHUP) ? 'h' : 'q';
+    int e = errno;
+    ssize_t n = write(signal_pipe[1], &c, 1);
+
+    (void)n;
+    errno = e;
+}
+
+static int open_socket(char *name, mode_t mode)
+{
+    struct sockaddr_un addr;
+    mode_t old_mask;
+    int fd, tries;
+
+    if(strlen(name) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "fontopia: Socket name is too long: %s\n", name);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, name);
+
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+    {
+        perror("fontopia: socket");
+        return -1;
+    }
+
+    /*
+     * The socket is made with the mode we want, as anyone who can connect
+     * can reload the fonts. We have no other threads yet to see the umask.
+     */
+    old_mask = umask(~mode & 0777);
+
+    for(tries = 0; bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0; tries++)
+    {
+        int test;
+
+        /* take over the socket of a server that has died */
+        if(errno == EADDRINUSE && tries == 0 &&
+           (test = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0)
+        {
+            int alive = (connect(test, (struct sockaddr *)&addr, sizeof(addr)) == 0 ||
+                         errno != ECONNREFUSED);
+
+            close(test);
+            if(!alive && unlink(name) == 0) continue;
+        }
+
+        fprintf(stderr, "fontopia: Failed to bind to %s: %s\n", name, strerror(errno));
+        umask(old_mask);
+        close(fd);
+        return -1;
+    }
+
+    umask(old_mask);
+
+    if(listen(fd, 64) != 0)
+    {
+        perror("fontopia: listen");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void serve_usage(FILE *f)
+{
+    fprintf(f, "Usage: fontopia --serve [options] socket font-file...\n"
+               "\nOptions:\n"
+               "  [-c, --clients X]    serve up to X clients at a time (default: 64)\n"
+               "  [-h, --help]         show this help and exit\n"
+               "  [-i, --height X]     open the fonts as raw font files, assuming glyphs\n"
+               "                         are of height X\n"
+               "  [-m, --mode X]       make the socket with mode X, in octal (default: 600)\n"
+               "  [-t, --timeout X]    drop clients that are idle for X seconds, 0 for\n"
+               "                         never (default: 60)\n"
+               "  [-w, --width X]      open the fonts as raw font files, assuming glyphs\n"
+               "                         are of width X\n"
+               "\nSend SIGHUP to reload all the fonts, and SIGTERM to stop.\n"
+               "\n");
+}
+
+int serve_main(int argc, char **argv)
+{
+    static struct option long_options[] =
+    {
+        { "clients",      required_argument,      0,  'c' },
+        { "help",         no_argument,            0,  'h' },
+        { "height",       required_argument,      0,  'i' },
+        { "mode",         required_argument,      0,  'm' },
+        { "timeout",      required_argument,      0,  't' },
+        { "width",        required_argument,      0,  'w' },
+        { 0, 0, 0, 0}
+    };
+    struct pollfd fds[2];
+    struct sigaction act;
+    char *socket_name, *end;
+    mode_t mode = 0600;
+    int c, i, listen_fd, res = 0;
+
+    headless = 1;
+    undo_memory_cap = 0;
+    big_endian = is_big_endian();
+    init_modules();
+
+    serve.max_clients = 64;
+    serve.timeout = 60;
+
+    while((c = getopt_long(argc, argv, "c:hi:m:t:w:", long_options, NULL)) != -1)
+    {
+        switch(c)
+        {
+            case 'c':
+                serve.max_clients = atoi(optarg);
+                break;
+
+            case 'i':
+                startup_rawfont_height = atoi(optarg);
+                break;
+
+            case 'm':
+                mode = (mode_t)strtol(optarg, &end, 8);
+                if(*end || end == optarg || mode > 0777)
+                {
+                    serve_usage(stderr);
+                    return 1;
+                }
+                break;
+
+            case 't':
+                serve.timeout = atoi(optarg);
+                break;
+
+            case 'w':
+                startup_rawfont_width = atoi(optarg);
+                break;
+
+            case 'h':
+                serve_usage(stdout);
+                return 0;
+
+            default:
+                serve_usage(stderr);
+                return 1;
+        }
+    }
+
+    if(argc-optind < 2 || serve.max_clients <= 0 || serve.timeout < 0 ||
+       argc-optind-1 > 256)
+    {
+        serve_usage(stderr);
+        return 1;
+    }
+
+    socket_name = argv[optind];
+    serve.file_names = argv+optind+1;
+    serve.font_count = argc-optind-1;
+
+    if(!(serve.fonts = (struct serve_font_s **)calloc(serve.font_count,
+                                                sizeof(struct serve_font_s *))))
+    {
+        fprintf(stderr, "fontopia: Insufficient memory\n");
+        return 1;
+    }
+
+    for(i = 0; i < serve.font_count; i++)
+    {
+        if(!(serve.fonts[i] = load_snapshot(serve.file_names[i])))
+        {
+            fprintf(stderr, "fontopia: Failed to load %s\n", serve.file_names[i]);
+            return 1;
+        }
+    }
+
+    pthread_mutex_init(&serve.lock, NULL);
+
+    if(pipe(signal_pipe) != 0 || (listen_fd = open_socket(socket_name, mode)) < 0)
+        return 1;
+
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = serve_sighandler;
+    sigemptyset(&act.sa_mask);
+    act.sa_flags = SA_RESTART;
+    sigaction(SIGHUP, &act, NULL);
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = signal_pipe[0];
+    fds[1].events = POLLIN;
+
+    while(1)
+    {
+        if(poll(fds, 2, -1) < 0)
+        {
+            if(errno == EINTR) continue;
+            perror("fontopia: poll");
+            res = 1;
+            break;
+        }
+
+        if(fds[1].revents & POLLIN)
+        {
+            char sig;
+
+            if(read(signal_pipe[0], &sig, 1) != 1 || sig == 'q') break;
+
+            /* the fonts are loaded on the side, so clients don't wait */
+            if(!start_thread(reload_all, NULL)) reload_all(NULL);
+        }
+
+        if(fds[0].revents & POLLIN)
+        {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+            if(fd < 0) continue;
+
+            if(!add_client(fd))
+            {
+                /* the socket is new, so this doesn't block */
+                struct serve_reply_s reply = { SERVE_ERR_BUSY, 0 };
+
+                send(fd, &reply, sizeof(reply), MSG_NOSIGNAL | MSG_DONTWAIT);
+                close(fd);
+                continue;
+            }
+
+            if(!start_thread(serve_client, (void *)(intptr_t)fd))
+            {
+                close(fd);
+                pthread_mutex_lock(&serve.lock);
+                serve.clients--;
+                pthread_mutex_unlock(&serve.lock);
+            }
+        }
+    }
+
+    close(listen_fd);
+    unlink(socket_name);
+    return res;
+}
@@ -0,0 +1,93 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: serve.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdint.h>
+
+/*
+ * The protocol of the font server (fontopia --serve). Clients connect to
+ * its Unix socket, and send requests, each one a struct serve_request_s
+ * followed by count bytes of data. Every request gets a struct
+ * serve_reply_s, followed by size bytes of data if status is SERVE_OK.
+ * Requests on one connection are answered in order. All numbers are in
+ * the host's byte order.
+ *
+ * Fonts are numbered in the order they were given on the command line.
+ * Bitmaps are sent one row after the other, each row taking row_bytes
+ * bytes, with the leftmost pixel in the most significant bit of the first
+ * byte (as in libfontopia.h).
+ */
+
+/* requests */
+#define SERVE_OP_METRICS        1   /* reply: struct serve_metrics_s */
+#define SERVE_OP_GLYPH          2   /* arg is a codepoint; reply: struct
+                                     * serve_bitmap_s and the glyph */
+#define SERVE_OP_RENDER         3   /* data is UTF-8 text; reply: struct
+                                     * serve_bitmap_s and the text */
+#define SERVE_OP_RELOAD         4   /* read the font file again; no reply data */
+
+/* reply status */
+#define SERVE_OK                0
+#define SERVE_ERR_REQUEST       1   /* unknown request */
+#define SERVE_ERR_FONT          2   /* no such font */
+#define SERVE_ERR_GLYPH         3   /* the font has no glyph for arg */
+#define SERVE_ERR_TOO_BIG       4   /* the reply would be too big */
+#define SERVE_ERR_LOAD          5   /* reload failed, the old font is kept */
+#define SERVE_ERR_MEMORY        6
+#define SERVE_ERR_BUSY          7   /* too many clients, the server closes
+                                     * the connection without reading any
+                                     * request */
+
+/* the longest text SERVE_OP_RENDER takes, in bytes */
+#define SERVE_MAX_TEXT          4096
+
+struct serve_request_s
+{
+    uint8_t op;
+    uint8_t font;
+    uint16_t count;             /* bytes of data after the request */
+    uint32_t arg;
+};
+
+struct serve_reply_s
+{
+    uint32_t status;
+    uint32_t size;              /* bytes of data after the reply */
+};
+
+struct serve_metrics_s
+{
+    uint32_t length;            /* number of glyphs */
+    uint32_t width, height;     /* glyph size in pixels */
+    uint32_t format;            /* one of the VER_* values */
+    uint32_t has_unicode_table;
+    uint32_t generation;        /* goes up by one every time the font is reloaded */
+};
+
+struct serve_bitmap_s
+{
+    uint32_t glyph;             /* SERVE_OP_GLYPH: the glyph index */
+    uint32_t width, height;     /* bitmap size in pixels */
+    uint32_t row_bytes;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: shadow.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <ncurses.h>
+#include "defs.h"
+#include "view.h"
+#include "shadow.h"
+
+/*
+ * Start a new frame of rows x cols cells, all blank. The buffers are
+ * reallocated if the size changed, which also means the terminal has to
+ * be redrawn in full. Returns 0 on memory error.
+ */
+int shadow_begin(struct shadow_s *sh, int rows, int cols)
+{
+    int i;
+
+    if(rows != sh->rows || cols != sh->cols || !sh->frame)
+    {
+        struct shadow_cell_s *frame, *shown;
+        size_t sz = (size_t)rows*cols*sizeof(struct shadow_cell_s);
+
+        frame = (struct shadow_cell_s *)realloc(sh->frame, sz ? sz : 1);
+        if(frame) sh->frame = frame;
+        shown = (struct shadow_cell_s *)realloc(sh->shown, sz ? sz : 1);
+        if(shown) sh->shown = shown;
+        if(!frame || !shown) return 0;
+
+        sh->rows = rows;
+        sh->cols = cols;
+        sh->valid = 0;
+    }
+
+    for(i = 0; i < rows*cols; i++)
+    {
+        sh->frame[i].ch = ' ';
+        sh->frame[i].fg = WHITE;
+        sh->frame[i].bg = BGDEFAULT;
+    }
+
+    return 1;
+}
+
+void shadow_put(struct shadow_s *sh, int row, int col,
+                unsigned int ch, int fg, int bg)
+{
+    struct shadow_cell_s *cell;
+
+    if(row < 0 || row >= sh->rows || col < 0 || col >= sh->cols) return;
+    cell = &sh->frame[(row*sh->cols)+col];
+    cell->ch = ch;
+    cell->fg = fg;
+    cell->bg = bg;
+}
+
+/* put an ASCII string, returns the number of cells it takes */
+int shadow_puts(struct shadow_s *sh, int row, int col,
+                char *s, int fg, int bg)
+{
+    int n = 0;
+
+    while(*s) shadow_put(sh, row, col+n++, (unsigned char)*s++, fg, bg);
+
+    return n;
+}
+
+static inline int same_cell(struct shadow_cell_s *c1, struct shadow_cell_s *c2)
+{
+    return c1->ch == c2->ch && c1->fg == c2->fg && c1->bg == c2->bg;
+}
+
+/*
+ * Send the cells that differ from what the terminal shows (or all of them
+ * if we don't know what it shows). Each row is sent as runs of cells that
+ * have the same colors, one printw() call per run. Unchanged cells between
+ * two changed ones are sent again if there are only a few of them, as this
+ * is cheaper than moving the cursor. Returns the number of cells sent.
+ */
+int shadow_flush(struct shadow_s *sh, int start_row, int start_col)
+{
+    struct shadow_cell_s *frame, *shown;
+    int row, col, last, gap, sent = 0;
+    int fg = -1, bg = -1;
+    char *run, *p;
+
+    if(!sh->frame) return 0;
+
+    /* up to 4 UTF-8 bytes per cell */
+    if(!(run = (char *)malloc((sh->cols*4)+1))) return 0;
+
+    for(row = 0; row < sh->rows; row++)
+    {
+        frame = sh->frame+(row*sh->cols);
+        shown = sh->shown+(row*sh->cols);
+
+        for(col = 0; col < sh->cols; )
+        {
+            if(sh->valid && same_cell(&frame[col], &shown[col])) { col++; continue; }
+
+            locate(start_row+row, start_col+col);
+
+            if(frame[col].fg != fg || frame[col].bg != bg)
+            {
+                fg = frame[col].fg;
+                bg = frame[col].bg;
+                setScreenColors(fg, bg);
+            }
+
+            /* collect the run, bridging small gaps of unchanged cells */
+            for(p = run, last = col, gap = 0; col < sh->cols; col++)
+            {
+                if(frame[col].fg != fg || frame[col].bg != bg) break;
+
+                if(sh->valid && same_cell(&frame[col], &shown[col]))
+                {
+                    if(++gap > SHADOW_MAX_GAP) break;
+                    continue;
+                }
+
+                /* add the bridged cells, then this one */
+                for( ; last <= col; last++)
+                {
+                    if(frame[last].ch < 0x80) *p++ = (char)frame[last].ch;
+                    else p += make_utf8((unsigned char *)p, frame[last].ch);
+                    sent++;
+                }
+                gap = 0;
+
+                /* wide chars take two columns, so we can't tell where the
+                 * cursor is after a non-ASCII char. start a new run.
+                 */
+                if(frame[col].ch >= 0x80) { col++; break; }
+            }
+
+            *p = '\0';
+            printw("%s", run);
+            col = last;
+        }
+    }
+
+    free(run);
+    memcpy(sh->shown, sh->frame, (size_t)sh->rows*sh->cols*sizeof(struct shadow_cell_s));
+    sh->valid = 1;
+    return sent;
+}
+
+/* the terminal was drawn over, the next flush must send everything */
+void shadow_invalidate(struct shadow_s *sh)
+{
+    sh->valid = 0;
+}
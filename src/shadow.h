@@ -0,0 +1,55 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: shadow.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+/* resend up to this many unchanged cells rather than move the cursor */
+#define SHADOW_MAX_GAP          (4)
+
+/*
+ * A shadow buffer keeps a copy of what a window shows on the terminal.
+ * Windows are drawn into the buffer's frame, then shadow_flush() sends only
+ * the cells that changed since the last flush.
+ */
+struct shadow_cell_s
+{
+    unsigned int ch;            /* unicode char */
+    unsigned char fg, bg;       /* screen colors */
+};
+
+struct shadow_s
+{
+    int rows, cols;
+    struct shadow_cell_s *frame;    /* the frame being drawn */
+    struct shadow_cell_s *shown;    /* what's on the terminal */
+    int valid;                      /* shown matches the terminal */
+};
+
+/* shadow.c */
+int shadow_begin(struct shadow_s *sh, int rows, int cols);
+void shadow_put(struct shadow_s *sh, int row, int col,
+                unsigned int ch, int fg, int bg);
+int shadow_puts(struct shadow_s *sh, int row, int col,
+                char *s, int fg, int bg);
+int shadow_flush(struct shadow_s *sh, int start_row, int start_col);
+void shadow_invalidate(struct shadow_s *sh);
+
+#endif
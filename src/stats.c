@@ -0,0 +1,294 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: stats.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "stats.h"
+
+/*
+ * The phases open on each thread are kept on a small stack, so a phase
+ * knows how much of its time went to the phases nested in it. Each thread
+ * adds up its own totals, and adds them to the shared ones when its last
+ * open phase ends (phases like the BDF bitmap decoding run once a glyph).
+ *
+ * If configured with --enable-alloc-stats, allocations are counted by
+ * wrapping malloc(), calloc() and realloc() at link time (see Makefile.am),
+ * so only fontopia's own calls are counted, not those made inside the C
+ * library. Otherwise, the allocation counters are left out.
+ */
+
+#define STATS_MAX_DEPTH         16
+
+int stats_enabled = 0;
+
+static char *phase_names[STATS_PHASES] =
+{
+    "read", "parse", "decode", "unitab", "view", "write", "hw_change",
+    "patch_unicode",
+};
+
+static char *counter_names[STATS_COUNTERS] =
+{
+    "bytes_read", "bytes_written", "glyphs_decoded", "allocs", "reallocs",
+};
+
+struct phase_stats_s
+{
+    unsigned long calls;
+    double total, self;
+};
+
+struct stats_frame_s
+{
+    int phase;
+    double start, child;
+};
+
+struct trace_event_s
+{
+    int phase, tid;
+    double start, time;
+};
+
+static struct phase_stats_s phases[STATS_PHASES];
+static unsigned long counters[STATS_COUNTERS];
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static double start_time;
+
+/* Chrome trace events, if asked for */
+static int tracing = 0;
+static struct trace_event_s *events = NULL;
+static unsigned long event_count = 0, event_size = 0;
+static int thread_count = 0;
+
+static __thread struct stats_frame_s frames[STATS_MAX_DEPTH];
+static __thread struct phase_stats_s thread_phases[STATS_PHASES];
+static __thread int depth = 0;
+static __thread int thread_id = 0;
+/* don't count the allocations we make ourselves */
+static __thread int in_stats = 0;
+
+static double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+void stats_start(int trace)
+{
+    start_time = now();
+    tracing = trace;
+    stats_enabled = 1;
+}
+
+void __stats_add(int counter, unsigned long n)
+{
+    __atomic_fetch_add(&counters[counter], n, __ATOMIC_RELAXED);
+}
+
+void __stats_begin(int phase)
+{
+    /* too deep, only keep the count right so __stats_end() can match it */
+    if(depth >= STATS_MAX_DEPTH) { depth++; return; }
+
+    frames[depth].phase = phase;
+    frames[depth].child = 0;
+    frames[depth].start = now();
+    depth++;
+}
+
+static void add_event(struct stats_frame_s *frame, double time)
+{
+    if(!thread_id) thread_id = ++thread_count;
+
+    if(event_count == event_size)
+    {
+        unsigned long size = event_size ? event_size*2 : 1024;
+        struct trace_event_s *tmp;
+
+        in_stats = 1;
+        tmp = realloc(events, size*sizeof(struct trace_event_s));
+        in_stats = 0;
+        if(!tmp) return;
+        events = tmp;
+        event_size = size;
+    }
+
+    events[event_count].phase = frame->phase;
+    events[event_count].tid = thread_id;
+    events[event_count].start = frame->start;
+    events[event_count].time = time;
+    event_count++;
+}
+
+void __stats_end(int phase)
+{
+    struct stats_frame_s *frame;
+    double time;
+    int i;
+
+    /* is it open? */
+    for(i = depth-1; i >= 0; i--)
+    {
+        if(i < STATS_MAX_DEPTH && frames[i].phase == phase) break;
+    }
+
+    if(i < 0) return;
+
+    while(depth > i)
+    {
+        if(--depth >= STATS_MAX_DEPTH) continue;
+
+        frame = &frames[depth];
+        time = now()-frame->start;
+        if(depth) frames[depth-1].child += time;
+
+        thread_phases[frame->phase].calls++;
+        thread_phases[frame->phase].total += time;
+        thread_phases[frame->phase].self += time-frame->child;
+
+        if(tracing)
+        {
+            pthread_mutex_lock(&stats_lock);
+            add_event(frame, time);
+            pthread_mutex_unlock(&stats_lock);
+        }
+    }
+
+    if(depth) return;
+
+    pthread_mutex_lock(&stats_lock);
+
+    for(i = 0; i < STATS_PHASES; i++)
+    {
+        phases[i].calls += thread_phases[i].calls;
+        phases[i].total += thread_phases[i].total;
+        phases[i].self += thread_phases[i].self;
+    }
+
+    pthread_mutex_unlock(&stats_lock);
+    memset(thread_phases, 0, sizeof(thread_phases));
+}
+
+/*
+ * Print the totals as one JSON object, e.g.
+ *
+ *   {"wall_s":0.0213,"phases":{"read":{"calls":1,"total_s":0.000102,
+ *    "self_s":0.000102},...},"counters":{"bytes_read":4969,...}}
+ *
+ * total_s includes the nested phases, self_s doesn't.
+ */
+void stats_write_json(FILE *file)
+{
+    int i;
+
+    pthread_mutex_lock(&stats_lock);
+    fprintf(file, "{\"wall_s\":%.6f,\"phases\":{", now()-start_time);
+
+    for(i = 0; i < STATS_PHASES; i++)
+    {
+        fprintf(file, "%s\"%s\":{\"calls\":%lu,\"total_s\":%.6f,\"self_s\":%.6f}",
+                      i ? "," : "", phase_names[i], phases[i].calls,
+                      phases[i].total, phases[i].self);
+    }
+
+    fprintf(file, "},\"counters\":{");
+
+    for(i = 0; i < STATS_COUNTERS; i++)
+    {
+#ifndef ALLOC_STATS
+        if(i == STATS_ALLOCS || i == STATS_REALLOCS) continue;
+#endif
+        fprintf(file, "%s\"%s\":%lu", i ? "," : "", counter_names[i],
+                      __atomic_load_n(&counters[i], __ATOMIC_RELAXED));
+    }
+
+    fprintf(file, "}}\n");
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/*
+ * Write the phases in the Chrome trace event format, which can be opened
+ * in chrome://tracing or Perfetto. Returns 1 on success, 0 on error.
+ */
+int stats_write_trace(char *file_name)
+{
+    unsigned long i;
+    FILE *file;
+    int res;
+
+    if(!(file = fopen(file_name, "w"))) return 0;
+
+    pthread_mutex_lock(&stats_lock);
+    fprintf(file, "{\"traceEvents\":[\n");
+
+    for(i = 0; i < event_count; i++)
+    {
+        fprintf(file, "{\"name\":\"%s\",\"cat\":\"fontopia\",\"ph\":\"X\","
+                      "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}%s\n",
+                      phase_names[events[i].phase],
+                      (events[i].start-start_time)*1e6, events[i].time*1e6,
+                      (int)getpid(), events[i].tid,
+                      (i == event_count-1) ? "" : ",");
+    }
+
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+    pthread_mutex_unlock(&stats_lock);
+
+    res = !ferror(file);
+    if(fclose(file)) res = 0;
+    return res;
+}
+
+#ifdef ALLOC_STATS
+
+/*
+ * The allocation counters. Makefile.am links fontopia with
+ * --wrap=malloc etc., so our calls to malloc() come here.
+ */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    if(stats_enabled && !in_stats) __stats_add(STATS_ALLOCS, 1);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    if(stats_enabled && !in_stats) __stats_add(STATS_ALLOCS, 1);
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if(stats_enabled && !in_stats)
+        __stats_add(ptr ? STATS_REALLOCS : STATS_ALLOCS, 1);
+    return __real_realloc(ptr, size);
+}
+
+#endif      /* ALLOC_STATS */
@@ -0,0 +1,93 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: stats.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+/*
+ * Phase timers and counters, to find out where the time goes when loading
+ * and saving fonts. Phases can nest: the time a phase spends in the phases
+ * it opens is counted as theirs, not its own. Everything is a no-op unless
+ * stats_start() was called, and the library doesn't have any of it.
+ */
+enum stats_phase
+{
+    STATS_READ,             /* reading font files */
+    STATS_PARSE,            /* headers, properties and anything else */
+    STATS_DECODE,           /* glyph bitmaps */
+    STATS_UNITAB,           /* get_font_unicode_table() */
+    STATS_VIEW,             /* calc_max_zoom() and the cursors */
+    STATS_WRITE,            /* write_to_file() */
+    STATS_HW_CHANGE,        /* handle_hw_change() */
+    STATS_PATCH_UNICODE,    /* patch_font_unicode() */
+    STATS_PHASES
+};
+
+enum stats_counter
+{
+    STATS_BYTES_READ,
+    STATS_BYTES_WRITTEN,
+    STATS_GLYPHS,           /* glyphs decoded */
+    STATS_ALLOCS,
+    STATS_REALLOCS,
+    STATS_COUNTERS
+};
+
+#ifdef FONTOPIA_LIBRARY
+
+#define stats_enabled               0
+#define stats_begin(phase)          do { (void)(phase); } while(0)
+#define stats_end(phase)            do { (void)(phase); } while(0)
+#define stats_add(counter, n)       do { (void)(counter); (void)(n); } while(0)
+
+#else
+
+extern int stats_enabled;
+
+void __stats_begin(int phase);
+void __stats_end(int phase);
+void __stats_add(int counter, unsigned long n);
+
+static inline void stats_begin(int phase)
+{
+    if(stats_enabled) __stats_begin(phase);
+}
+
+/* closes the phase, and any phase opened inside it that is still open */
+static inline void stats_end(int phase)
+{
+    if(stats_enabled) __stats_end(phase);
+}
+
+static inline void stats_add(int counter, unsigned long n)
+{
+    if(stats_enabled) __stats_add(counter, n);
+}
+
+/* stats.c */
+void stats_start(int trace);
+void stats_write_json(FILE *file);
+int stats_write_trace(char *file_name);
+
+#endif      /* FONTOPIA_LIBRARY */
+
+#endif
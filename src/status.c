@@ -20,15 +20,24 @@
 
 #include <ncurses.h>
 #include "defs.h"
+#include "view.h"
 
 void _do_status(char *msg, int STATUS)
 {
     int row = SCREEN_H-1;
     int col = 2;
     int w = SCREEN_W-2;
-    int i;
     int len;
 
+    /* there is no status bar without a terminal, errors go to stderr */
+    if(headless)
+    {
+        if(STATUS == STATUS_ERROR && msg) fprintf(stderr, "fontopia: %s\n", msg);
+        return;
+    }
+
+    begin_frame();
+
     if(!msg) len = 0;
     else len = strlen(msg);
 
@@ -44,18 +53,12 @@ void _do_status(char *msg, int STATUS)
   
     locate(row, col);
 
-    if(len > w)
-    {
-        for(i = 0; i < w; i++) putchar(msg[i]);
-    }
-    else
-    {
-        if(msg) printw("%s", msg);
-        if(w-len) printw("%*s", w-len, " ");
-    }
+    /* send the whole status line in one go */
+    if(len > w) printw("%.*s", w, msg);
+    else printw("%s%*s", msg ? msg : "", w-len, "");
 
     hideCursor();
-    refresh();
+    end_frame();
 }
 
 void status_error(char *msg)
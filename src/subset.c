@@ -0,0 +1,298 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: subset.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include <ctype.h>
+#include "defs.h"
+#include "fonttools.h"
+
+/***********************************
+ * Font subsetting
+ ***********************************/
+#define SUBSET_CHUNK_SIZE       (1024*1024)
+
+static inline void mark_codepoint(uint64_t *used, unsigned int c)
+{
+    if(c < MAX_CODEPOINT) used[c/64] |= (1ULL << (c%64));
+}
+
+static inline int codepoint_marked(uint64_t *used, unsigned int c)
+{
+    if(c >= MAX_CODEPOINT) return 0;
+    return (used[c/64] >> (c%64)) & 1;
+}
+
+/*
+ * Mark every character in a UTF-8 text file. The file is read in big
+ * chunks, and runs of ASCII text (the bulk of most corpora) are checked
+ * 8 bytes at a time. A character that is split between two chunks is
+ * carried over to the next chunk. Invalid bytes are skipped.
+ * Returns 0 on error.
+ */
+static int scan_utf8_file(FILE *file, uint64_t *used)
+{
+    unsigned char *buf = (unsigned char *)malloc(SUBSET_CHUNK_SIZE+4);
+    uint64_t ascii[2] = { 0, 0 };
+    size_t have = 0, n;
+
+    if(!buf) return 0;
+
+    while((n = fread(buf+have, 1, SUBSET_CHUNK_SIZE, file)) > 0)
+    {
+        size_t len = have+n, i = 0;
+
+        while(i < len)
+        {
+            unsigned int c = buf[i], need, k;
+
+            if(i+8 <= len)
+            {
+                uint64_t w;
+                memcpy(&w, buf+i, 8);
+
+                if(!(w & 0x8080808080808080ULL))
+                {
+                    for(k = 0; k < 8; k++, w >>= 8)
+                        ascii[(w >> 6) & 1] |= 1ULL << (w & 63);
+                    i += 8;
+                    continue;
+                }
+            }
+
+            if(c < 0x80)
+            {
+                ascii[c >> 6] |= 1ULL << (c & 63);
+                i++;
+                continue;
+            }
+
+            if(c >= 0xF0 && c < 0xF8) { need = 4; c &= 0x07; }
+            else if(c >= 0xE0) { need = 3; c &= 0x0F; }
+            else if(c >= 0xC0) { need = 2; c &= 0x1F; }
+            else { i++; continue; }
+
+            /* the rest of this char is in the next chunk */
+            if(i+need > len) break;
+
+            for(k = 1; k < need; k++)
+            {
+                if((buf[i+k] & 0xC0) != 0x80) break;
+                c = (c << 6) | (buf[i+k] & 0x3F);
+            }
+
+            if(k != need) { i++; continue; }
+            mark_codepoint(used, c);
+            i += need;
+        }
+
+        have = len-i;
+        memmove(buf, buf+i, have);
+    }
+
+    used[0] |= ascii[0];
+    used[1] |= ascii[1];
+    free(buf);
+    return !ferror(file);
+}
+
+static int get_codepoint(char **s, unsigned int *res)
+{
+    char *p = *s, *end;
+
+    if((p[0] == 'U' || p[0] == 'u') && p[1] == '+') p += 2;
+    else if(p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+    if(!isxdigit((unsigned char)*p)) return 0;
+
+    *res = (unsigned int)strtoul(p, &end, 16);
+    *s = end;
+    return 1;
+}
+
+/*
+ * Mark the characters in a codepoint list file. The file has one or more
+ * hex values per line, written as U+XXXX, 0xXXXX or XXXX, and ranges like
+ * U+0020-U+007E. Anything after a '#' is a comment.
+ * Returns 0 on error.
+ */
+static int read_codepoint_list(FILE *file, uint64_t *used)
+{
+    char buf[1024];
+
+    while(fgets(buf, sizeof(buf), file))
+    {
+        char *s = buf;
+        unsigned int c, c2;
+
+        while(*s && *s != '#')
+        {
+            if(isspace((unsigned char)*s) || *s == ',') { s++; continue; }
+            if(!get_codepoint(&s, &c)) return 0;
+            c2 = c;
+
+            if(*s == '-' || (s[0] == '.' && s[1] == '.'))
+            {
+                s += (*s == '-') ? 1 : 2;
+                if(!get_codepoint(&s, &c2) || c2 < c) return 0;
+            }
+
+            if(c2 >= MAX_CODEPOINT) return 0;
+            for( ; c <= c2; c++) mark_codepoint(used, c);
+        }
+    }
+
+    return !ferror(file);
+}
+
+/*
+ * Keep only the glyphs that show the marked characters (and glyph 0,
+ * which is used for unknown characters). Glyphs are looked up through
+ * the unicode table if the font has one, otherwise through the glyph
+ * encodings. The unicode table is rebuilt to hold only the marked
+ * characters. Returns the number of marked characters the font has no
+ * glyph for, or -1 on error.
+ */
+static int subset_font(struct font_s *font, uint64_t *used)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    unsigned int *cps = NULL, *start = NULL;
+    uint64_t *found = NULL;
+    int *remap = NULL;
+    unsigned int i, j, k;
+    int missing = 0;
+
+    remap = (int *)malloc(font->length*sizeof(int));
+    found = (uint64_t *)calloc(MAX_CODEPOINT/64, sizeof(uint64_t));
+    if(!remap || !found) goto memory_error;
+    if(!read_unicode_values(font, &cps, &start)) goto memory_error;
+
+    for(k = 0, i = 0; i < font->length; i++)
+    {
+        int keep = (i == 0);
+
+        if(font->has_unicode_table)
+        {
+            for(j = start[i]; j < start[i+1]; j++)
+            {
+                if(codepoint_marked(used, cps[j]))
+                {
+                    mark_codepoint(found, cps[j]);
+                    keep = 1;
+                }
+            }
+        }
+        else if(char_info && char_info[i].encoding >= 0 &&
+                codepoint_marked(used, char_info[i].encoding))
+        {
+            mark_codepoint(found, char_info[i].encoding);
+            keep = 1;
+        }
+
+        remap[i] = keep ? (int)k++ : -1;
+    }
+
+    /* PSF1 fonts can only have 256 or 512 glyphs */
+    if(font->version == VER_PSF1) k = (k <= 256) ? 256 : 512;
+
+    for(i = 0; i < MAX_CODEPOINT/64; i++)
+        missing += __builtin_popcountll(used[i] & ~found[i]);
+
+    if(!remap_font_glyphs(font, remap, k, font->has_unicode_table ? used : NULL))
+        missing = -1;
+
+    free(cps);
+    free(start);
+    free(found);
+    free(remap);
+    return missing;
+
+memory_error:
+
+    if(remap) free(remap);
+    if(found) free(found);
+    status_error("Insufficient memory");
+    return -1;
+}
+
+static void subset_font_from_file(struct font_s *font, int is_list)
+{
+    char *file_name = NULL;
+    FILE *file = NULL;
+    uint64_t *used = NULL;
+    unsigned int old_length = font->length;
+    char msg[128];
+    int res, missing;
+
+    if(!font->has_unicode_table && !font->char_info)
+    {
+        status_error("Font has no unicode table or glyph encodings");
+        return;
+    }
+
+    res = show_opensave(".", OPEN, &file_name, 0);
+    if(res == OPENSAVE_ERROR) goto file_error;
+    if(res == OPENSAVE_CANCEL) return;
+
+    if(!(file = fopen(file_name, "rb"))) goto file_error;
+
+    used = (uint64_t *)calloc(MAX_CODEPOINT/64, sizeof(uint64_t));
+    if(!used) { status_error("Insufficient memory"); goto end; }
+
+    res = is_list ? read_codepoint_list(file, used) : scan_utf8_file(file, used);
+    if(!res)
+    {
+        status_error(is_list ? "Invalid codepoint list" : "Error reading text file");
+        goto end;
+    }
+
+    /* the text's line breaks and tabs don't need glyphs */
+    if(!is_list) used[0] &= ~((1ULL << 0x20)-1);
+
+    if((missing = subset_font(font, used)) < 0) goto end;
+
+    sprintf(msg, "Kept %u of %u glyphs. %d characters\n"
+                 "have no glyph in this font.\n"
+                 "Save the new font now?", font->length, old_length, missing);
+
+    if(msgBox(msg, BUTTON_YES|BUTTON_NO, CONFIRM) == BUTTON_YES)
+        save_font_file(font, 1);
+    else
+        status_msg("Font subset created");
+
+    goto end;
+
+file_error:
+
+    status_error("Error opening file");
+
+end:
+
+    if(used) free(used);
+    if(file) fclose(file);
+    if(file_name) free(file_name);
+}
+
+void subset_font_from_text(struct font_s *font)
+{
+    subset_font_from_file(font, 0);
+}
+
+void subset_font_from_list(struct font_s *font)
+{
+    subset_font_from_file(font, 1);
+}
@@ -0,0 +1,519 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: undo.c
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#include "defs.h"
+#include "view.h"
+#include "glyph.h"
+#include "metadata.h"
+#include "undo.h"
+
+size_t undo_memory_cap = (size_t)UNDO_DEFAULT_MEMORY*1024*1024;
+
+/*
+ * The history is a ring of records, oldest first. The first undo_count
+ * records can be undone, the ones after them (up to undo_total) were
+ * undone and can be redone.
+ */
+static struct undo_record_s *history[UNDO_MAX_RECORDS];
+static int undo_first = 0, undo_count = 0, undo_total = 0;
+static size_t undo_memory = 0;
+
+/* the operation being recorded */
+static struct undo_record_s *pending = NULL;
+static unsigned char *pending_old = NULL;
+static size_t pending_data_len, pending_info_len;
+
+/* unchanged bytes between two changed ones are kept in the same run if
+ * there are no more than this many of them.
+ */
+#define UNDO_RUN_GAP            4
+
+#define history_at(i)           history[(undo_first+(i)) % UNDO_MAX_RECORDS]
+
+
+/*
+ * Deep copy of the parts of the font that operations on the whole font
+ * change. The unicode lookup tables are not copied, they are made again
+ * from unicode_info when the copy is swapped in.
+ */
+static void *dup_mem(void *p, size_t len, size_t *size)
+{
+    void *q;
+
+    if(!p || !len) return NULL;
+    if(!(q = malloc(len))) return NULL;
+    memcpy(q, p, len);
+    *size += len;
+    return q;
+}
+
+static void free_font_state(struct font_s *state)
+{
+    struct metadata_item_s *meta = (struct metadata_item_s *)state->metadata;
+    int i;
+
+    if(state->file_hdr) free(state->file_hdr);
+    if(state->unicode_info) free(state->unicode_info);
+    if(state->raw_data) free(state->raw_data);
+    if(state->version != VER_CP && state->data) free(state->data);
+    if(state->char_info) free(state->char_info);
+
+    if(meta)
+    {
+        for(i = 0; i < metadata_table_len; i++)
+            if(meta[i].is_str && meta[i].value2) free(meta[i].value2);
+        free(meta);
+    }
+
+    free(state);
+}
+
+static struct font_s *copy_font_state(struct font_s *font, size_t *size)
+{
+    struct font_s *state;
+    struct metadata_item_s *meta;
+    int i;
+
+    if(!(state = (struct font_s *)malloc(sizeof(struct font_s)))) return NULL;
+
+    *state = *font;
+    *size = sizeof(struct font_s);
+    state->data = NULL;
+    state->raw_data = NULL;
+    state->unicode_info = NULL;
+    state->unicode_table = NULL;
+    state->unicode_table_index = NULL;
+    state->file_hdr = NULL;
+    state->metadata = NULL;
+    state->char_info = NULL;
+
+    /* CP fonts keep their glyphs inside raw_data */
+    if(font->raw_data &&
+       !(state->raw_data = dup_mem(font->raw_data, font->raw_data_size, size)))
+        goto memory_error;
+
+    if(font->version == VER_CP)
+        state->data = (unsigned char *)state->raw_data+
+                      (font->data-(unsigned char *)font->raw_data);
+    else if(font->data &&
+            !(state->data = dup_mem(font->data, font->data_size, size)))
+        goto memory_error;
+
+    if(font->unicode_info &&
+       !(state->unicode_info = dup_mem(font->unicode_info, font->unicode_info_size, size)))
+        goto memory_error;
+
+    if(font->file_hdr &&
+       !(state->file_hdr = dup_mem(font->file_hdr, font->header_size, size)))
+        goto memory_error;
+
+    if(font->char_info &&
+       !(state->char_info = dup_mem(font->char_info, font->char_info_size, size)))
+        goto memory_error;
+
+    if(font->has_metadata && font->metadata)
+    {
+        if(!(meta = dup_mem(font->metadata, sizeof(metadata_table), size)))
+            goto memory_error;
+
+        /* don't let free_font_state() free the strings we didn't copy */
+        for(i = 0; i < metadata_table_len; i++)
+            if(meta[i].is_str) meta[i].value2 = NULL;
+        state->metadata = meta;
+
+        for(i = 0; i < metadata_table_len; i++)
+        {
+            char *s = ((struct metadata_item_s *)font->metadata)[i].value2;
+
+            if(!meta[i].is_str || !s) continue;
+            if(!(meta[i].value2 = dup_mem(s, strlen(s)+1, size)))
+                goto memory_error;
+        }
+    }
+
+    return state;
+
+memory_error:
+
+    free_font_state(state);
+    return NULL;
+}
+
+
+/* LEB128 encoding of run lengths */
+static unsigned char *put_varint(unsigned char *p, size_t n)
+{
+    while(n >= 0x80)
+    {
+        *p++ = (unsigned char)(n | 0x80);
+        n >>= 7;
+    }
+
+    *p++ = (unsigned char)n;
+    return p;
+}
+
+static unsigned char *get_varint(unsigned char *p, size_t *n)
+{
+    int shift = 0;
+
+    *n = 0;
+    do
+    {
+        *n |= (size_t)(*p & 0x7f) << shift;
+        shift += 7;
+    } while(*p++ & 0x80);
+
+    return p;
+}
+
+/*
+ * Write the XOR of old and new as runs of (bytes to skip, run length, run
+ * bytes), ending with a zero-length run. The worst case is a run of one
+ * byte every UNDO_RUN_GAP+1 bytes, which needs less than 3*len+20 bytes.
+ */
+static unsigned char *encode_runs(unsigned char *p, unsigned char *old,
+                                  unsigned char *new, size_t len)
+{
+    size_t i = 0, last = 0, start, end, k;
+
+    while(1)
+    {
+        while(i < len && old[i] == new[i]) i++;
+        if(i == len) break;
+
+        /* extend the run over small gaps */
+        start = i;
+        end = ++i;
+        while(i < len && i-end <= UNDO_RUN_GAP)
+        {
+            if(old[i] != new[i]) end = i+1;
+            i++;
+        }
+
+        i = end;
+        p = put_varint(p, start-last);
+        p = put_varint(p, end-start);
+        for(k = start; k < end; k++) *p++ = old[k] ^ new[k];
+        last = end;
+    }
+
+    p = put_varint(p, 0);
+    return put_varint(p, 0);
+}
+
+static unsigned char *apply_runs(unsigned char *p, unsigned char *dest)
+{
+    size_t skip, n, k;
+
+    while(1)
+    {
+        p = get_varint(p, &skip);
+        p = get_varint(p, &n);
+        if(!n) return p;
+
+        dest += skip;
+        for(k = 0; k < n; k++) *dest++ ^= *p++;
+    }
+}
+
+
+static void free_record(struct undo_record_s *rec)
+{
+    if(rec->delta) free(rec->delta);
+    if(rec->state) free_font_state(rec->state);
+    free(rec);
+}
+
+/* forget the records that were undone, as we can't redo them anymore */
+static void drop_redo_records()
+{
+    while(undo_total > undo_count)
+    {
+        struct undo_record_s *rec = history_at(--undo_total);
+        undo_memory -= rec->size;
+        free_record(rec);
+    }
+}
+
+static void drop_oldest_record()
+{
+    struct undo_record_s *rec = history_at(0);
+
+    undo_memory -= rec->size;
+    free_record(rec);
+    undo_first = (undo_first+1) % UNDO_MAX_RECORDS;
+    undo_count--;
+    undo_total--;
+}
+
+static void push_record(struct undo_record_s *rec)
+{
+    drop_redo_records();
+
+    /* a record that doesn't fit can't be kept, and the ones before it
+     * can't be undone without it.
+     */
+    if(rec->size > undo_memory_cap)
+    {
+        free_record(rec);
+        undo_clear();
+        return;
+    }
+
+    while(undo_total &&
+          (undo_total == UNDO_MAX_RECORDS || undo_memory+rec->size > undo_memory_cap))
+        drop_oldest_record();
+
+    history_at(undo_total) = rec;
+    undo_total++;
+    undo_count++;
+    undo_memory += rec->size;
+}
+
+static void free_pending()
+{
+    if(pending) free_record(pending);
+    if(pending_old) free(pending_old);
+    pending = NULL;
+    pending_old = NULL;
+}
+
+static inline size_t char_info_bytes(struct font_s *font,
+                                     unsigned int first, unsigned int count)
+{
+    size_t end = (size_t)(first+count)*sizeof(struct char_info_s);
+
+    if(!font->char_info || end > font->char_info_size) return 0;
+    return (size_t)count*sizeof(struct char_info_s);
+}
+
+/*
+ * Start recording an operation on the given range of glyphs. This keeps a
+ * copy of the glyphs until undo_end(). Returns 0 if the operation can't be
+ * recorded, in which case the history is cleared (so nothing wrong is
+ * undone later).
+ */
+int undo_begin_glyphs(struct font_s *font, unsigned int first, unsigned int count)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+
+    if(pending) undo_end(font);
+    if(!undo_memory_cap || first >= font->length) return 0;
+    if(count > font->length-first) count = font->length-first;
+
+    pending_data_len = (size_t)count*font->charsize;
+    pending_info_len = char_info_bytes(font, first, count);
+
+    pending = (struct undo_record_s *)calloc(1, sizeof(struct undo_record_s));
+    pending_old = (unsigned char *)malloc(pending_data_len+pending_info_len+1);
+    if(!pending || !pending_old)
+    {
+        free_pending();
+        undo_clear();
+        return 0;
+    }
+
+    pending->type = UNDO_GLYPHS;
+    pending->first = first;
+    pending->count = count;
+    pending->charsize = font->charsize;
+    pending->length = font->length;
+
+    memcpy(pending_old, font->data+(first*font->charsize), pending_data_len);
+    if(pending_info_len)
+        memcpy(pending_old+pending_data_len, &char_info[first], pending_info_len);
+
+    return 1;
+}
+
+/*
+ * Start recording an operation that changes the whole font. Returns 0 if
+ * the operation can't be recorded (see undo_begin_glyphs()).
+ */
+int undo_begin_font(struct font_s *font)
+{
+    if(pending) undo_end(font);
+    if(!undo_memory_cap) return 0;
+
+    if(!(pending = (struct undo_record_s *)calloc(1, sizeof(struct undo_record_s))) ||
+       !(pending->state = copy_font_state(font, &pending->size)))
+    {
+        free_pending();
+        undo_clear();
+        return 0;
+    }
+
+    pending->type = UNDO_FONT;
+    return 1;
+}
+
+/* the operation is done, add it to the history */
+void undo_end(struct font_s *font)
+{
+    struct undo_record_s *rec = pending;
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    unsigned char *delta, *p;
+    size_t len;
+
+    if(!rec) return;
+
+    if(rec->type == UNDO_FONT)
+    {
+        pending = NULL;
+        push_record(rec);
+        return;
+    }
+
+    /* the font metrics must not change under a glyph record */
+    if(font->charsize != rec->charsize || font->length != rec->length ||
+       char_info_bytes(font, rec->first, rec->count) != pending_info_len)
+    {
+        free_pending();
+        undo_clear();
+        return;
+    }
+
+    delta = (unsigned char *)malloc(((pending_data_len+pending_info_len)*3)+40);
+    if(!delta)
+    {
+        free_pending();
+        undo_clear();
+        return;
+    }
+
+    p = encode_runs(delta, pending_old,
+                    font->data+(rec->first*font->charsize), pending_data_len);
+    p = encode_runs(p, pending_old+pending_data_len,
+                    (unsigned char *)&char_info[rec->first], pending_info_len);
+
+    /* nothing changed (two empty sections are 4 bytes) */
+    if(p-delta == 4)
+    {
+        free(delta);
+        free_pending();
+        return;
+    }
+
+    len = p-delta;
+    if((p = realloc(delta, len))) delta = p;
+    rec->delta = delta;
+    rec->size = sizeof(struct undo_record_s)+len;
+    free(pending_old);
+    pending_old = NULL;
+    pending = NULL;
+    push_record(rec);
+}
+
+/* the operation didn't change the font, forget it */
+void undo_cancel()
+{
+    free_pending();
+}
+
+void undo_clear()
+{
+    free_pending();
+    undo_count = undo_total;
+    drop_redo_records();
+
+    while(undo_total) drop_oldest_record();
+    undo_first = 0;
+}
+
+static void swap_font_state(struct font_s *font, struct font_s *state)
+{
+    struct font_s tmp;
+    char zoom = font->current_zoom;
+
+    free_unicode_table(font);
+    tmp = *font;
+    *font = *state;
+    *state = tmp;
+
+    if(font->has_unicode_table)
+    {
+        if(create_empty_unitab(font)) get_font_unicode_table(font);
+        else font->has_unicode_table = 0;
+    }
+
+    font->current_zoom = zoom;
+    calc_max_zoom(font);
+    clear_glyph_selection();
+    reset_all_cursors();
+}
+
+static int apply_record(struct font_s *font, struct undo_record_s *rec)
+{
+    struct char_info_s *char_info = (struct char_info_s *)font->char_info;
+    unsigned char *p;
+
+    if(rec->type == UNDO_FONT)
+    {
+        swap_font_state(font, rec->state);
+    }
+    else
+    {
+        if(font->charsize != rec->charsize || font->length != rec->length)
+            return 0;
+
+        p = apply_runs(rec->delta, font->data+(rec->first*font->charsize));
+        if(char_info_bytes(font, rec->first, rec->count))
+            apply_runs(p, (unsigned char *)&char_info[rec->first]);
+
+        /* show the glyph that changed */
+        goto_glyph(font, rec->first);
+    }
+
+    force_font_dirty(font);
+    return 1;
+}
+
+/* returns 1 if an operation was undone, 0 if there is nothing to undo */
+int undo(struct font_s *font)
+{
+    if(pending) undo_end(font);
+    if(!undo_count) return 0;
+
+    if(!apply_record(font, history_at(undo_count-1)))
+    {
+        undo_clear();
+        return 0;
+    }
+
+    undo_count--;
+    return 1;
+}
+
+/* returns 1 if an operation was redone, 0 if there is nothing to redo */
+int redo(struct font_s *font)
+{
+    if(pending) undo_end(font);
+    if(undo_count == undo_total) return 0;
+
+    if(!apply_record(font, history_at(undo_count)))
+    {
+        undo_clear();
+        return 0;
+    }
+
+    undo_count++;
+    return 1;
+}
@@ -0,0 +1,67 @@
+/* 
+ *    Copyright 2024 (c) Mohammed Isam Mohammed [mohammed_isam1984@yahoo.com]
+ * 
+ *    file: undo.h
+ *    This file is part of fontopia.
+ *
+ *    fontopia is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    fontopia is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with fontopia.  If not, see <http://www.gnu.org/licenses/>.
+ */    
+
+#ifndef UNDO_H
+#define UNDO_H
+
+#include "font_ops.h"
+
+/*
+ * The undo history keeps one record per editing operation:
+ *   - Glyph records hold the XOR of the old and new bytes of a range of
+ *     glyphs (and their char_info), with unchanged bytes left out. XOR is
+ *     its own inverse, so the same record does undo and redo.
+ *   - Font records hold a copy of the whole font as it was before an
+ *     operation that changes the font metrics or length. Undo and redo
+ *     swap the copy with the font.
+ * The oldest records are dropped when the history uses more memory than
+ * undo_memory_cap.
+ */
+#define UNDO_GLYPHS             1
+#define UNDO_FONT               2
+
+/* the most records we keep, whatever their size */
+#define UNDO_MAX_RECORDS        1024
+
+/* default memory cap, in MB (see the --undo-memory option) */
+#define UNDO_DEFAULT_MEMORY     32
+
+struct undo_record_s
+{
+    int type;
+    size_t size;                    /* memory used by this record */
+    unsigned int first, count;      /* glyph records: the glyph range */
+    unsigned int charsize, length;  /* font metrics when recorded */
+    unsigned char *delta;           /* glyph records: the XOR runs */
+    struct font_s *state;           /* font records: the other font state */
+};
+
+extern size_t undo_memory_cap;
+
+/* undo.c */
+int undo_begin_glyphs(struct font_s *font, unsigned int first, unsigned int count);
+int undo_begin_font(struct font_s *font);
+void undo_end(struct font_s *font);
+void undo_cancel();
+void undo_clear();
+int undo(struct font_s *font);
+int redo(struct font_s *font);
+
+#endif
@@ -21,6 +21,7 @@
 #include <ncurses.h>
 #include "defs.h"
 #include "view.h"
+#include "undo.h"
 #include "modules/cp.h"
 
 int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
@@ -33,17 +34,11 @@ int remove_unitab(struct font_s *font)
     if(!font) return 0;
     if(!font->has_unicode_table) return 0;
 
-    free_unicode_table(font);
-    font->has_unicode_table = 0;
-    font->unicode_table_index = 0;
-    font->unicode_table = 0;
-    free(font->unicode_info);
-    font->unicode_info = 0;
-    font->unicode_info_size = 0;
-    if(font->module->update_font_hdr) font->module->update_font_hdr(font);
-    force_font_dirty(font);
+    undo_begin_font(font);
+    discard_unicode_table(font);
     calc_max_zoom(font);
     reset_all_cursors();
+    undo_end(font);
     return 1;
 }
 
@@ -66,12 +61,14 @@ int import_unitab_from_file(struct font_s *font, char *file_name)
 {
     struct font_s *new_font = (struct font_s *)NULL;
     unsigned short *unicode_table = (unsigned short *)NULL;
+    struct font_ctx_s ctx;
     //int len = 0;
     long unicode_table_len = 0;
 
     if(file_name)
     {
-        if(!(new_font = load_font_file(file_name))) return 0;
+        init_font_ctx(&ctx, file_name);
+        if(!(new_font = load_font_file(&ctx))) return 0;
     }
   
     if(!new_font->has_unicode_table)
@@ -96,12 +93,16 @@ int import_unitab_from_file(struct font_s *font, char *file_name)
     }
 
     unsigned int len = new_font->length;
+    undo_begin_font(font);
     if(!patch_font_unicode(font, unicode_table, len, unicode_table_len))
     {
+        undo_cancel();
         status_error("Insufficient memory");
         goto cancelled;
     }
 
+    undo_end(font);
+
     /* update cache */
     if(!_update_cache(font)) goto cancelled;
     status_msg("Font unicode table updated");
@@ -125,8 +126,8 @@ cancelled:
 }
 
 
-int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
-                       unsigned int new_font_length, long new_unicode_bytes)
+static int __patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
+                                unsigned int new_font_length, long new_unicode_bytes)
 {
     void *old_unicode = font->unicode_info;
     long old_unicode_bytes = font->unicode_info_size;
@@ -257,8 +258,7 @@ int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
         {
             /* we will skip the entries we added from the new table */
             unsigned int c = 0;
-            font->unicode_array_index = 0;
-            font->unicode_index = 0;
+            struct utf_cursor_s cur = { 0 };
 
             do
             {
@@ -270,7 +270,7 @@ int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
                     continue;
                 }
 
-                c = get_next_utf(font);
+                c = get_next_utf(font, &cur);
 
                 if(c == PSF1_SEPARATOR)
                 {
@@ -295,7 +295,7 @@ int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
                     do
                     {
                         draft[draft_index++] = c;
-                        c = get_next_utf(font);
+                        c = get_next_utf(font, &cur);
                     } while(c != PSF1_SEPARATOR);
 
                     draft[draft_index++] = c;
@@ -311,7 +311,7 @@ int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
                     if(cnt > 1)
                     {
                         int bytes = 0;
-                        int m = font->unicode_array_index;
+                        int m = cur.index;
 
                         if(font->utf_version == VER_PSF1)
                         {
@@ -333,7 +333,7 @@ int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
 
                             do
                             {
-                                c = get_next_utf(font);
+                                c = get_next_utf(font, &cur);
                                 draft[draft_index++] = c;
                             } while(c != PSF1_SEPARATOR);
 
@@ -386,6 +386,17 @@ error:
     return 0;
 }
 
+int patch_font_unicode(struct font_s *font, unsigned short *new_unicode,
+                       unsigned int new_font_length, long new_unicode_bytes)
+{
+    int res;
+
+    stats_begin(STATS_PATCH_UNICODE);
+    res = __patch_font_unicode(font, new_unicode, new_font_length, new_unicode_bytes);
+    stats_end(STATS_PATCH_UNICODE);
+    return res;
+}
+
 static inline unsigned char hex_to_decimal(char h)
 {
     if(h >= '0' && h <= '9') return h-'0';
@@ -567,13 +578,17 @@ process:
 
     fclose(unitab_file);
 
+    undo_begin_font(font);
     if(!patch_font_unicode(font, unicode_table, len, 
                             unicode_table_index*sizeof(unsigned short)))
     {
+        undo_cancel();
         status_error("Insufficient memory");
         goto cancelled;
     }
 
+    undo_end(font);
+
     /* update cache */
     if(!_update_cache(font)) goto cancelled;
     status_msg("Font unicode table updated");
@@ -22,109 +22,78 @@
 #include "defs.h"
 #include "view.h"
 #include "glyph.h"
+#include "shadow.h"
 #include "modules/psf.h"
 
-struct window_s left_window = { 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, }, { 0, }, NULL };
-struct window_s right_window = { 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, }, { 0, }, NULL };
+struct window_s left_window = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, }, { 0, }, NULL };
+struct window_s right_window = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, }, { 0, }, NULL };
 struct window_s *active_window;
 
-unsigned short utf_mask[] = { 192, 224, 240 };
-
 /*
- * Code for this function is adopted from code written by Jeff Bezanson,
- * who kindly placed this in the public domain in 2005. Source is available from:
- *    http://www.cprogramming.com/tutorial/unicode.html.
+ * Both windows are drawn into shadow buffers, and only the cells that
+ * changed are sent to the terminal. Anything else that draws over the
+ * windows (dialogs, menus, etc.) must call invalidate_view().
  */
-int make_utf8(unsigned char *dest, unsigned int ch)
-{
-    if (ch < 0x80)
-    {
-        dest[0] = (char)ch;
-        return 1;
-    }
+static struct shadow_s left_shadow = { 0, 0, NULL, NULL, 0 };
+static struct shadow_s right_shadow = { 0, 0, NULL, NULL, 0 };
+static struct shadow_s scroll_shadow = { 0, 0, NULL, NULL, 0 };
+static int box_drawn = 0;
 
-    if (ch < 0x800)
-    {
-        dest[0] = (ch>>6) | 0xC0;
-        dest[1] = (ch & 0x3F) | 0x80;
-        return 2;
-    }
+void invalidate_view()
+{
+    shadow_invalidate(&left_shadow);
+    shadow_invalidate(&right_shadow);
+    shadow_invalidate(&scroll_shadow);
+    box_drawn = 0;
+}
 
-    if (ch < 0x10000)
-    {
-        dest[0] = (ch>>12) | 0xE0;
-        dest[1] = ((ch>>6) & 0x3F) | 0x80;
-        dest[2] = (ch & 0x3F) | 0x80;
-        return 3;
-    }
+/*
+ * Drawing a frame may take several calls (the box, both windows and the
+ * status bar). They all write to curses' buffer, which is sent to the
+ * terminal once, when the outermost frame ends.
+ */
+static int frame_level = 0;
 
-    if (ch < 0x110000)
-    {
-        dest[0] = (ch>>18) | 0xF0;
-        dest[1] = ((ch>>12) & 0x3F) | 0x80;
-        dest[2] = ((ch>>6) & 0x3F) | 0x80;
-        dest[3] = (ch & 0x3F) | 0x80;
-        return 4;
-    }
+void begin_frame()
+{
+    frame_level++;
+}
 
-    return 0;
+void end_frame()
+{
+    if(frame_level > 0) frame_level--;
+    if(frame_level == 0) refresh();
 }
 
-int make_utf16(unsigned int *res, unsigned char *utf8);    /* font_ops.c */
+/*
+ * Draw a scrollbar over the right edge of the main box, next to the
+ * charmap, showing which part of the font is visible. Nothing is drawn
+ * if the whole font fits in the window.
+ */
+static void draw_scrollbar(struct font_s *font)
+{
+    int h = right_window.height;
+    int rows = (font->length+right_window.cols_per_row-1)/right_window.cols_per_row;
+    int thumb, top, i;
 
+    if(rows <= h) return;
 
-unsigned int get_next_utf(struct font_s *font)
-{
-    unsigned char *unicode = font->unicode_info;
-    int array_index = font->unicode_array_index;
-    int index = font->unicode_index;
-    unsigned short val = 0;
-    unsigned int val2 = 0;
-  
-    /*
-     * Unicode in PSF1 is stored as 16-bit UTF.
-     */
-    if(font->utf_version == VER_PSF1)
-    {
-        /*
-         * WARNING: there should be some error checking scheme to ensure
-         *          we don't trespass on other people's memory, i.e. cheking for
-         *          index-out-of-bounds error.
-         */
-        val = (unicode[array_index] | (unsigned short)(unicode[array_index+1] << 8));
-        array_index += 2;
-        font->unicode_array_index = array_index;
-        font->unicode_index = index;
-        return (unsigned int)val;
-    }
-    /*
-     * Unicode in PSF2 is stored as 8-bit-coded UTF.
-     */
-    else if(font->utf_version == VER_PSF2)
+    if(!shadow_begin(&scroll_shadow, h, 1)) return;
+
+    thumb = (h*h)/rows;
+    if(thumb < 1) thumb = 1;
+    top = (right_window.first_vis_row*(h-thumb))/(rows-h);
+    if(top > h-thumb) top = h-thumb;
+
+    for(i = 0; i < h; i++)
     {
-        if(unicode[array_index] == PSF2_SEPARATOR)
-        {
-            val2 = (unsigned int)PSF1_SEPARATOR;
-            array_index++;
-        }
-        else if(unicode[array_index] == PSF2_STARTSEQ)
-        {
-            val2 = (unsigned int)PSF1_STARTSEQ;
-            array_index++;
-        }
+        if(i >= top && i < top+thumb)
+            shadow_put(&scroll_shadow, i, 0, 0x2588, WHITE, BGDEFAULT);
         else
-        {
-            int bytes = 1;
-            bytes = make_utf16(&val2, &unicode[array_index]);
-            array_index += bytes;
-        }
-
-        font->unicode_array_index = array_index;
-        font->unicode_index = index;
-        return (unsigned int)val2;
+            shadow_put(&scroll_shadow, i, 0, 0x2502, WHITE, BGDEFAULT);
     }
 
-    return 0;
+    shadow_flush(&scroll_shadow, right_window.start_row, SCREEN_W);
 }
 
 void refresh_right_window(struct font_s *font)
@@ -132,37 +101,38 @@ void refresh_right_window(struct font_s *font)
     int row = 0;
     int col = 0;
     int i = 0;
-    unsigned short c = 0;
-    unsigned char wc[5];
+    int fg, bg;
+    unsigned int c = 0;
 
-    font->unicode_array_index = 0;
-    font->unicode_index = 0;
+    if(headless) return;
+    char hex[8];
 
-    /* first clear old canvas */
-    setScreenColors(WHITE, BGDEFAULT);
-
-    for(i = 0; i < right_window.height; i++)
-    {
-        locate(right_window.start_row+i, right_window.start_col);
-        printw("%*s ", right_window.width, " ");
-    }
-
-    i = 0;
-    if(row > right_window.height || col > right_window.width) { row = 0; col = 0; }
-    locate(right_window.start_row+row, right_window.start_col+col);
+    /* start with a clear canvas */
+    if(!shadow_begin(&right_shadow, right_window.height, right_window.width))
+        return;
 
+    begin_frame();
     i = right_window.first_vis_row*right_window.cols_per_row;
 
     while(i < (int)font->length)
     {
         if(right_window.cursor.row == row && right_window.cursor.col == col)
-            setScreenColors(BLACK, BGWHITE);
+        {
+            fg = BLACK; bg = BGWHITE;
+        }
+        else if(is_glyph_selected(font, i))
+        {
+            fg = WHITE; bg = BGBLUE;
+        }
         else
-            setScreenColors(WHITE, BGDEFAULT);
+        {
+            fg = WHITE; bg = BGDEFAULT;
+        }
     
         if(!font->has_unicode_table)
         {
-            printw("%04x ", i++);
+            sprintf(hex, "%04x ", i++);
+            shadow_puts(&right_shadow, row, col*5, hex, fg, bg);
             col++;
 
             if(col >= right_window.cols_per_row)
@@ -170,7 +140,6 @@ void refresh_right_window(struct font_s *font)
                 row++;
                 if(row == right_window.height) break;
                 col = 0;
-                locate(right_window.start_row+row, right_window.start_col+col);
             }
             continue;
         }
@@ -187,15 +156,9 @@ void refresh_right_window(struct font_s *font)
             c = font->unicode_table[i*2];
         }
 
-        memset((void *)wc, 0, 5);
-        make_utf8(wc, c);
-
-        if(wc[0] == 0xa0 || wc[0] < 0x20)
-        {
-            make_utf8(wc, 0xfffd);
-            printw("%s", wc);
-        }
-        else printw("%s", wc);
+        /* don't send control chars to the terminal */
+        if(c < 0x20 || (c >= 0x7f && c <= 0xa0)) c = 0xfffd;
+        shadow_put(&right_shadow, row, col, c, fg, bg);
 
         i++; col++;
 
@@ -204,138 +167,121 @@ void refresh_right_window(struct font_s *font)
             row++;
             if(row == right_window.height) break;
             col = 0;
-            locate(right_window.start_row+row, right_window.start_col+col);
         }
     }
 
-    refresh();
+    shadow_flush(&right_shadow, right_window.start_row, right_window.start_col);
+    draw_scrollbar(font);
+    end_frame();
+}
+
+/*
+ * Move the first visible row (or column) of the viewport so that the cursor
+ * is inside it.
+ */
+static int scroll_viewport(int first, int cursor, int vis, int size)
+{
+    if(cursor < first) first = cursor;
+    else if(cursor >= first+vis) first = cursor-vis+1;
+    if(first > size-vis) first = size-vis;
+    if(first < 0) first = 0;
+    return first;
 }
 
+/*
+ * Glyphs that don't fit in the left window at the current zoom are shown
+ * through a viewport that follows the cursor, and only the pixels inside
+ * the viewport are drawn. The hex value of each row is shown to the left,
+ * if there is room for it.
+ */
 void refresh_left_window(struct font_s *font)
 {
-    int bail_out = 0;
-    if((left_window.width < (int)font->width+6) ||
-       (left_window.height < (int)font->height+2))
-    {
-        msgBox("Can't display glyph. Font metrics\n"
-               "(width or height) larger than screen\n"
-               "size.", BUTTON_OK, ERROR);
-        bail_out = 1;
-    }
+    if(headless) return;
 
-    int col_midpoint = (left_window.width-(font->width*font->current_zoom)) >> 1;
-    int row_midpoint = (left_window.height-(font->height*font->current_zoom)) >> 1;
-    int col = left_window.start_col + col_midpoint;
-    int row = left_window.start_row + row_midpoint;
     int zoom = (int)font->current_zoom;
-    int j;
+    int hexw = (left_window.width-LEFT_HEX_WIDTH >= zoom*8) ? LEFT_HEX_WIDTH : 0;
+    int vis_cols = (left_window.width-hexw)/zoom;
+    int vis_rows = left_window.height/zoom;
+    int bytes = (font->width+7)/8;
+    uint64_t mask = glyph_row_mask(font->width);
+    int j, k, i, l;
     unsigned char *data = font->data;
-    char X[10], O[10];
+    char hex[20];
 
-    data += get_glyph_index(font);
-    setScreenColors(WHITE, BGDEFAULT);
+    if(vis_cols > (int)font->width) vis_cols = font->width;
+    if(vis_rows > (int)font->height) vis_rows = font->height;
 
-    for(j = 0; j < zoom; j++) { X[j] = 'X'; O[j] = '-'; }
-    X[j] = '\0'; O[j] = '\0';
-  
-    /* first clear old canvas */
-    for(j = 0; j < left_window.height; j++)
-    {
-        locate(left_window.start_row+j, left_window.start_col);
-        printw("%*s", left_window.width, " ");
-    }
+    left_window.first_vis_row = scroll_viewport(left_window.first_vis_row,
+                                                left_window.cursor.row,
+                                                vis_rows, font->height);
+    left_window.first_vis_col = scroll_viewport(left_window.first_vis_col,
+                                                left_window.cursor.col,
+                                                vis_cols, font->width);
 
-    if(bail_out) return;
-  
-    int actual_row = row;
-    unsigned int base_index = (1 << (font->width - 1));
+    int col = (left_window.width-(vis_cols*zoom)) >> 1;
+    int row = (left_window.height-(vis_rows*zoom)) >> 1;
 
-    if(font->width < 8) base_index <<= (8-font->width);
-    else if(font->width > 8 && font->width < 16) base_index <<= (16-font->width);
-    else if(font->width > 16 && font->width < 32) base_index <<= (32-font->width);
+    if(col < hexw) col = hexw;
+    data += get_glyph_index(font)+(left_window.first_vis_row*bytes);
+
+    /* start with a clear canvas */
+    if(!shadow_begin(&left_shadow, left_window.height, left_window.width))
+        return;
+
+    begin_frame();
 
     /* Then draw the glyph */
-    for(j = 0; j < (int)font->height; j++)
+    for(j = left_window.first_vis_row;
+        j < left_window.first_vis_row+vis_rows; j++)
     {
-        unsigned int line, index;
-        index = base_index;
+        unsigned int line = get_glyph_row(data, bytes);
+        uint64_t bits = load_glyph_row(data, bytes, mask);
 
-        if(font->width <= 8)
-        {
-            line = (unsigned int)data[0]; data++;
-        }
-        else if(font->width <= 16)
-        {
-            line = (unsigned int)(data[0] | (unsigned int)(data[1] << 8));
-            data += 2;
-        }
-        else if(font->width <= 32)
-        {
-            line = (unsigned int)(data[0] | ((unsigned int)(data[1]) << 8) | 
-                   ((unsigned int)(data[2]) << 16) | ((unsigned int)(data[3] << 24)));
-            data += 4;
-        }
-        /* 
-         * TODO: We must accommodate other font widths 
-         */
-        else
-        {
-            return;
-        }
+        data += bytes;
     
         /* print the hex presentation of this col, only
          * if there is enough space to the left.
          */
-        setScreenColors(WHITE, BGDEFAULT);
-
-        if(col > 6)
+        if(hexw && left_window.start_col+col > LEFT_HEX_WIDTH)
         {
-            locate(row, col-6);
-            if(font->width <= 16) printw("%04x", line);
-            else if(font->width <= 32) printw("%08x", line);
+            if(font->width <= 16) sprintf(hex, "%04x", line);
+            else if(font->width <= 32) sprintf(hex, "%08x", line);
+            else hex[0] = '\0';
+            shadow_puts(&left_shadow, row, col-LEFT_HEX_WIDTH, hex, WHITE, BGDEFAULT);
         }
     
         /* now print individual bits */
-        int k;
-
-        for(k = 0; k < (int)font->width; k++)
+        for(k = left_window.first_vis_col;
+            k < left_window.first_vis_col+vis_cols; k++)
         {
-            if(active_window == &left_window)
-            {
-                if(left_window.cursor.row == j && left_window.cursor.col == k)
-                    setScreenColors(BLACK, BGWHITE);
-                else
-                    setScreenColors(WHITE, BGDEFAULT);
-            }
+            int fg = WHITE, bg = BGDEFAULT;
+            unsigned int ch = (bits & (1ULL << (63-k))) ? 'X' : '-';
 
-            int i = 0;
-
-            while(i < zoom)
+            if(active_window == &left_window &&
+               left_window.cursor.row == j && left_window.cursor.col == k)
             {
-                locate(row+i, col);
-                if((line & index)) printw("%s", X);
-                else printw("%s", O);
-                i++;
+                fg = BLACK; bg = BGWHITE;
             }
 
-            index >>= 1;
-            col += zoom;
+            for(i = 0; i < zoom; i++)
+                for(l = 0; l < zoom; l++)
+                    shadow_put(&left_shadow, row+i,
+                               col+((k-left_window.first_vis_col)*zoom)+l,
+                               ch, fg, bg);
         }
 
         row += zoom;
-        col = left_window.start_col + col_midpoint;
-        actual_row = row;
-        if(actual_row > SCREEN_H) break;
     }
 
-    refresh();
+    shadow_flush(&left_shadow, left_window.start_row, left_window.start_col);
+    end_frame();
 }
 
 void create_status_msg(char *smsg, char *msg, struct font_s *font)
 {
     char *help_msg = "| ^H help | ^Q quit";
     char m[(MAX_UNICODE_TABLE_ENTRIES*7)+10];
-    char t[12];
+    char t[16];
 
     smsg[0] = '\0';
     m[0] = '\0';
@@ -344,6 +290,13 @@ void create_status_msg(char *smsg, char *msg, struct font_s *font)
     {
         sprintf(m, "[%d/%d] ", font->cp_active_font+1, font->cp_total_fonts);
     }
+
+    if(selection_anchor >= 0)
+    {
+        unsigned int first;
+        sprintf(t, "[sel %u] ", get_glyph_selection(font, &first));
+        strcat(m, t);
+    }
   
     if(font->has_unicode_table)
     {
@@ -399,25 +352,40 @@ void create_status_msg(char *smsg, char *msg, struct font_s *font)
 
 void _refresh_view(char *msg, int status, struct font_s *font)
 {
+    if(headless)
+    {
+        if(status == STATUS_ERROR) status_error(msg);
+        return;
+    }
+
+    begin_frame();
+
     /* clear the screen */
     setScreenColors(WHITE, BGDEFAULT);
 
-    /* draw main window */
-    drawBox(1, 1, SCREEN_H, SCREEN_W, " Fontopia for GNU/Linux ", 0);
+    /* draw main window, unless it's still on the screen */
+    if(!box_drawn)
+    {
+        drawBox(1, 1, SCREEN_H, SCREEN_W, " Fontopia for GNU/Linux ", 0);
+        shadow_invalidate(&left_shadow);
+        shadow_invalidate(&right_shadow);
+        shadow_invalidate(&scroll_shadow);
+        box_drawn = 1;
+    }
     refresh_right_window(font);
     refresh_left_window(font);
 
     if(status == STATUS_ERROR)
     {
         status_error(msg);
-        refresh();
+        end_frame();
         return;
     }
   
     char smsg[SCREEN_W+2];
     create_status_msg(smsg, msg, font);
     status_msg(smsg);
-    refresh();
+    end_frame();
 }
 
 void refresh_view(struct font_s *font)
@@ -460,7 +428,6 @@ void zoom_in(struct font_s *font)
     if(font->current_zoom >= font->max_zoom) return;
     font->current_zoom++;
     refresh_view_status_msg(font_file_name, font);
-    refresh();
 }
 
 void zoom_out(struct font_s *font)
@@ -468,7 +435,6 @@ void zoom_out(struct font_s *font)
     if(font->current_zoom <= 1) return;
     font->current_zoom--;
     refresh_view_status_msg(font_file_name, font);
-    refresh();
 }
 
 void reset_window_cursor(struct window_s *win)
@@ -483,5 +449,7 @@ void reset_all_cursors()
     right_window.cursor.row = 0;
     left_window.cursor.col = 0;
     left_window.cursor.row = 0;
+    left_window.first_vis_row = 0;
+    left_window.first_vis_col = 0;
 }
 
@@ -31,6 +31,7 @@ struct window_s
 {
   int start_row, start_col;
   int first_vis_row;	/* if rows are more than window height */
+  int first_vis_col;	/* left window: if the glyph is wider than the window */
   int cols_per_row;
   int width, height;
   int min_width, min_height;
@@ -40,14 +41,18 @@ struct window_s
   struct window_s *next;
 };
 
+/* columns to the left of the glyph that show the hex value of each row */
+#define LEFT_HEX_WIDTH      6
+
 extern struct window_s left_window, right_window;
 extern struct window_s *active_window;
 
 void calc_max_zoom(struct font_s *font);
 void refresh_right_window(struct font_s *font);
 void refresh_left_window(struct font_s *font);
-unsigned int get_next_utf(struct font_s *font);
-int make_utf8(unsigned char* dest, unsigned int ch);
+void invalidate_view();
+void begin_frame();
+void end_frame();
 
 void zoom_in(struct font_s *font);
 void zoom_out(struct font_s *font);